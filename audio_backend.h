@@ -0,0 +1,101 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef AUDIO_BACKEND_H_
+#define AUDIO_BACKEND_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace grids_jack {
+
+// Transport position as seen by the audio thread
+struct TransportInfo {
+    bool rolling;       // Transport is playing
+    uint64_t frame;     // Position in frames
+    bool has_tempo;     // bpm is valid
+    float bpm;          // Tempo reported by the transport master
+};
+
+// Receives the callbacks of an AudioBackend
+class AudioBackendClient {
+public:
+    virtual ~AudioBackendClient() {}
+
+    // Fill outputs[channel][frame] for one period
+    // Called on the audio thread; must be realtime-safe.
+    virtual void Process(float* const* outputs, uint32_t num_frames) = 0;
+
+    // Called once on the audio thread before its first cycle
+    virtual void ThreadInit() {}
+
+    // Called between cycles when the period size changes; may allocate
+    virtual void BufferSizeChanged(uint32_t buffer_size) { (void)buffer_size; }
+
+    // Called when the backend's sample rate changes
+    virtual void SampleRateChanged(uint32_t sample_rate) { (void)sample_rate; }
+
+    // Called after a missed deadline, delayed_usecs late
+    // May run on the audio thread; must be realtime-safe.
+    virtual void Xrun(float delayed_usecs) { (void)delayed_usecs; }
+
+    // Called when the backend stops for good (e.g. the server quit)
+    virtual void Shutdown() {}
+};
+
+// An audio output the engine can be driven by
+//
+// Usage: Open, RegisterOutput for each channel, Activate (callbacks
+// start), optionally ConnectOutputs, then Close. GetSampleRate and
+// GetBufferSize are valid after Open.
+class AudioBackend {
+public:
+    virtual ~AudioBackend() {}
+
+    // Short backend name ("jack", "dummy")
+    virtual const char* GetName() const = 0;
+
+    // Connect to the audio system; callbacks go to client
+    virtual bool Open(const char* client_name, AudioBackendClient* client) = 0;
+
+    // Add an output channel (before Activate); channels are indexed in
+    // registration order in the outputs passed to Process
+    virtual bool RegisterOutput(const char* name) = 0;
+
+    // Start calling the client
+    virtual bool Activate() = 0;
+
+    // Connect outputs to the system playback (best effort)
+    virtual void ConnectOutputs() {}
+
+    // Stop callbacks and release the connection
+    virtual void Close() = 0;
+
+    virtual uint32_t GetSampleRate() const = 0;
+    virtual uint32_t GetBufferSize() const = 0;
+
+    // SCHED_FIFO priority of the audio thread (<= 0 if not realtime)
+    virtual int GetRealtimePriority() const = 0;
+
+    // Average audio thread load in percent of the period
+    virtual float GetCpuLoad() const = 0;
+
+    // Query the transport (realtime-safe)
+    virtual void QueryTransport(TransportInfo* info) const = 0;
+};
+
+}  // namespace grids_jack
+
+#endif  // AUDIO_BACKEND_H_
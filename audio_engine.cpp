@@ -0,0 +1,173 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "audio_engine.h"
+
+#include <cstring>  // for memset
+
+namespace grids_jack {
+
+AudioEngine::AudioEngine()
+    : sample_player_(nullptr),
+      pattern_generator_(nullptr),
+      sample_rate_(0),
+      output_gain_(1.0f),
+      output_silent_(false),
+      silent_left_(nullptr),
+      silent_right_(nullptr),
+      silent_frames_(0) {}
+
+void AudioEngine::Init(SamplePlayer* sample_player,
+                       PatternGeneratorWrapper* pattern_generator,
+                       uint32_t sample_rate) {
+    sample_player_ = sample_player;
+    pattern_generator_ = pattern_generator;
+    sample_rate_ = sample_rate;
+    output_silent_ = false;
+    silent_left_ = nullptr;
+    silent_right_ = nullptr;
+    silent_frames_ = 0;
+    stats_.Clear();
+    histogram_.Clear();
+
+    // Readers see the footprint before the first callback
+    MemoryFootprint footprint;
+    GetMemoryFootprint(&footprint);
+    stats_.memory_bytes = footprint.Total();
+    publisher_.Publish(stats_);
+}
+
+void AudioEngine::GetMemoryFootprint(MemoryFootprint* out) const {
+    out->Clear();
+    out->engine_state += sizeof(*this);
+    if (sample_player_ != nullptr) {
+        sample_player_->AddFootprint(out);
+        if (sample_player_->GetSampleBank() != nullptr) {
+            sample_player_->GetSampleBank()->AddFootprint(out);
+        }
+    }
+    if (pattern_generator_ != nullptr) {
+        pattern_generator_->AddFootprint(out);
+    }
+}
+
+void AudioEngine::Process(float* out_left, float* out_right, uint32_t num_frames) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    uint64_t start_ns = MonotonicNanos();
+    bool idle = ProcessCycle(out_left, out_right, nullptr, 0, num_frames);
+    PublishStats(num_frames, idle, MonotonicNanos() - start_ns);
+}
+
+void AudioEngine::ProcessStems(float* out_left, float* out_right, float* const* bus_outputs,
+                               size_t num_buses, uint32_t num_frames) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    uint64_t start_ns = MonotonicNanos();
+    bool idle = ProcessCycle(out_left, out_right, bus_outputs, num_buses, num_frames);
+    PublishStats(num_frames, idle, MonotonicNanos() - start_ns);
+}
+
+bool AudioEngine::ProcessCycle(float* out_left, float* out_right, float* const* bus_outputs,
+                               size_t num_buses, uint32_t num_frames) {
+    // Voices keep their mapping's bus only for stem renders
+    sample_player_->SetStemBuses(num_buses > 0);
+
+    // Idle fast path: no voice is playing and nothing fires in this block,
+    // so only the clock advances and the outputs are zeroed at most once
+    if (sample_player_->GetActiveVoiceCount() == 0 &&
+        pattern_generator_->FramesUntilNextEvent() > num_frames) {
+        pattern_generator_->Process(num_frames);
+
+        // JACK port buffers keep their contents between cycles as long as
+        // JACK hands us the same buffers, so the cache is keyed on address
+        if (!output_silent_ || out_left != silent_left_ ||
+            out_right != silent_right_ || num_frames != silent_frames_) {
+            memset(out_left, 0, num_frames * sizeof(float));
+            memset(out_right, 0, num_frames * sizeof(float));
+            output_silent_ = true;
+            silent_left_ = out_left;
+            silent_right_ = out_right;
+            silent_frames_ = num_frames;
+        }
+        for (size_t b = 0; b < 2 * num_buses; b++) {
+            memset(bus_outputs[b], 0, num_frames * sizeof(float));
+        }
+        return true;
+    }
+    output_silent_ = false;
+
+    // Process pattern generator to generate triggers
+    pattern_generator_->Process(num_frames);
+
+    // Process audio through sample player (stereo with panning)
+    if (num_buses > 0) {
+        sample_player_->ProcessStems(out_left, out_right, bus_outputs, num_buses,
+                                     num_frames);
+    } else {
+        sample_player_->ProcessStereo(out_left, out_right, num_frames);
+    }
+
+    // Apply global output gain
+    if (output_gain_ != 1.0f) {
+        for (uint32_t i = 0; i < num_frames; i++) {
+            out_left[i] *= output_gain_;
+            out_right[i] *= output_gain_;
+        }
+        for (size_t b = 0; b < 2 * num_buses; b++) {
+            float* bus = bus_outputs[b];
+            for (uint32_t i = 0; i < num_frames; i++) {
+                bus[i] *= output_gain_;
+            }
+        }
+    }
+
+    return false;
+}
+
+void AudioEngine::PublishStats(uint32_t num_frames, bool idle, uint64_t elapsed_ns) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    EngineStats& stats = stats_;
+
+    stats.callbacks++;
+    if (idle) {
+        stats.idle_callbacks++;
+    }
+
+    stats.voices_active = sample_player_->GetActiveVoiceCount();
+    stats.voices_peak = sample_player_->GetPeakVoiceCount();
+    stats.voice_steals = sample_player_->GetVoiceStealCount();
+    stats.triggers_total = sample_player_->GetTotalTriggersCount();
+    stats.triggers_coalesced = sample_player_->GetCoalescedTriggersCount();
+    for (size_t i = 0; i < kStatsParts; i++) {
+        stats.triggers_per_part[i] =
+            pattern_generator_->GetPartTriggerCount(static_cast<DrumPart>(i));
+    }
+    stats.pending_depth = pattern_generator_->GetPendingTriggerCount();
+    stats.pending_overflows = pattern_generator_->GetPendingOverflowCount();
+
+    stats.callback_ns = elapsed_ns > 0xffffffffull ?
+        0xffffffffu : static_cast<uint32_t>(elapsed_ns);
+    histogram_.Record(stats.callback_ns);
+    if (stats.callback_ns > stats.callback_max_ns) {
+        stats.callback_max_ns = stats.callback_ns;
+    }
+    stats.period_ns = sample_rate_ > 0 ? static_cast<uint32_t>(
+        static_cast<uint64_t>(num_frames) * 1000000000ull / sample_rate_) : 0;
+    stats.dsp_load = stats.period_ns > 0 ?
+        static_cast<float>(stats.callback_ns) / static_cast<float>(stats.period_ns) : 0.0f;
+
+    publisher_.Publish(stats);
+}
+
+}  // namespace grids_jack
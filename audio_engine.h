@@ -0,0 +1,96 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef AUDIO_ENGINE_H_
+#define AUDIO_ENGINE_H_
+
+#include <cstdint>
+
+#include "engine_stats.h"
+#include "memory_footprint.h"
+#include "pattern_generator_wrapper.h"
+#include "sample_player.h"
+
+namespace grids_jack {
+
+// One audio cycle of grids-jack: pattern clock, voice mixing, output gain
+// and statistics. The JACK callback and the offline renderer both call
+// Process(), so a render is bit-identical to what the live path plays
+// for the same seed and block size.
+class AudioEngine {
+public:
+    AudioEngine();
+
+    // Attach the player and pattern generator (both already initialized)
+    void Init(SamplePlayer* sample_player, PatternGeneratorWrapper* pattern_generator,
+              uint32_t sample_rate);
+
+    // Set global output gain (applied after mixing)
+    void SetOutputGain(float gain) { output_gain_ = gain; }
+    float GetOutputGain() const { return output_gain_; }
+
+    // Render one block of stereo output
+    // This is realtime-safe and should be called from the audio callback.
+    // Idle blocks leave the buffers untouched if they were zeroed by the
+    // previous call at the same address, so callers must not write to
+    // output buffers they hand back in
+    void Process(float* out_left, float* out_right, uint32_t num_frames);
+
+    // Render one block of the stereo mix plus per-mapping stems
+    // bus_outputs holds an L/R pair per sample mapping (see
+    // SamplePlayer::ProcessStems); the mix is identical to Process()
+    void ProcessStems(float* out_left, float* out_right, float* const* bus_outputs,
+                      size_t num_buses, uint32_t num_frames);
+
+    // Copy the latest statistics snapshot (any thread)
+    void ReadStats(EngineStats* out) const { publisher_.Read(out); }
+
+    // Memory held by the engine, player, sample bank and pattern generator
+    // NOT realtime-safe (walks the sample bank); the total is also
+    // published as EngineStats::memory_bytes from Init
+    void GetMemoryFootprint(MemoryFootprint* out) const;
+
+    // Distribution of Process() durations (any thread)
+    const TimingHistogram& GetCallbackHistogram() const { return histogram_; }
+
+private:
+    // Render the block (and stems, if num_buses > 0); returns true if it
+    // took the idle fast path
+    bool ProcessCycle(float* out_left, float* out_right, float* const* bus_outputs,
+                      size_t num_buses, uint32_t num_frames);
+
+    // Copy counters into the statistics block and publish it
+    void PublishStats(uint32_t num_frames, bool idle, uint64_t elapsed_ns);
+
+    SamplePlayer* sample_player_;
+    PatternGeneratorWrapper* pattern_generator_;
+    uint32_t sample_rate_;
+    float output_gain_;
+
+    // Output buffers already hold silence (idle fast path)
+    bool output_silent_;
+    float* silent_left_;
+    float* silent_right_;
+    uint32_t silent_frames_;
+
+    // Statistics: accumulated by the audio thread, read by any thread
+    EngineStats stats_;
+    EngineStatsPublisher publisher_;
+    TimingHistogram histogram_;
+};
+
+}  // namespace grids_jack
+
+#endif  // AUDIO_ENGINE_H_
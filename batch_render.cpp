@@ -0,0 +1,640 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Render a grid of seeds and pattern parameters to WAV files, one file
+// per configuration, spread across all cores.
+//
+// The Grids pattern generator keeps its state in statics, so a process
+// can only run one engine: workers are forked processes. The sample banks
+// are loaded once before forking and shared copy-on-write; each worker
+// builds its own player, pattern generator and engine per file. Workers
+// take the next configuration from a counter in shared memory and report
+// timings back through the same mapping.
+//
+// With --midi each configuration also gets a Standard MIDI File of its
+// triggers; --midi-only skips audio altogether (only sample file names
+// are read), which generates patterns orders of magnitude faster.
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "audio_engine.h"
+#include "engine_stats.h"
+#include "midi_export.h"
+#include "offline_render.h"
+#include "pattern_generator_wrapper.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+
+using namespace grids_jack;
+
+// Batch configuration (command line)
+struct BatchConfig {
+    const char* output_dir;
+    std::vector<std::string> kits;
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> xs;
+    std::vector<uint32_t> ys;
+    std::vector<uint32_t> densities;
+    std::vector<float> bpms;
+    uint32_t bars;
+    bool stems;
+    bool midi;             // Write a .mid per configuration
+    bool audio;            // Write a .wav per configuration
+    uint32_t block_size;
+    uint32_t sample_rate;
+    size_t num_parts;
+    size_t num_velocity_steps;
+    float humanize;
+    float spread;
+    size_t jobs;
+
+    BatchConfig() : output_dir("corpus"), bars(8), stems(false), midi(false),
+                    audio(true), block_size(256), sample_rate(48000),
+                    num_parts(4), num_velocity_steps(32), humanize(0.0f), spread(0.0f),
+                    jobs(0) {}
+};
+
+// One file to render
+struct Job {
+    size_t kit;
+    uint32_t seed;
+    float bpm;
+    uint8_t x;
+    uint8_t y;
+    uint8_t density;
+};
+
+// Written by the worker that rendered the job, read by the parent
+struct JobResult {
+    int32_t status;        // 0 not run, 1 written, -1 failed
+    uint64_t frames;
+    uint64_t triggers;
+    uint64_t engine_ns;
+    uint64_t total_ns;
+};
+
+// Shared between the parent and all workers (MAP_SHARED)
+struct SharedState {
+    std::atomic<uint32_t> next_job;
+    JobResult results[1];  // num_jobs entries
+};
+
+static BatchConfig g_config;
+
+// Parse "a,b,c" where each item is "n" or "first-last[:step]"
+static bool ParseUintList(const char* text, uint32_t max_value, std::vector<uint32_t>* out) {
+    out->clear();
+    const char* p = text;
+    while (*p != '\0') {
+        char* end = nullptr;
+        unsigned long first = strtoul(p, &end, 10);
+        if (end == p) return false;
+        unsigned long last = first;
+        unsigned long step = 1;
+        p = end;
+        if (*p == '-') {
+            last = strtoul(p + 1, &end, 10);
+            if (end == p + 1) return false;
+            p = end;
+            if (*p == ':') {
+                step = strtoul(p + 1, &end, 10);
+                if (end == p + 1 || step == 0) return false;
+                p = end;
+            }
+        }
+        if (last < first || last > max_value) return false;
+        for (unsigned long v = first; v <= last; v += step) {
+            out->push_back(static_cast<uint32_t>(v));
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+    return !out->empty();
+}
+
+// Parse "a,b,c" of floats within [min_value, max_value]
+static bool ParseFloatList(const char* text, float min_value, float max_value,
+                           std::vector<float>* out) {
+    out->clear();
+    const char* p = text;
+    while (*p != '\0') {
+        char* end = nullptr;
+        float value = strtof(p, &end);
+        if (end == p || value < min_value || value > max_value) return false;
+        out->push_back(value);
+        p = end;
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+    return !out->empty();
+}
+
+// Split "dir1,dir2" into kit directories
+static void ParseKits(const char* text, std::vector<std::string>* out) {
+    out->clear();
+    std::string list(text);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+        if (comma > start) out->push_back(list.substr(start, comma - start));
+        start = comma + 1;
+    }
+}
+
+// Last path component of a kit directory, used in file names
+static std::string KitName(const std::string& path) {
+    size_t end = path.find_last_not_of('/');
+    if (end == std::string::npos) return "kit";
+    size_t start = path.find_last_of('/', end);
+    start = start == std::string::npos ? 0 : start + 1;
+    return path.substr(start, end - start + 1);
+}
+
+// extension includes the dot (".wav", ".mid")
+static std::string JobFileName(const Job& job, const char* extension) {
+    char name[256];
+    snprintf(name, sizeof(name), "%s/%s_seed%u_bpm%g_x%u_y%u_d%u%s", g_config.output_dir,
+             KitName(g_config.kits[job.kit]).c_str(), job.seed, job.bpm, job.x, job.y,
+             job.density, extension);
+    return std::string(name);
+}
+
+// Render one configuration (runs in a worker)
+// bank is nullptr with --midi-only; notes are the kit's MIDI notes
+static void RenderJob(const Job& job, const SampleBank* bank,
+                      const std::vector<uint8_t>& notes, JobResult* result) {
+    SamplePlayer player;
+    if (bank != nullptr) {
+        player.Init(bank, g_config.sample_rate);
+    }
+
+    PatternGeneratorWrapper pattern_gen;
+    pattern_gen.Init(bank != nullptr ? &player : nullptr, g_config.sample_rate, job.bpm);
+    pattern_gen.Seed(job.seed);
+    if (g_config.humanize > 0.0f) {
+        pattern_gen.SetHumanize(g_config.humanize);
+    }
+    pattern_gen.AssignSamplesToParts(notes, g_config.num_parts,
+                                     g_config.num_velocity_steps);
+    if (g_config.spread > 0.0f) {
+        pattern_gen.SetSpread(g_config.spread);
+    }
+    pattern_gen.SetPatternX(job.x);
+    pattern_gen.SetPatternY(job.y);
+    for (int part = 0; part < DRUM_PART_COUNT; part++) {
+        pattern_gen.SetDensity(static_cast<DrumPart>(part), job.density);
+    }
+
+    uint64_t total_frames = FramesForBars(g_config.bars, pattern_gen.GetFramesPerPulse());
+    std::string midi_path = JobFileName(job, ".mid");
+
+    // Triggers only: run the clock without a player
+    if (!g_config.audio) {
+        uint64_t start_ns = MonotonicNanos();
+        size_t num_notes = 0;
+        bool ok = ExportMidi(&pattern_gen, g_config.sample_rate, total_frames,
+                             midi_path.c_str(), &num_notes);
+        result->frames = total_frames;
+        result->triggers = num_notes;
+        result->engine_ns = 0;
+        result->total_ns = MonotonicNanos() - start_ns;
+        result->status = ok ? 1 : -1;
+        return;
+    }
+
+    // The MIDI file listens to the same triggers the render plays
+    MidiExport midi;
+    if (g_config.midi) {
+        midi.Reset(pattern_gen.GetSampleMappings());
+        pattern_gen.SetTriggerListener(&midi);
+    }
+
+    AudioEngine engine;
+    engine.Init(&player, &pattern_gen, g_config.sample_rate);
+
+    std::string path = JobFileName(job, ".wav");
+    RenderResult render;
+    bool ok = RenderToWav(&engine, g_config.sample_rate, g_config.block_size, total_frames,
+                          path.c_str(), &render, nullptr,
+                          g_config.stems ? &pattern_gen.GetSampleMappings() : nullptr);
+    if (ok && g_config.midi) {
+        ok = midi.Write(midi_path.c_str(), g_config.sample_rate,
+                        pattern_gen.GetFramesPerPulse(), total_frames);
+    }
+
+    result->frames = render.frames;
+    result->triggers = player.GetTotalTriggersCount();
+    result->engine_ns = render.engine_ns;
+    result->total_ns = render.total_ns;
+    result->status = ok ? 1 : -1;
+
+    if (ok) {
+        double seconds = static_cast<double>(render.frames) / g_config.sample_rate;
+        fprintf(stderr, "  %s (%.0fx realtime)\n", path.c_str(),
+                render.total_ns > 0 ? seconds / (render.total_ns / 1e9) : 0.0);
+    }
+}
+
+// Worker process: render jobs until none are left
+static int RunWorker(const std::vector<Job>& jobs, const std::vector<SampleBank*>& banks,
+                     const std::vector<std::vector<uint8_t> >& kit_notes,
+                     SharedState* shared) {
+    int failures = 0;
+    for (;;) {
+        uint32_t index = shared->next_job.fetch_add(1);
+        if (index >= jobs.size()) break;
+        size_t kit = jobs[index].kit;
+        RenderJob(jobs[index], banks[kit], kit_notes[kit], &shared->results[index]);
+        if (shared->results[index].status != 1) failures++;
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+// Write index.csv describing every file written
+static bool WriteIndex(const std::vector<Job>& jobs, const SharedState* shared) {
+    std::string path = std::string(g_config.output_dir) + "/index.csv";
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "Error: Could not create %s\n", path.c_str());
+        return false;
+    }
+
+    fprintf(file, "file,kit,seed,bpm,x,y,density,bars,frames,triggers\n");
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const JobResult& result = shared->results[i];
+        if (result.status != 1) continue;
+        const Job& job = jobs[i];
+        std::string name = JobFileName(job, g_config.audio ? ".wav" : ".mid");
+        fprintf(file, "%s,%s,%u,%g,%u,%u,%u,%u,%llu,%llu\n",
+                name.c_str() + strlen(g_config.output_dir) + 1,
+                g_config.kits[job.kit].c_str(), job.seed, job.bpm, job.x, job.y,
+                job.density, g_config.bars, (unsigned long long)result.frames,
+                (unsigned long long)result.triggers);
+    }
+
+    return fclose(file) == 0;
+}
+
+static void PrintUsage(const char* program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n", program_name);
+    fprintf(stderr, "Render every combination of the options below to WAV (or MIDI) files.\n");
+    fprintf(stderr, "Lists are comma-separated; integer items may be ranges first-last[:step].\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -d <dirs>          Sample directories, one kit each (default: data)\n");
+    fprintf(stderr, "  -o <dir>           Output directory (default: corpus)\n");
+    fprintf(stderr, "  --seeds <list>     Random seeds (default: 1)\n");
+    fprintf(stderr, "  --x <list>         Pattern map X, 0-255 (default: 128)\n");
+    fprintf(stderr, "  --y <list>         Pattern map Y, 0-255 (default: 128)\n");
+    fprintf(stderr, "  --density <list>   Fill density of all parts, 0-255 (default: 128)\n");
+    fprintf(stderr, "  --bpm <list>       Tempo in BPM (default: 120)\n");
+    fprintf(stderr, "  --bars <n>         Length of each file in bars (default: 8)\n");
+    fprintf(stderr, "  --stems            Also write part and mapping stems for each file\n");
+    fprintf(stderr, "  --midi             Also write a Standard MIDI File for each file\n");
+    fprintf(stderr, "  --midi-only        Write only MIDI files (no audio is loaded or rendered)\n");
+    fprintf(stderr, "  --block-size <n>   Frames per process block (default: 256)\n");
+    fprintf(stderr, "  --sample-rate <hz> Sample rate (default: 48000)\n");
+    fprintf(stderr, "  -p <parts>         Samples selected per file (default: 4)\n");
+    fprintf(stderr, "  -s <steps>         Velocity pattern steps per sample (default: 32)\n");
+    fprintf(stderr, "  -u <amt>           Humanize timing, 0.0-1.0 (default: 0.0)\n");
+    fprintf(stderr, "  -r <spread>        Stereo spread, 0.0-1.0 (default: 0.0)\n");
+    fprintf(stderr, "  -j <workers>       Worker processes (default: online cores)\n");
+    fprintf(stderr, "  -h                 Show this help message\n");
+}
+
+// Long-only options
+enum {
+    kOptSeeds = 256,
+    kOptX,
+    kOptY,
+    kOptDensity,
+    kOptBpm,
+    kOptBars,
+    kOptStems,
+    kOptMidi,
+    kOptMidiOnly,
+    kOptBlockSize,
+    kOptSampleRate,
+};
+
+static const struct option kLongOptions[] = {
+    {"seeds", required_argument, nullptr, kOptSeeds},
+    {"x", required_argument, nullptr, kOptX},
+    {"y", required_argument, nullptr, kOptY},
+    {"density", required_argument, nullptr, kOptDensity},
+    {"bpm", required_argument, nullptr, kOptBpm},
+    {"bars", required_argument, nullptr, kOptBars},
+    {"stems", no_argument, nullptr, kOptStems},
+    {"midi", no_argument, nullptr, kOptMidi},
+    {"midi-only", no_argument, nullptr, kOptMidiOnly},
+    {"block-size", required_argument, nullptr, kOptBlockSize},
+    {"sample-rate", required_argument, nullptr, kOptSampleRate},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0},
+};
+
+static bool ParseArgs(int argc, char* argv[]) {
+    ParseKits("data", &g_config.kits);
+    g_config.seeds.assign(1, 1);
+    g_config.xs.assign(1, 128);
+    g_config.ys.assign(1, 128);
+    g_config.densities.assign(1, 128);
+    g_config.bpms.assign(1, 120.0f);
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:o:p:s:u:r:j:h", kLongOptions, nullptr)) != -1) {
+        switch (opt) {
+            case 'd':
+                ParseKits(optarg, &g_config.kits);
+                if (g_config.kits.empty()) {
+                    fprintf(stderr, "Error: No sample directories given\n");
+                    return false;
+                }
+                break;
+            case 'o':
+                g_config.output_dir = optarg;
+                break;
+            case kOptSeeds:
+                if (!ParseUintList(optarg, 0xffffffffu, &g_config.seeds)) {
+                    fprintf(stderr, "Error: Invalid seed list: %s\n", optarg);
+                    return false;
+                }
+                break;
+            case kOptX:
+            case kOptY:
+            case kOptDensity: {
+                std::vector<uint32_t>* list = opt == kOptX ? &g_config.xs :
+                                              opt == kOptY ? &g_config.ys :
+                                              &g_config.densities;
+                if (!ParseUintList(optarg, 255, list)) {
+                    fprintf(stderr, "Error: Invalid list (values 0-255): %s\n", optarg);
+                    return false;
+                }
+                break;
+            }
+            case kOptBpm:
+                if (!ParseFloatList(optarg, 1.0f, 999.0f, &g_config.bpms)) {
+                    fprintf(stderr, "Error: Invalid BPM list: %s\n", optarg);
+                    return false;
+                }
+                break;
+            case kOptBars: {
+                int val = atoi(optarg);
+                if (val <= 0) {
+                    fprintf(stderr, "Error: Bars must be greater than 0\n");
+                    return false;
+                }
+                g_config.bars = static_cast<uint32_t>(val);
+                break;
+            }
+            case kOptStems:
+                g_config.stems = true;
+                break;
+            case kOptMidi:
+                g_config.midi = true;
+                break;
+            case kOptMidiOnly:
+                g_config.midi = true;
+                g_config.audio = false;
+                break;
+            case kOptBlockSize: {
+                int val = atoi(optarg);
+                if (val <= 0 || val > 8192) {
+                    fprintf(stderr, "Error: Block size must be between 1 and 8192\n");
+                    return false;
+                }
+                g_config.block_size = static_cast<uint32_t>(val);
+                break;
+            }
+            case kOptSampleRate: {
+                int val = atoi(optarg);
+                if (val < 8000 || val > 384000) {
+                    fprintf(stderr, "Error: Sample rate must be between 8000 and 384000\n");
+                    return false;
+                }
+                g_config.sample_rate = static_cast<uint32_t>(val);
+                break;
+            }
+            case 'p': {
+                int val = atoi(optarg);
+                if (val <= 0) {
+                    fprintf(stderr, "Error: Parts must be greater than 0\n");
+                    return false;
+                }
+                g_config.num_parts = static_cast<size_t>(val);
+                break;
+            }
+            case 's': {
+                int val = atoi(optarg);
+                if (val <= 0) {
+                    fprintf(stderr, "Error: Steps must be greater than 0\n");
+                    return false;
+                }
+                g_config.num_velocity_steps = static_cast<size_t>(val);
+                break;
+            }
+            case 'u': {
+                float val = static_cast<float>(atof(optarg));
+                if (val < 0.0f || val > 1.0f) {
+                    fprintf(stderr, "Error: Humanize must be between 0.0 and 1.0\n");
+                    return false;
+                }
+                g_config.humanize = val;
+                break;
+            }
+            case 'r': {
+                float val = static_cast<float>(atof(optarg));
+                if (val < 0.0f || val > 1.0f) {
+                    fprintf(stderr, "Error: Spread must be between 0.0 and 1.0\n");
+                    return false;
+                }
+                g_config.spread = val;
+                break;
+            }
+            case 'j': {
+                int val = atoi(optarg);
+                if (val <= 0) {
+                    fprintf(stderr, "Error: Workers must be greater than 0\n");
+                    return false;
+                }
+                g_config.jobs = static_cast<size_t>(val);
+                break;
+            }
+            case 'h':
+                PrintUsage(argv[0]);
+                exit(0);
+            default:
+                PrintUsage(argv[0]);
+                return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (!ParseArgs(argc, argv)) {
+        return 1;
+    }
+
+    // Every combination, kit-major so neighbouring files share a bank
+    std::vector<Job> jobs;
+    for (size_t k = 0; k < g_config.kits.size(); k++)
+        for (size_t s = 0; s < g_config.seeds.size(); s++)
+            for (size_t b = 0; b < g_config.bpms.size(); b++)
+                for (size_t x = 0; x < g_config.xs.size(); x++)
+                    for (size_t y = 0; y < g_config.ys.size(); y++)
+                        for (size_t d = 0; d < g_config.densities.size(); d++) {
+                            Job job;
+                            job.kit = k;
+                            job.seed = g_config.seeds[s];
+                            job.bpm = g_config.bpms[b];
+                            job.x = static_cast<uint8_t>(g_config.xs[x]);
+                            job.y = static_cast<uint8_t>(g_config.ys[y]);
+                            job.density = static_cast<uint8_t>(g_config.densities[d]);
+                            jobs.push_back(job);
+                        }
+
+    if (mkdir(g_config.output_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Could not create %s: %s\n", g_config.output_dir,
+                strerror(errno));
+        return 1;
+    }
+
+    // Load every kit once; forked workers share the pages read-only
+    // --midi-only needs the notes alone, so no audio is decoded
+    std::vector<SampleBank*> banks;
+    std::vector<std::vector<uint8_t> > kit_notes(g_config.kits.size());
+    for (size_t k = 0; k < g_config.kits.size(); k++) {
+        SampleBank* bank = new SampleBank();
+        bool ok = g_config.audio
+                      ? bank->LoadDirectory(g_config.kits[k].c_str(), g_config.sample_rate)
+                      : bank->ScanDirectory(g_config.kits[k].c_str(), &kit_notes[k]);
+        if (!ok) {
+            fprintf(stderr, "Error: No samples could be loaded from %s\n",
+                    g_config.kits[k].c_str());
+            return 1;
+        }
+        if (g_config.audio) {
+            kit_notes[k] = bank->GetAllNotes();
+            banks.push_back(bank);
+        } else {
+            delete bank;
+            banks.push_back(nullptr);
+        }
+    }
+
+    size_t workers = g_config.jobs;
+    if (workers == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores > 0 ? static_cast<size_t>(cores) : 1;
+    }
+    if (workers > jobs.size()) {
+        workers = jobs.size();
+    }
+
+    size_t shared_size = sizeof(SharedState) + jobs.size() * sizeof(JobResult);
+    void* memory = mmap(nullptr, shared_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map shared memory: %s\n", strerror(errno));
+        return 1;
+    }
+    SharedState* shared = new (memory) SharedState();
+    shared->next_job.store(0);
+
+    fprintf(stderr, "\nRendering %zu files of %u bars with %zu workers into %s/\n",
+            jobs.size(), g_config.bars, workers, g_config.output_dir);
+
+    uint64_t start_ns = MonotonicNanos();
+
+    // Flush before forking so buffered output is not written twice
+    fflush(stdout);
+    fflush(stderr);
+    std::vector<pid_t> pids;
+    for (size_t w = 0; w < workers; w++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(RunWorker(jobs, banks, kit_notes, shared));
+        }
+        if (pid < 0) {
+            fprintf(stderr, "Error: Could not start worker: %s\n", strerror(errno));
+            break;
+        }
+        pids.push_back(pid);
+    }
+
+    int failed_workers = 0;
+    for (size_t w = 0; w < pids.size(); w++) {
+        int status = 0;
+        waitpid(pids[w], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed_workers++;
+        }
+    }
+    double wall = (MonotonicNanos() - start_ns) / 1e9;
+
+    // Totals over everything written
+    size_t written = 0;
+    uint64_t frames = 0;
+    uint64_t engine_ns = 0;
+    uint64_t total_ns = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const JobResult& result = shared->results[i];
+        if (result.status != 1) continue;
+        written++;
+        frames += result.frames;
+        engine_ns += result.engine_ns;
+        total_ns += result.total_ns;
+    }
+
+    bool ok = WriteIndex(jobs, shared) && written == jobs.size() && failed_workers == 0;
+
+    double audio = static_cast<double>(frames) / g_config.sample_rate;
+    fprintf(stderr, "\nWrote %zu of %zu files (%.1f s of audio) in %.2f s\n", written,
+            jobs.size(), audio, wall);
+    fprintf(stderr, "Throughput: %.0fx realtime overall, %.0fx realtime per core "
+            "(%.0fx in the engine alone)\n",
+            wall > 0.0 ? audio / wall : 0.0,
+            total_ns > 0 ? audio / (total_ns / 1e9) : 0.0,
+            engine_ns > 0 ? audio / (engine_ns / 1e9) : 0.0);
+    if (!ok) {
+        fprintf(stderr, "FAILED: %zu files not written\n", jobs.size() - written);
+    }
+
+    munmap(memory, shared_size);
+    for (size_t k = 0; k < banks.size(); k++) {
+        delete banks[k];
+    }
+    return ok ? 0 : 1;
+}
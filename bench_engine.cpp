@@ -0,0 +1,319 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// End-to-end benchmark of the audio callback with simulated JACK cycles
+//
+// Drives an AudioBackendClient whose Process() is the same one-line body
+// as the live client in main.cpp (AudioEngine::Process on two output
+// port buffers), through the same virtual call the JACK backend makes,
+// with a real kit and pattern. Pattern generation, trigger dispatch,
+// mixing, output gain and statistics all run as they do live.
+//
+// Every cycle is timed individually; the report is the distribution of
+// cycle time as a percentage of the period budget (buffer size / sample
+// rate) for each buffer size. With --perf, user-space hardware counters
+// (cycles, instructions, cache misses) are read through perf_event_open
+// around the cycle loop; this is skipped with a note if the kernel does
+// not allow it (see /proc/sys/kernel/perf_event_paranoid).
+//
+// --warmup and --reps are not used: each case runs a fixed number of
+// cycles after an untimed warmup of 1% of that. By default that is one
+// million cycles at 32 frames and the same stretch of audio (about 11
+// minutes) at larger buffer sizes, but at least kMinCycles; --cycles sets
+// a fixed count for every buffer size.
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "audio_backend.h"
+#include "audio_engine.h"
+#include "bench_util.h"
+#include "denormals.h"
+#include "engine_stats.h"
+#include "pattern_generator_wrapper.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+
+using namespace grids_jack;
+
+static const uint32_t kSampleRate = 48000;
+
+// Default cycle counts (see above)
+static const uint64_t kDefaultFrames = 32000000;
+static const uint64_t kMinCycles = 100000;
+static const uint64_t kQuickCycles = 20000;
+
+// Same callbacks as GridsClient in main.cpp
+class BenchClient : public AudioBackendClient {
+public:
+    explicit BenchClient(AudioEngine* engine) : engine_(engine) {}
+
+    void Process(float* const* outputs, uint32_t num_frames) {
+        // REALTIME-SAFE: No allocations, no locks, no system calls
+        engine_->Process(outputs[0], outputs[1], num_frames);
+    }
+
+    void ThreadInit() {
+        DisableDenormals();
+    }
+
+private:
+    AudioEngine* engine_;
+};
+
+// A pattern configuration
+struct Scenario {
+    const char* name;
+    float bpm;
+    size_t num_parts;      // Samples selected from the kit
+    uint8_t density;       // All drum parts
+    uint8_t randomness;
+    bool lfo;
+    float humanize;
+    float spread;
+};
+
+// Hardware counters for the calling thread, user space only
+class PerfCounters {
+public:
+    enum { kCycles, kInstructions, kCacheMisses, kCount };
+
+    PerfCounters() : available_(false) {
+        for (int i = 0; i < kCount; i++) fds_[i] = -1;
+    }
+    ~PerfCounters() { Close(); }
+
+    // Returns false (with errno from the failing call) if unavailable
+    bool Open() {
+        const uint64_t configs[kCount] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+        };
+        for (int i = 0; i < kCount; i++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == 0;  // The group starts with its leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            int group = i == 0 ? -1 : fds_[0];
+            fds_[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+            if (fds_[i] < 0) {
+                Close();
+                return false;
+            }
+        }
+        available_ = true;
+        return true;
+    }
+
+    void Start() {
+        if (!available_) return;
+        ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    // Stop counting and read the totals since Start
+    bool Stop(uint64_t values[kCount]) {
+        if (!available_) return false;
+        ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t buffer[1 + kCount];
+        if (read(fds_[0], buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)) ||
+            buffer[0] != kCount) {
+            return false;
+        }
+        for (int i = 0; i < kCount; i++) values[i] = buffer[1 + i];
+        return true;
+    }
+
+private:
+    void Close() {
+        for (int i = 0; i < kCount; i++) {
+            if (fds_[i] >= 0) close(fds_[i]);
+            fds_[i] = -1;
+        }
+        available_ = false;
+    }
+
+    int fds_[kCount];
+    bool available_;
+};
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    BenchExtraOption extra[] = {
+        {"kit", "dir", "Sample directory (default: data)", "data"},
+        {"cycles", "n", "Timed cycles per case (default: ~11 min of audio)", nullptr},
+        {"perf", nullptr, "Collect hardware counters with perf_event_open", nullptr},
+    };
+    if (!ParseBenchArgs(argc, argv,
+                        "Benchmark the full audio callback against simulated JACK cycles.",
+                        &options, extra, sizeof(extra) / sizeof(extra[0]))) {
+        return 1;
+    }
+    const char* kit = extra[0].value;
+    uint64_t fixed_cycles = options.quick ? kQuickCycles : 0;
+    if (extra[1].value != nullptr) {
+        fixed_cycles = strtoull(extra[1].value, nullptr, 10);
+        if (fixed_cycles == 0) {
+            fprintf(stderr, "Error: --cycles must be at least 1\n");
+            return 1;
+        }
+    }
+    bool use_perf = extra[2].value != nullptr;
+
+    fprintf(stderr, "Audio Callback Benchmark\n");
+    fprintf(stderr, "========================\n\n");
+
+    SampleBank bank;
+    if (!bank.LoadDirectory(kit, kSampleRate)) {
+        fprintf(stderr, "Error: No samples could be loaded from %s\n", kit);
+        return 1;
+    }
+    std::vector<uint8_t> notes = bank.GetAllNotes();
+
+    PerfCounters perf;
+    if (use_perf && !perf.Open()) {
+        fprintf(stderr, "Note: perf_event_open unavailable (%s); hardware counters skipped\n",
+                strerror(errno));
+        use_perf = false;
+    }
+
+    std::vector<uint32_t> buffer_sizes = {32, 64, 128, 256, 1024};
+    std::vector<Scenario> scenarios = {
+        {"typical", 120.0f, 4, 128, 0, true, 0.2f, 0.5f},
+        {"busy", 174.0f, 16, 255, 64, true, 1.0f, 1.0f},
+    };
+    if (options.quick) {
+        buffer_sizes = {64, 1024};
+    }
+
+    // Same thread setup as the backend's audio thread
+    SamplePlayer player;
+    PatternGeneratorWrapper pattern;
+    AudioEngine engine;
+    BenchClient client(&engine);
+    client.ThreadInit();
+
+    BenchReport report("engine");
+
+    fprintf(stderr, "\nCycle time in %% of the period budget\n\n");
+    fprintf(stderr, "  scenario  buffer    cycles  period_us   median      p90      p99    p99.9"
+            "      max    idle%%");
+    if (use_perf) {
+        fprintf(stderr, "   kcyc/cb    IPC  miss/cb");
+    }
+    fprintf(stderr, "\n");
+
+    for (const Scenario& scenario : scenarios) {
+        for (uint32_t buffer_size : buffer_sizes) {
+            uint64_t cycles = fixed_cycles;
+            if (cycles == 0) {
+                cycles = kDefaultFrames / buffer_size;
+                if (cycles < kMinCycles) cycles = kMinCycles;
+            }
+
+            player.Init(&bank, kSampleRate);
+            pattern.Init(&player, kSampleRate, scenario.bpm);
+            pattern.Seed(1);
+            pattern.SetLfoEnabled(scenario.lfo);
+            pattern.SetHumanize(scenario.humanize);
+            pattern.AssignSamplesToParts(notes, scenario.num_parts, 32);
+            pattern.SetSpread(scenario.spread);
+            pattern.SetRandomness(scenario.randomness);
+            for (int p = 0; p < DRUM_PART_COUNT; p++) {
+                pattern.SetDensity(static_cast<DrumPart>(p), scenario.density);
+            }
+            engine.Init(&player, &pattern, kSampleRate);
+
+            // Port buffers stay at the same address across cycles, as in JACK
+            std::vector<float> port_left(buffer_size);
+            std::vector<float> port_right(buffer_size);
+            float* outputs[2] = {port_left.data(), port_right.data()};
+            AudioBackendClient* callbacks = &client;
+
+            for (uint64_t c = 0; c < cycles / 100; c++) {
+                callbacks->Process(outputs, buffer_size);
+            }
+            EngineStats before;
+            engine.ReadStats(&before);
+
+            std::vector<double> load(cycles);
+            double period_ns = buffer_size * 1e9 / kSampleRate;
+            perf.Start();
+            for (uint64_t c = 0; c < cycles; c++) {
+                uint64_t start = MonotonicNanos();
+                callbacks->Process(outputs, buffer_size);
+                load[c] = (MonotonicNanos() - start) * 100.0 / period_ns;
+            }
+            uint64_t counters[PerfCounters::kCount] = {0, 0, 0};
+            bool have_counters = use_perf && perf.Stop(counters);
+
+            EngineStats after;
+            engine.ReadStats(&after);
+            double idle_percent = 100.0 * (after.idle_callbacks - before.idle_callbacks) /
+                static_cast<double>(cycles);
+
+            BenchResult& result = report.Add("callback", "% of period");
+            result.Param("scenario", scenario.name);
+            result.Param("buffer", buffer_size);
+            result.Param("period_ns", period_ns);
+            result.Param("cycles", static_cast<double>(cycles));
+            result.Param("idle_percent", idle_percent);
+            result.Param("voices_peak", after.voices_peak);
+            result.stats = ComputeBenchStats(load);
+            const BenchStats& s = result.stats;
+
+            fprintf(stderr, "  %-8s  %6u  %8llu  %9.1f  %7.3f  %7.3f  %7.3f  %7.3f  %7.2f  %7.1f",
+                    scenario.name, buffer_size, static_cast<unsigned long long>(cycles),
+                    period_ns / 1e3, s.median, s.p90, s.p99,
+                    s.p999, s.max, idle_percent);
+            if (have_counters) {
+                double per_cycle = 1.0 / static_cast<double>(cycles);
+                double ipc = counters[PerfCounters::kCycles] > 0 ?
+                    static_cast<double>(counters[PerfCounters::kInstructions]) /
+                    counters[PerfCounters::kCycles] : 0.0;
+                result.Param("cpu_cycles_per_callback", counters[PerfCounters::kCycles] * per_cycle);
+                result.Param("instructions_per_callback",
+                             counters[PerfCounters::kInstructions] * per_cycle);
+                result.Param("ipc", ipc);
+                result.Param("cache_misses_per_callback",
+                             counters[PerfCounters::kCacheMisses] * per_cycle);
+                fprintf(stderr, "  %8.1f  %5.2f  %7.1f",
+                        counters[PerfCounters::kCycles] * per_cycle / 1e3, ipc,
+                        counters[PerfCounters::kCacheMisses] * per_cycle);
+            }
+            fprintf(stderr, "\n");
+        }
+    }
+
+    if (options.json_path != nullptr && !report.WriteJson(options.json_path)) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,264 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Benchmarks for pattern generation and trigger scheduling
+//
+// - PatternGeneratorWrapper::Process in ns per callback across buffer
+//   sizes, tempos, mapping counts and LFO/humanize settings. Triggers go
+//   to a counting TriggerListener with no sample player, so mixing is
+//   not included (see bench_sample_player).
+// - ComputePatternBits in ns per call while sweeping the map.
+// - Raw drum map reads over the full 256x256 x/y space, in reads/s.
+//
+// The Grids generator keeps its state in statics, so cases run one at a
+// time in a single wrapper instance.
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "bench_util.h"
+#include "pattern_generator_wrapper.h"
+
+using namespace grids_jack;
+
+static const uint32_t kSampleRate = 48000;
+
+// Audio rendered per repetition of a Process case
+static const uint32_t kSecondsPerRep = 10;
+
+// Counts triggers so the scheduler has somewhere to send them
+class CountingListener : public TriggerListener {
+public:
+    CountingListener() : count(0) {}
+    void OnTrigger(uint64_t frame, uint16_t mapping, uint8_t midi_note,
+                   float velocity) override {
+        (void)frame;
+        (void)mapping;
+        (void)midi_note;
+        (void)velocity;
+        count++;
+    }
+    uint64_t count;
+};
+
+struct ProcessCase {
+    uint32_t buffer_size;
+    float bpm;
+    size_t mappings;
+    bool lfo;
+    float humanize;
+};
+
+static void SetUpWrapper(PatternGeneratorWrapper* wrapper, CountingListener* listener,
+                         const ProcessCase& c) {
+    wrapper->Init(nullptr, kSampleRate, c.bpm);
+    wrapper->Seed(1);
+    wrapper->SetTriggerListener(listener);
+
+    // Enough notes that every requested mapping gets a sample
+    std::vector<uint8_t> notes;
+    for (size_t n = 0; n < c.mappings; n++) {
+        notes.push_back(static_cast<uint8_t>(36 + n));
+    }
+    wrapper->AssignSamplesToParts(notes, c.mappings, 32);
+    wrapper->SetSpread(0.5f);
+    wrapper->SetLfoEnabled(c.lfo);
+    wrapper->SetHumanize(c.humanize);
+}
+
+// Returns ns per callback for each timed repetition
+static std::vector<double> MeasureProcess(const ProcessCase& c, const BenchOptions& options,
+                                          double* triggers_per_second) {
+    PatternGeneratorWrapper wrapper;
+    CountingListener listener;
+    SetUpWrapper(&wrapper, &listener, c);
+
+    uint32_t callbacks = kSecondsPerRep * kSampleRate / c.buffer_size;
+
+    std::vector<double> values;
+    uint64_t timed_triggers = 0;
+    double timed_seconds = 0.0;
+    for (uint32_t rep = 0; rep < options.warmup + options.reps; rep++) {
+        uint64_t triggers_before = listener.count;
+        double start = BenchNowSeconds();
+        for (uint32_t b = 0; b < callbacks; b++) {
+            wrapper.Process(c.buffer_size);
+        }
+        double elapsed = BenchNowSeconds() - start;
+
+        if (rep >= options.warmup) {
+            values.push_back(elapsed * 1e9 / callbacks);
+            timed_triggers += listener.count - triggers_before;
+            timed_seconds += static_cast<double>(callbacks) * c.buffer_size / kSampleRate;
+        }
+    }
+    *triggers_per_second = timed_seconds > 0.0 ? timed_triggers / timed_seconds : 0.0;
+    return values;
+}
+
+// Returns ns per ComputePatternBits call for each timed repetition
+static std::vector<double> MeasurePatternBits(uint8_t num_steps, const BenchOptions& options) {
+    PatternGeneratorWrapper wrapper;
+    CountingListener listener;
+    ProcessCase c = {256, 120.0f, 4, false, 0.0f};
+    SetUpWrapper(&wrapper, &listener, c);
+    std::vector<uint8_t> notes = {36, 37, 38, 39};
+    wrapper.AssignSamplesToParts(notes, notes.size(), num_steps);
+
+    // A diagonal walk so neighbouring calls read different map cells
+    const uint32_t calls = 1 << 16;
+    std::vector<double> values;
+    uint32_t sink = 0;
+    for (uint32_t rep = 0; rep < options.warmup + options.reps; rep++) {
+        double start = BenchNowSeconds();
+        for (uint32_t i = 0; i < calls; i++) {
+            uint32_t bits[DRUM_PART_COUNT];
+            wrapper.ComputePatternBits(bits, static_cast<uint8_t>(i),
+                                       static_cast<uint8_t>(i * 7 + (i >> 8)));
+            sink += bits[0] ^ bits[1] ^ bits[2];
+        }
+        double elapsed = BenchNowSeconds() - start;
+        BenchDoNotOptimize(&sink);
+
+        if (rep >= options.warmup) {
+            values.push_back(elapsed * 1e9 / calls);
+        }
+    }
+    return values;
+}
+
+// Returns millions of drum map reads per second for each timed repetition
+// Each repetition reads every step and part at every x/y position
+static std::vector<double> MeasureDrumMapReads(const BenchOptions& options, uint32_t xy_step) {
+    grids::PatternGenerator::Init();
+
+    std::vector<double> values;
+    uint32_t sink = 0;
+    for (uint32_t rep = 0; rep < options.warmup + options.reps; rep++) {
+        uint64_t reads = 0;
+        double start = BenchNowSeconds();
+        for (uint32_t x = 0; x < 256; x += xy_step) {
+            for (uint32_t y = 0; y < 256; y += xy_step) {
+                for (uint8_t step = 0; step < grids::kStepsPerPattern; step++) {
+                    for (uint8_t inst = 0; inst < DRUM_PART_COUNT; inst++) {
+                        sink += grids::PatternGenerator::GetDrumMapLevel(
+                            step, inst, static_cast<uint8_t>(x), static_cast<uint8_t>(y));
+                    }
+                }
+                reads += grids::kStepsPerPattern * DRUM_PART_COUNT;
+            }
+        }
+        double elapsed = BenchNowSeconds() - start;
+        BenchDoNotOptimize(&sink);
+
+        if (rep >= options.warmup) {
+            values.push_back(reads / elapsed * 1e-6);
+        }
+    }
+    return values;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!ParseBenchArgs(argc, argv,
+                        "Benchmark pattern generation, scheduling and drum map reads.",
+                        &options)) {
+        return 1;
+    }
+
+    fprintf(stderr, "Pattern Benchmark\n");
+    fprintf(stderr, "=================\n\n");
+    fprintf(stderr, "%u warmup + %u timed repetitions per case\n\n",
+            options.warmup, options.reps);
+
+    std::vector<uint32_t> buffer_sizes = {32, 64, 128, 256, 1024};
+    std::vector<float> bpms = {60.0f, 120.0f, 174.0f, 300.0f};
+    std::vector<size_t> mapping_counts = {1, 4, 16};
+    if (options.quick) {
+        buffer_sizes = {64, 1024};
+        bpms = {120.0f};
+        mapping_counts = {4};
+    }
+    struct Modulation {
+        const char* name;
+        bool lfo;
+        float humanize;
+    };
+    const Modulation modulations[] = {
+        {"none", false, 0.0f},
+        {"lfo", true, 0.0f},
+        {"humanize", false, 0.5f},
+        {"lfo+humanize", true, 1.0f},
+    };
+
+    BenchReport report("pattern");
+
+    fprintf(stderr, "PatternGeneratorWrapper::Process (ns per callback: median, p10, p90)\n\n");
+    fprintf(stderr, "  buffer    bpm  maps  modulation        median        p10        p90   trig/s\n");
+    for (uint32_t buffer_size : buffer_sizes) {
+        for (float bpm : bpms) {
+            for (size_t mappings : mapping_counts) {
+                for (const Modulation& m : modulations) {
+                    ProcessCase c = {buffer_size, bpm, mappings, m.lfo, m.humanize};
+                    double triggers_per_second = 0.0;
+                    BenchResult& result = report.Add("process", "ns/callback");
+                    result.Param("buffer", buffer_size);
+                    result.Param("bpm", bpm);
+                    result.Param("mappings", static_cast<double>(mappings));
+                    result.Param("lfo", m.lfo ? 1 : 0);
+                    result.Param("humanize", m.humanize);
+                    result.stats = ComputeBenchStats(
+                        MeasureProcess(c, options, &triggers_per_second));
+                    result.Param("triggers_per_second", triggers_per_second);
+
+                    const BenchStats& s = result.stats;
+                    fprintf(stderr, "  %6u  %5.0f  %4zu  %-12s  %9.1f  %9.1f  %9.1f  %7.1f\n",
+                            buffer_size, bpm, mappings, m.name,
+                            s.median, s.p10, s.p90, triggers_per_second);
+                }
+            }
+        }
+    }
+
+    fprintf(stderr, "\nComputePatternBits (ns per call: median, p10, p90)\n\n");
+    fprintf(stderr, "  steps     median        p10        p90\n");
+    const uint8_t step_counts[] = {8, 16, 32};
+    for (uint8_t steps : step_counts) {
+        BenchResult& result = report.Add("compute_pattern_bits", "ns/call");
+        result.Param("steps", steps);
+        result.stats = ComputeBenchStats(MeasurePatternBits(steps, options));
+        const BenchStats& s = result.stats;
+        fprintf(stderr, "  %5u  %9.1f  %9.1f  %9.1f\n", steps, s.median, s.p10, s.p90);
+    }
+
+    // Every x/y cell (a coarser grid with --quick)
+    uint32_t xy_step = options.quick ? 4 : 1;
+    fprintf(stderr, "\nDrum map reads over the %ux%u x/y space, all steps and parts "
+            "(Mreads/s: median, p10, p90)\n\n", 256 / xy_step, 256 / xy_step);
+    {
+        BenchResult& result = report.Add("read_drum_map", "Mreads/s");
+        result.Param("xy_step", xy_step);
+        result.stats = ComputeBenchStats(MeasureDrumMapReads(options, xy_step));
+        const BenchStats& s = result.stats;
+        fprintf(stderr, "  %9.1f  %9.1f  %9.1f\n", s.median, s.p10, s.p90);
+    }
+
+    if (options.json_path != nullptr && !report.WriteJson(options.json_path)) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,340 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Benchmark for SampleBank::LoadDirectory on synthetic sample libraries
+//
+// Writes WAV libraries of varying file count, length, channel count,
+// sample rate and bit depth into a temporary directory, then times
+// end-to-end loading into a fresh SampleBank. Each library is loaded
+// cold (file pages dropped from the page cache with posix_fadvise before
+// every repetition) and warm (files already cached by the previous
+// repetition). Reports load time, throughput in MB/s of WAV data and the
+// peak RSS growth during the load.
+//
+// The bank's per-file log lines are discarded while timing.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "sample_bank.h"
+
+using namespace grids_jack;
+
+static const uint32_t kTargetRate = 48000;
+
+// One synthetic library
+struct Library {
+    const char* name;
+    uint32_t files;      // At most 128: one file per MIDI note
+    double seconds;      // Length of each file
+    uint16_t channels;
+    uint32_t rate;
+    uint16_t bits;       // 16, 24 (PCM) or 32 (float)
+};
+
+static void Put16(std::vector<uint8_t>* out, uint32_t v) {
+    out->push_back(v & 0xFF);
+    out->push_back((v >> 8) & 0xFF);
+}
+
+static void Put32(std::vector<uint8_t>* out, uint32_t v) {
+    Put16(out, v & 0xFFFF);
+    Put16(out, v >> 16);
+}
+
+// Decaying noise burst, like a drum hit
+static bool WriteWav(const std::string& path, const Library& lib, uint32_t* rng) {
+    uint32_t frames = static_cast<uint32_t>(lib.seconds * lib.rate);
+    uint32_t bytes_per_sample = lib.bits / 8;
+    uint32_t data_size = frames * lib.channels * bytes_per_sample;
+
+    std::vector<uint8_t> out;
+    out.reserve(44 + data_size);
+    out.insert(out.end(), {'R', 'I', 'F', 'F'});
+    Put32(&out, 36 + data_size);
+    out.insert(out.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    Put32(&out, 16);
+    Put16(&out, lib.bits == 32 ? 3 : 1);  // IEEE float or PCM
+    Put16(&out, lib.channels);
+    Put32(&out, lib.rate);
+    Put32(&out, lib.rate * lib.channels * bytes_per_sample);
+    Put16(&out, lib.channels * bytes_per_sample);
+    Put16(&out, lib.bits);
+    out.insert(out.end(), {'d', 'a', 't', 'a'});
+    Put32(&out, data_size);
+
+    float decay = 1.0f;
+    float decay_rate = 1.0f - 8.0f / (frames + 1);
+    for (uint32_t i = 0; i < frames; i++) {
+        for (uint16_t c = 0; c < lib.channels; c++) {
+            *rng = *rng * 1664525u + 1013904223u;
+            float s = (static_cast<float>(*rng >> 8) / 16777216.0f - 0.5f) * decay;
+            if (lib.bits == 32) {
+                uint32_t word;
+                memcpy(&word, &s, sizeof(word));
+                Put32(&out, word);
+            } else {
+                int32_t v = static_cast<int32_t>(s * ((1 << (lib.bits - 1)) - 1));
+                for (uint32_t b = 0; b < bytes_per_sample; b++) {
+                    out.push_back((v >> (8 * b)) & 0xFF);
+                }
+            }
+        }
+        decay *= decay_rate;
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Error: Could not create %s\n", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+// Returns the library's total size in bytes, 0 on error
+static uint64_t GenerateLibrary(const std::string& dir, const Library& lib) {
+    uint32_t rng = 12345;
+    uint64_t total = 0;
+    for (uint32_t n = 0; n < lib.files; n++) {
+        char name[64];
+        snprintf(name, sizeof(name), "/%u.1.1.1.0.wav", n);
+        std::string path = dir + name;
+        if (!WriteWav(path, lib, &rng)) {
+            return 0;
+        }
+        total += 44 + static_cast<uint64_t>(lib.seconds * lib.rate) * lib.channels * (lib.bits / 8);
+    }
+    return total;
+}
+
+static void ForEachFile(const std::string& dir, void (*fn)(const std::string&)) {
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) return;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != nullptr) {
+        if (entry->d_name[0] == '.') continue;
+        fn(dir + "/" + entry->d_name);
+    }
+    closedir(d);
+}
+
+// Ask the kernel to drop a file's pages from the page cache
+static void DropFromPageCache(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static void RemoveFile(const std::string& path) {
+    unlink(path.c_str());
+}
+
+// Read a "Vm...:  1234 kB" line from /proc/self/status, in bytes
+static uint64_t ReadProcStatus(const char* key) {
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file == nullptr) return 0;
+    char line[256];
+    uint64_t value = 0;
+    size_t key_len = strlen(key);
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        if (strncmp(line, key, key_len) == 0 && line[key_len] == ':') {
+            value = strtoull(line + key_len + 1, nullptr, 10) * 1024;
+            break;
+        }
+    }
+    fclose(file);
+    return value;
+}
+
+// Reset the peak RSS (VmHWM) to the current RSS; false if unsupported
+static bool ResetPeakRss() {
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file == nullptr) return false;
+    bool ok = fputs("5", file) >= 0;
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+struct LoadRun {
+    double seconds;
+    uint64_t peak_rss_growth;  // Bytes above the RSS before loading
+    size_t samples;
+};
+
+static LoadRun LoadOnce(const std::string& dir, bool cold, int null_fd) {
+    if (cold) {
+        ForEachFile(dir, DropFromPageCache);
+    }
+
+    LoadRun run;
+    bool peak_valid = ResetPeakRss();
+    uint64_t rss_before = ReadProcStatus("VmRSS");
+
+    // Keep the bank's log lines out of the report
+    fflush(stderr);
+    int saved_stderr = dup(STDERR_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+
+    double start = BenchNowSeconds();
+    {
+        SampleBank bank;
+        bank.LoadDirectory(dir, kTargetRate);
+        run.seconds = BenchNowSeconds() - start;
+        run.samples = bank.GetSampleCount();
+        uint64_t peak = ReadProcStatus("VmHWM");
+        run.peak_rss_growth = peak_valid && peak > rss_before ? peak - rss_before : 0;
+    }
+
+    fflush(stderr);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stderr);
+    return run;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!ParseBenchArgs(argc, argv, "Benchmark SampleBank loading of synthetic WAV libraries.",
+                        &options)) {
+        return 1;
+    }
+
+    fprintf(stderr, "Sample Loading Benchmark\n");
+    fprintf(stderr, "========================\n\n");
+    fprintf(stderr, "%u warmup + %u timed repetitions per case\n\n",
+            options.warmup, options.reps);
+
+    // A base library, then one dimension varied at a time
+    std::vector<Library> libraries = {
+        {"base", 64, 0.5, 1, 48000, 16},
+        {"few", 16, 0.5, 1, 48000, 16},
+        {"full", 128, 0.5, 1, 48000, 16},
+        {"long", 64, 4.0, 1, 48000, 16},
+        {"stereo", 64, 0.5, 2, 48000, 16},
+        {"44k1", 64, 0.5, 1, 44100, 16},
+        {"24bit", 64, 0.5, 1, 48000, 24},
+        {"float", 64, 0.5, 1, 48000, 32},
+        {"stereo-44k1-24bit", 128, 2.0, 2, 44100, 24},
+    };
+    if (options.quick) {
+        libraries = {
+            {"base", 16, 0.5, 1, 48000, 16},
+            {"stereo-44k1-24bit", 16, 0.5, 2, 44100, 24},
+        };
+    }
+
+    const char* tmp = getenv("TMPDIR");
+    std::string tmp_template = std::string(tmp != nullptr ? tmp : "/tmp") + "/grids-bench-XXXXXX";
+    std::vector<char> dir_buffer(tmp_template.begin(), tmp_template.end());
+    dir_buffer.push_back('\0');
+    if (mkdtemp(dir_buffer.data()) == nullptr) {
+        fprintf(stderr, "Error: Could not create a temporary directory\n");
+        return 1;
+    }
+    std::string dir = dir_buffer.data();
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0) {
+        fprintf(stderr, "Error: Could not open /dev/null\n");
+        rmdir(dir.c_str());
+        return 1;
+    }
+
+    BenchReport report("sample_bank");
+    bool ok = true;
+
+    fprintf(stderr, "LoadDirectory (median: ms, MB/s, peak RSS growth in MB)\n\n");
+    fprintf(stderr, "  library             files    secs  ch   rate  bits   MB   cache"
+            "         ms     MB/s   peakMB\n");
+
+    for (const Library& lib : libraries) {
+        uint64_t bytes = GenerateLibrary(dir, lib);
+        if (bytes == 0) {
+            ok = false;
+            break;
+        }
+        double megabytes = bytes / 1e6;
+
+        for (int cold = 1; cold >= 0; cold--) {
+            std::vector<double> times;
+            std::vector<double> rates;
+            std::vector<double> peaks;
+            size_t loaded = 0;
+            for (uint32_t rep = 0; rep < options.warmup + options.reps; rep++) {
+                LoadRun run = LoadOnce(dir, cold != 0, null_fd);
+                loaded = run.samples;
+                if (rep >= options.warmup) {
+                    times.push_back(run.seconds * 1e3);
+                    rates.push_back(megabytes / run.seconds);
+                    peaks.push_back(run.peak_rss_growth / 1e6);
+                }
+            }
+            if (loaded != lib.files) {
+                fprintf(stderr, "Error: %s loaded %zu of %u files\n", lib.name, loaded, lib.files);
+                ok = false;
+            }
+
+            const char* cache = cold ? "cold" : "warm";
+            const char* metrics[] = {"load_time", "throughput", "peak_rss_growth"};
+            const char* units[] = {"ms", "MB/s", "MB"};
+            std::vector<double>* values[] = {&times, &rates, &peaks};
+            BenchStats stats[3];
+            for (int m = 0; m < 3; m++) {
+                BenchResult& result = report.Add(metrics[m], units[m]);
+                result.Param("library", lib.name);
+                result.Param("files", lib.files);
+                result.Param("seconds", lib.seconds);
+                result.Param("channels", lib.channels);
+                result.Param("rate", lib.rate);
+                result.Param("bits", lib.bits);
+                result.Param("bytes", static_cast<double>(bytes));
+                result.Param("cache", cache);
+                result.Param("path", "sequential");
+                result.stats = ComputeBenchStats(*values[m]);
+                stats[m] = result.stats;
+            }
+
+            fprintf(stderr, "  %-18s  %5u  %6.2f  %2u  %5u  %4u  %5.1f  %-4s  %9.2f  %7.1f  %7.2f\n",
+                    lib.name, lib.files, lib.seconds, lib.channels, lib.rate, lib.bits,
+                    megabytes, cache, stats[0].median, stats[1].median, stats[2].median);
+        }
+
+        ForEachFile(dir, RemoveFile);
+    }
+
+    ForEachFile(dir, RemoveFile);
+    rmdir(dir.c_str());
+    close(null_fd);
+
+    if (!ok) {
+        return 1;
+    }
+    if (options.json_path != nullptr && !report.WriteJson(options.json_path)) {
+        return 1;
+    }
+
+    return 0;
+}
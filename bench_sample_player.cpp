@@ -0,0 +1,273 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Microbenchmarks for SamplePlayer mixing
+//
+// Measures Process (mono) and ProcessStereo in ns per voice-frame across
+// voice counts, buffer sizes, sample lengths and pan settings, plus the
+// stereo tile size sweep. Build in Release mode for meaningful numbers.
+//
+// Each repetition triggers the voices and renders until about
+// kFramesPerRep voice-frames have been mixed; short samples play to their
+// end and are re-triggered, so they also exercise the partial-block
+// kernels and voice reset.
+// Coalescing is disabled: every trigger must get its own voice.
+
+#include <stdio.h>
+
+#include <cmath>
+#include <vector>
+
+#include "bench_util.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+
+using namespace grids_jack;
+
+// Long enough that no voice finishes during a repetition
+static const uint32_t kLongSampleLength = 1 << 20;
+
+// A typical drum hit (~85 ms at 48 kHz)
+static const uint32_t kShortSampleLength = 4096;
+
+// Distinct samples, so voices do not share cache lines
+static const uint8_t kNumNotes = 4;
+static const uint8_t kLongBaseNote = 60;
+static const uint8_t kShortBaseNote = 70;
+
+// Voice-frames mixed per repetition
+static const double kFramesPerRep = 1 << 21;
+
+enum PanMode { kPanCenter, kPanSpread, kPanHardLeft };
+
+static const char* PanName(PanMode pan) {
+    switch (pan) {
+        case kPanCenter: return "center";
+        case kPanSpread: return "spread";
+        case kPanHardLeft: return "left";
+    }
+    return "?";
+}
+
+struct MixCase {
+    bool stereo;
+    uint32_t voices;
+    uint32_t buffer_size;
+    bool long_sample;
+    PanMode pan;
+    uint32_t tile_frames;
+};
+
+static std::vector<float> MakeNoise(uint32_t length, uint32_t* rng) {
+    std::vector<float> data(length);
+    for (uint32_t i = 0; i < length; i++) {
+        *rng = *rng * 1664525u + 1013904223u;
+        data[i] = static_cast<float>(*rng >> 8) / 16777216.0f - 0.5f;
+    }
+    return data;
+}
+
+// Start mix.voices voices from position 0
+static void TriggerVoices(SamplePlayer* player, const MixCase& mix) {
+    uint8_t base = mix.long_sample ? kLongBaseNote : kShortBaseNote;
+    for (uint32_t v = 0; v < mix.voices; v++) {
+        float pan = 0.0f;
+        if (mix.pan == kPanSpread) {
+            pan = -1.0f + 2.0f * static_cast<float>(v % 9) / 8.0f;
+        } else if (mix.pan == kPanHardLeft) {
+            pan = -1.0f;
+        }
+        player->Trigger(static_cast<uint8_t>(base + v % kNumNotes), 0.5f, pan);
+    }
+}
+
+// Time one case; returns ns per voice-frame for each timed repetition
+static std::vector<double> MeasureMix(const SampleBank& bank, const MixCase& mix,
+                                      const BenchOptions& options) {
+    uint32_t length = mix.long_sample ? kLongSampleLength : kShortSampleLength;
+
+    // Blocks per round: the frame budget, but never past the sample end;
+    // short samples are re-triggered for more rounds to fill the budget
+    double frames_per_voice = kFramesPerRep / mix.voices;
+    uint32_t rounds = 1;
+    if (frames_per_voice > length) {
+        rounds = static_cast<uint32_t>(frames_per_voice / length);
+        frames_per_voice = length;
+    }
+    uint32_t blocks = static_cast<uint32_t>(
+        std::ceil(frames_per_voice / mix.buffer_size));
+    if (blocks == 0) blocks = 1;
+
+    uint64_t rendered_per_voice = static_cast<uint64_t>(blocks) * mix.buffer_size;
+    if (rendered_per_voice > length) rendered_per_voice = length;
+    double voice_frames = static_cast<double>(mix.voices) * rendered_per_voice * rounds;
+
+    SamplePlayer player;
+    player.Init(&bank, 48000);
+    player.SetCoalescing(false);
+    player.SetTileSize(mix.tile_frames);
+
+    std::vector<float> left(mix.buffer_size);
+    std::vector<float> right(mix.buffer_size);
+
+    std::vector<double> values;
+    for (uint32_t rep = 0; rep < options.warmup + options.reps; rep++) {
+        double elapsed = 0.0;
+        for (uint32_t round = 0; round < rounds; round++) {
+            // Triggering is not part of the measurement
+            player.Init(&bank, 48000);
+            TriggerVoices(&player, mix);
+
+            double start = BenchNowSeconds();
+            if (mix.stereo) {
+                for (uint32_t b = 0; b < blocks; b++) {
+                    player.ProcessStereo(left.data(), right.data(), mix.buffer_size);
+                }
+            } else {
+                for (uint32_t b = 0; b < blocks; b++) {
+                    player.Process(left.data(), mix.buffer_size);
+                }
+            }
+            elapsed += BenchNowSeconds() - start;
+            BenchDoNotOptimize(left.data());
+            BenchDoNotOptimize(right.data());
+        }
+
+        if (rep >= options.warmup) {
+            values.push_back(elapsed * 1e9 / voice_frames);
+        }
+    }
+    return values;
+}
+
+static BenchResult& RunCase(BenchReport* report, const SampleBank& bank,
+                            const char* name, const MixCase& mix,
+                            const BenchOptions& options) {
+    BenchResult& result = report->Add(name, "ns/voice-frame");
+    result.Param("voices", mix.voices);
+    result.Param("buffer", mix.buffer_size);
+    result.Param("sample_frames", mix.long_sample ? kLongSampleLength : kShortSampleLength);
+    result.Param("pan", PanName(mix.pan));
+    result.Param("tile", mix.tile_frames);
+    result.stats = ComputeBenchStats(MeasureMix(bank, mix, options));
+    return result;
+}
+
+static void PrintRow(const MixCase& mix, const BenchStats& s) {
+    fprintf(stderr, "  %-6s  %6u  %6u  %-5s  %-6s  %9.3f  %9.3f  %9.3f\n",
+            mix.stereo ? "stereo" : "mono", mix.buffer_size, mix.voices,
+            mix.long_sample ? "long" : "short", PanName(mix.pan),
+            s.median, s.p10, s.p90);
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!ParseBenchArgs(argc, argv, "Benchmark SamplePlayer mixing (ns per voice-frame).",
+                        &options)) {
+        return 1;
+    }
+
+    fprintf(stderr, "SamplePlayer Benchmark\n");
+    fprintf(stderr, "======================\n\n");
+    fprintf(stderr, "%u warmup + %u timed repetitions per case\n\n",
+            options.warmup, options.reps);
+
+    SampleBank bank;
+    uint32_t rng = 12345;
+    for (uint8_t n = 0; n < kNumNotes; n++) {
+        bank.AddSample(static_cast<uint8_t>(kLongBaseNote + n),
+                       MakeNoise(kLongSampleLength, &rng), "noise-long");
+        bank.AddSample(static_cast<uint8_t>(kShortBaseNote + n),
+                       MakeNoise(kShortSampleLength, &rng), "noise-short");
+    }
+
+    // The voice pool holds kMaxVoices voices; more triggers would steal
+    std::vector<uint32_t> voice_counts;
+    std::vector<uint32_t> buffer_sizes;
+    if (options.quick) {
+        voice_counts = {1, 16, static_cast<uint32_t>(kMaxVoices)};
+        buffer_sizes = {64, 1024};
+    } else {
+        voice_counts = {1, 4, 16, 64, static_cast<uint32_t>(kMaxVoices)};
+        buffer_sizes = {16, 64, 256, 1024, 4096};
+    }
+    const PanMode pans[] = {kPanCenter, kPanSpread, kPanHardLeft};
+
+    BenchReport report("sample_player");
+
+    fprintf(stderr, "Mixing (ns per voice-frame: median, p10, p90)\n\n");
+    fprintf(stderr, "  mode    buffer  voices  len    pan        median        p10        p90\n");
+
+    for (int stereo = 1; stereo >= 0; stereo--) {
+        for (uint32_t buffer_size : buffer_sizes) {
+            for (uint32_t voices : voice_counts) {
+                for (int long_sample = 1; long_sample >= 0; long_sample--) {
+                    for (PanMode pan : pans) {
+                        // Pan does not affect the mono kernels
+                        if (!stereo && pan != kPanCenter) continue;
+                        MixCase mix = {stereo != 0, voices, buffer_size,
+                                       long_sample != 0, pan, kDefaultTileFrames};
+                        const BenchResult& result =
+                            RunCase(&report, bank, stereo ? "process_stereo" : "process",
+                                    mix, options);
+                        PrintRow(mix, result.stats);
+                    }
+                }
+            }
+        }
+    }
+
+    // Tiled stereo rendering against whole-buffer loop order
+    const uint32_t tile_sizes[] = {0, 32, 64, 128, 256};
+    const size_t num_tiles = sizeof(tile_sizes) / sizeof(tile_sizes[0]);
+    std::vector<uint32_t> tile_buffers = {256, 1024, 4096};
+    std::vector<uint32_t> tile_voices = {16, 64, static_cast<uint32_t>(kMaxVoices)};
+    if (options.quick) {
+        tile_buffers = {1024};
+        tile_voices = {64};
+    }
+
+    fprintf(stderr, "\nTiled stereo rendering (median ns per voice-frame, tile 0 = whole buffer)\n\n");
+    fprintf(stderr, "  buffer  voices");
+    for (size_t t = 0; t < num_tiles; t++) {
+        fprintf(stderr, "  tile %-4u", tile_sizes[t]);
+    }
+    fprintf(stderr, "  best\n");
+
+    for (uint32_t buffer_size : tile_buffers) {
+        for (uint32_t voices : tile_voices) {
+            double results[num_tiles];
+            size_t best = 0;
+            for (size_t t = 0; t < num_tiles; t++) {
+                MixCase mix = {true, voices, buffer_size, true, kPanSpread, tile_sizes[t]};
+                results[t] = RunCase(&report, bank, "process_stereo_tiled", mix,
+                                     options).stats.median;
+                if (results[t] < results[best]) best = t;
+            }
+
+            fprintf(stderr, "  %6u  %6u", buffer_size, voices);
+            for (size_t t = 0; t < num_tiles; t++) {
+                fprintf(stderr, "  %9.3f", results[t]);
+            }
+            fprintf(stderr, "  %u (%.2fx)\n", tile_sizes[best], results[0] / results[best]);
+        }
+    }
+
+    if (options.json_path != nullptr && !report.WriteJson(options.json_path)) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,276 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BENCH_UTIL_H_
+#define BENCH_UTIL_H_
+
+// Shared helpers for the bench_* executables: timing, repetition
+// statistics, common command line options and JSON reports.
+//
+// A benchmark case runs a few untimed warmup repetitions, then times
+// `reps` repetitions of the same work. Each repetition yields one value
+// (e.g. ns per voice-frame); the report gives the distribution of those
+// values, so a noisy machine shows up as a wide p10-p90 band rather than
+// a misleading mean.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace grids_jack {
+
+// Monotonic time in seconds
+inline double BenchNowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Keep the compiler from discarding a computed value
+inline void BenchDoNotOptimize(const void* p) {
+    __asm__ __volatile__("" : : "g"(p) : "memory");
+}
+
+// Distribution of per-repetition values
+struct BenchStats {
+    size_t count;
+    double min;
+    double p10;
+    double median;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+    double mean;
+
+    BenchStats() : count(0), min(0), p10(0), median(0), p90(0), p99(0),
+                   p999(0), max(0), mean(0) {}
+};
+
+// Linear-interpolated percentile of sorted values, q in [0, 1]
+inline double BenchPercentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    double pos = q * (sorted.size() - 1);
+    size_t lo = static_cast<size_t>(pos);
+    size_t hi = lo + 1 < sorted.size() ? lo + 1 : lo;
+    double frac = pos - lo;
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * frac;
+}
+
+inline BenchStats ComputeBenchStats(std::vector<double> values) {
+    BenchStats stats;
+    if (values.empty()) return stats;
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    stats.count = values.size();
+    stats.min = values.front();
+    stats.max = values.back();
+    stats.mean = sum / values.size();
+    stats.p10 = BenchPercentile(values, 0.10);
+    stats.median = BenchPercentile(values, 0.50);
+    stats.p90 = BenchPercentile(values, 0.90);
+    stats.p99 = BenchPercentile(values, 0.99);
+    stats.p999 = BenchPercentile(values, 0.999);
+    return stats;
+}
+
+// Options shared by every benchmark executable
+struct BenchOptions {
+    const char* json_path;  // Write a JSON report here ("-" = stdout)
+    uint32_t warmup;        // Untimed repetitions per case
+    uint32_t reps;          // Timed repetitions per case
+    bool quick;             // Reduced sweep (smoke testing)
+
+    BenchOptions() : json_path(nullptr), warmup(3), reps(15), quick(false) {}
+};
+
+// An option specific to one benchmark executable (long form only)
+struct BenchExtraOption {
+    const char* name;   // Long option name, without the dashes
+    const char* arg;    // Argument name for the usage text, nullptr for a flag
+    const char* help;   // Usage text
+    const char* value;  // Set by ParseBenchArgs: the argument ("1" for a
+                        // flag), left unchanged if the option is absent
+};
+
+inline void PrintBenchUsage(const char* program_name, const char* description,
+                            const BenchExtraOption* extra = nullptr,
+                            size_t num_extra = 0) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n", program_name);
+    fprintf(stderr, "%s\n", description);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --json <file>      Write results as JSON (- for stdout)\n");
+    fprintf(stderr, "  --warmup <n>       Untimed repetitions per case (default: 3)\n");
+    fprintf(stderr, "  --reps <n>         Timed repetitions per case (default: 15)\n");
+    fprintf(stderr, "  --quick            Reduced sweep with fewer repetitions\n");
+    for (size_t i = 0; i < num_extra; i++) {
+        std::string flag = std::string("--") + extra[i].name;
+        if (extra[i].arg != nullptr) {
+            flag += std::string(" <") + extra[i].arg + ">";
+        }
+        fprintf(stderr, "  %-18s %s\n", flag.c_str(), extra[i].help);
+    }
+    fprintf(stderr, "  -h                 Show this help message\n");
+}
+
+// Parse the shared options plus num_extra executable-specific ones;
+// returns false (after printing usage) on error
+inline bool ParseBenchArgs(int argc, char* argv[], const char* description,
+                           BenchOptions* options, BenchExtraOption* extra = nullptr,
+                           size_t num_extra = 0) {
+    enum { kOptJson = 256, kOptWarmup, kOptReps, kOptQuick, kOptExtra };
+    std::vector<struct option> long_options = {
+        {"json", required_argument, nullptr, kOptJson},
+        {"warmup", required_argument, nullptr, kOptWarmup},
+        {"reps", required_argument, nullptr, kOptReps},
+        {"quick", no_argument, nullptr, kOptQuick},
+        {"help", no_argument, nullptr, 'h'},
+    };
+    for (size_t i = 0; i < num_extra; i++) {
+        struct option o = {extra[i].name, extra[i].arg != nullptr ? required_argument : no_argument,
+                           nullptr, static_cast<int>(kOptExtra + i)};
+        long_options.push_back(o);
+    }
+    struct option end = {nullptr, 0, nullptr, 0};
+    long_options.push_back(end);
+
+    bool reps_set = false;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options.data(), nullptr)) != -1) {
+        if (opt >= kOptExtra && static_cast<size_t>(opt - kOptExtra) < num_extra) {
+            BenchExtraOption& e = extra[opt - kOptExtra];
+            e.value = e.arg != nullptr ? optarg : "1";
+            continue;
+        }
+        switch (opt) {
+            case kOptJson:
+                options->json_path = optarg;
+                break;
+            case kOptWarmup:
+                options->warmup = static_cast<uint32_t>(atoi(optarg));
+                break;
+            case kOptReps: {
+                int reps = atoi(optarg);
+                if (reps < 1) {
+                    fprintf(stderr, "Error: --reps must be at least 1\n");
+                    return false;
+                }
+                options->reps = static_cast<uint32_t>(reps);
+                reps_set = true;
+                break;
+            }
+            case kOptQuick:
+                options->quick = true;
+                break;
+            case 'h':
+                PrintBenchUsage(argv[0], description, extra, num_extra);
+                exit(0);
+            default:
+                PrintBenchUsage(argv[0], description, extra, num_extra);
+                return false;
+        }
+    }
+    if (options->quick && !reps_set) {
+        options->warmup = 1;
+        options->reps = 5;
+    }
+    return true;
+}
+
+// One benchmark case: parameters plus the statistics of its repetitions
+struct BenchResult {
+    std::string name;
+    std::string unit;
+    std::vector<std::pair<std::string, std::string>> params;  // JSON values
+    BenchStats stats;
+
+    void Param(const char* key, double value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.10g", value);
+        params.push_back(std::make_pair(key, text));
+    }
+
+    void Param(const char* key, const char* value) {
+        params.push_back(std::make_pair(key, std::string("\"") + value + "\""));
+    }
+};
+
+// Collects results and writes them as one JSON document:
+// {"suite": ..., "results": [{"name", "unit", "params": {...}, "stats": {...}}]}
+class BenchReport {
+public:
+    explicit BenchReport(const char* suite) : suite_(suite) {}
+
+    BenchResult& Add(const char* name, const char* unit) {
+        results_.push_back(BenchResult());
+        results_.back().name = name;
+        results_.back().unit = unit;
+        return results_.back();
+    }
+
+    const std::vector<BenchResult>& results() const { return results_; }
+
+    // Returns false if the file could not be written
+    bool WriteJson(const char* path) const {
+        FILE* out = (path[0] == '-' && path[1] == '\0') ? stdout : fopen(path, "w");
+        if (out == nullptr) {
+            fprintf(stderr, "Error: Could not create %s\n", path);
+            return false;
+        }
+        fprintf(out, "{\n  \"suite\": \"%s\",\n  \"results\": [\n", suite_.c_str());
+        for (size_t i = 0; i < results_.size(); i++) {
+            const BenchResult& r = results_[i];
+            fprintf(out, "    {\"name\": \"%s\", \"unit\": \"%s\", \"params\": {",
+                    r.name.c_str(), r.unit.c_str());
+            for (size_t p = 0; p < r.params.size(); p++) {
+                fprintf(out, "%s\"%s\": %s", p == 0 ? "" : ", ",
+                        r.params[p].first.c_str(), r.params[p].second.c_str());
+            }
+            const BenchStats& s = r.stats;
+            fprintf(out, "}, \"stats\": {\"count\": %zu, \"min\": %.6g, \"p10\": %.6g, "
+                    "\"median\": %.6g, \"p90\": %.6g, \"p99\": %.6g, \"p999\": %.6g, "
+                    "\"max\": %.6g, \"mean\": %.6g}}%s\n",
+                    s.count, s.min, s.p10, s.median, s.p90, s.p99, s.p999, s.max, s.mean,
+                    i + 1 < results_.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        bool ok = !ferror(out);
+        if (out != stdout) {
+            ok = (fclose(out) == 0) && ok;
+        } else {
+            fflush(out);
+        }
+        if (!ok) {
+            fprintf(stderr, "Error: Could not write %s\n", path);
+        }
+        return ok;
+    }
+
+private:
+    std::string suite_;
+    std::vector<BenchResult> results_;
+};
+
+}  // namespace grids_jack
+
+#endif  // BENCH_UTIL_H_
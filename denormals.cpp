@@ -0,0 +1,109 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "denormals.h"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#define GRIDS_DENORMALS_SSE 1
+#elif defined(__aarch64__)
+#define GRIDS_DENORMALS_AARCH64 1
+#elif defined(__arm__) && defined(__ARM_PCS_VFP)
+#define GRIDS_DENORMALS_VFP 1
+#endif
+
+namespace grids_jack {
+
+namespace {
+
+#if defined(GRIDS_DENORMALS_SSE)
+// MXCSR flush-to-zero (bit 15) and denormals-are-zero (bit 6)
+const unsigned long kFlushBits = 0x8040;
+#else
+// FPCR/FPSCR flush-to-zero (bit 24)
+const unsigned long kFlushBits = 1ul << 24;
+#endif
+
+unsigned long ReadFpState() {
+#if defined(GRIDS_DENORMALS_SSE)
+    return _mm_getcsr();
+#elif defined(GRIDS_DENORMALS_AARCH64)
+    unsigned long fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    return fpcr;
+#elif defined(GRIDS_DENORMALS_VFP)
+    unsigned long fpscr;
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r"(fpscr));
+    return fpscr;
+#else
+    return 0;
+#endif
+}
+
+void WriteFpState(unsigned long state) {
+#if defined(GRIDS_DENORMALS_SSE)
+    _mm_setcsr(static_cast<unsigned int>(state));
+#elif defined(GRIDS_DENORMALS_AARCH64)
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(state));
+#elif defined(GRIDS_DENORMALS_VFP)
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"(state));
+#else
+    (void)state;
+#endif
+}
+
+bool HaveFlushMode() {
+#if defined(GRIDS_DENORMALS_SSE) || defined(GRIDS_DENORMALS_AARCH64) || \
+    defined(GRIDS_DENORMALS_VFP)
+    return true;
+#else
+    return false;
+#endif
+}
+
+}  // namespace
+
+bool DisableDenormals() {
+    // REALTIME-SAFE: Touches only the thread's floating-point control register
+    if (!HaveFlushMode()) {
+        return false;
+    }
+    WriteFpState(ReadFpState() | kFlushBits);
+    return true;
+}
+
+bool DenormalsDisabled() {
+    return HaveFlushMode() && (ReadFpState() & kFlushBits) == kFlushBits;
+}
+
+void FlushDenormals(float* data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (fabsf(data[i]) < kDenormalGuard) {
+            data[i] = 0.0f;
+        }
+    }
+}
+
+ScopedDenormalsOff::ScopedDenormalsOff() : saved_state_(ReadFpState()) {
+    DisableDenormals();
+}
+
+ScopedDenormalsOff::~ScopedDenormalsOff() {
+    WriteFpState(saved_state_);
+}
+
+}  // namespace grids_jack
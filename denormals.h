@@ -0,0 +1,56 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DENORMALS_H_
+#define DENORMALS_H_
+
+#include <cstddef>
+
+namespace grids_jack {
+
+// Samples quieter than this (about -600 dB) are flushed to zero at load time,
+// so no product of a sample and a gain can land in the denormal range even
+// on CPUs without flush-to-zero support
+constexpr float kDenormalGuard = 1e-30f;
+
+// Channel gains below this (-120 dB) are treated as silent; together with
+// kDenormalGuard this keeps every sample * gain product a normal float
+constexpr float kGainGuard = 1e-6f;
+
+// Enable flush-to-zero / denormals-are-zero for the calling thread
+// Returns false if the CPU has no such mode (the load-time guard still applies)
+// Call once on every audio thread before it renders
+bool DisableDenormals();
+
+// Check whether flush-to-zero is active on the calling thread
+bool DenormalsDisabled();
+
+// Zero every value with magnitude below kDenormalGuard
+void FlushDenormals(float* data, size_t count);
+
+// Disables denormals for a scope and restores the previous mode on exit
+// (for offline rendering on a thread that does other floating-point work)
+class ScopedDenormalsOff {
+public:
+    ScopedDenormalsOff();
+    ~ScopedDenormalsOff();
+
+private:
+    unsigned long saved_state_;
+};
+
+}  // namespace grids_jack
+
+#endif  // DENORMALS_H_
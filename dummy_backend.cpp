@@ -0,0 +1,198 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "dummy_backend.h"
+
+#include <sched.h>
+#include <stdio.h>
+
+#include "monotonic_clock.h"
+
+namespace grids_jack {
+
+namespace {
+
+// Weight of the latest cycle in the averaged CPU load
+const float kLoadSmoothing = 0.05f;
+
+}  // namespace
+
+DummyBackend::DummyBackend(uint32_t sample_rate, uint32_t buffer_size, int rt_priority)
+    : sample_rate_(sample_rate),
+      buffer_size_(buffer_size),
+      rt_priority_(rt_priority),
+      active_priority_(0),
+      callbacks_(nullptr),
+      thread_started_(false),
+      running_(false),
+      frame_(0),
+      cycles_(0),
+      xruns_(0),
+      cpu_load_(0.0f) {}
+
+DummyBackend::~DummyBackend() {
+    Close();
+}
+
+bool DummyBackend::Open(const char* client_name, AudioBackendClient* client) {
+    (void)client_name;
+    if (sample_rate_ == 0 || buffer_size_ == 0) {
+        fprintf(stderr, "Error: Dummy backend needs a sample rate and buffer size\n");
+        return false;
+    }
+    callbacks_ = client;
+    return true;
+}
+
+bool DummyBackend::RegisterOutput(const char* name) {
+    (void)name;
+    if (thread_started_) {
+        fprintf(stderr, "Error: Outputs must be registered before Activate\n");
+        return false;
+    }
+
+    outputs_.push_back(nullptr);
+    output_memory_.assign(outputs_.size() * buffer_size_, 0.0f);
+    for (size_t i = 0; i < outputs_.size(); i++) {
+        outputs_[i] = &output_memory_[i * buffer_size_];
+    }
+    return true;
+}
+
+bool DummyBackend::Activate() {
+    if (callbacks_ == nullptr || thread_started_) {
+        return false;
+    }
+
+    frame_.store(0);
+    cycles_.store(0);
+    xruns_.store(0);
+    cpu_load_.store(0.0f);
+    running_.store(true);
+
+    int result = -1;
+    if (rt_priority_ > 0) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        struct sched_param param;
+        param.sched_priority = rt_priority_;
+        pthread_attr_setschedparam(&attr, &param);
+        result = pthread_create(&thread_, &attr, ThreadEntry, this);
+        pthread_attr_destroy(&attr);
+        if (result == 0) {
+            active_priority_ = rt_priority_;
+        } else {
+            fprintf(stderr, "Warning: Could not create realtime audio thread "
+                    "(error %d), using normal scheduling\n", result);
+        }
+    }
+
+    if (result != 0) {
+        active_priority_ = 0;
+        result = pthread_create(&thread_, nullptr, ThreadEntry, this);
+    }
+
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed to create audio thread (error %d)\n", result);
+        running_.store(false);
+        return false;
+    }
+
+    thread_started_ = true;
+    return true;
+}
+
+void DummyBackend::Close() {
+    if (thread_started_) {
+        running_.store(false);
+        pthread_join(thread_, nullptr);
+        thread_started_ = false;
+    }
+}
+
+float DummyBackend::GetCpuLoad() const {
+    return cpu_load_.load(std::memory_order_relaxed);
+}
+
+void DummyBackend::QueryTransport(TransportInfo* info) const {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    info->rolling = running_.load(std::memory_order_relaxed);
+    info->frame = frame_.load(std::memory_order_relaxed);
+    info->has_tempo = false;
+    info->bpm = 0.0f;
+}
+
+uint64_t DummyBackend::GetCycleCount() const {
+    return cycles_.load(std::memory_order_acquire);
+}
+
+uint32_t DummyBackend::GetXrunCount() const {
+    return xruns_.load(std::memory_order_acquire);
+}
+
+uint64_t DummyBackend::FramesToNanos(uint64_t frames) const {
+    // Split into whole seconds so long runs cannot overflow
+    return frames / sample_rate_ * 1000000000ull +
+           frames % sample_rate_ * 1000000000ull / sample_rate_;
+}
+
+void* DummyBackend::ThreadEntry(void* arg) {
+    static_cast<DummyBackend*>(arg)->Run();
+    return nullptr;
+}
+
+void DummyBackend::Run() {
+    callbacks_->ThreadInit();
+
+    const float period_ns = static_cast<float>(FramesToNanos(buffer_size_));
+
+    // Period k starts at epoch + k periods; an xrun moves the epoch
+    uint64_t epoch_ns = MonotonicNanos();
+    uint64_t frames_since_epoch = 0;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        SleepUntil(epoch_ns + FramesToNanos(frames_since_epoch));
+
+        uint64_t start_ns = MonotonicNanos();
+        callbacks_->Process(outputs_.data(), buffer_size_);
+        uint64_t end_ns = MonotonicNanos();
+
+        frames_since_epoch += buffer_size_;
+        frame_.store(frame_.load(std::memory_order_relaxed) + buffer_size_,
+                     std::memory_order_relaxed);
+        cycles_.store(cycles_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_release);
+
+        float load = 100.0f * static_cast<float>(end_ns - start_ns) / period_ns;
+        float average = cpu_load_.load(std::memory_order_relaxed);
+        cpu_load_.store(average + kLoadSmoothing * (load - average),
+                        std::memory_order_relaxed);
+
+        // The next period already started: report how late we are and
+        // restart the schedule instead of running a burst of catch-up cycles
+        uint64_t deadline_ns = epoch_ns + FramesToNanos(frames_since_epoch);
+        if (end_ns > deadline_ns) {
+            xruns_.store(xruns_.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_release);
+            callbacks_->Xrun(static_cast<float>(end_ns - deadline_ns) / 1000.0f);
+            epoch_ns = end_ns;
+            frames_since_epoch = 0;
+        }
+    }
+}
+
+}  // namespace grids_jack
@@ -0,0 +1,92 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMMY_BACKEND_H_
+#define DUMMY_BACKEND_H_
+
+#include <pthread.h>
+
+#include <atomic>
+#include <vector>
+
+#include "audio_backend.h"
+
+namespace grids_jack {
+
+// Default SCHED_FIFO priority of the dummy audio thread (JACK's default
+// client priority is in the same range)
+const int kDummyRealtimePriority = 70;
+
+// Audio backend without an audio device
+//
+// A SCHED_FIFO thread (normal scheduling if that is not permitted) calls
+// the client once per period on an absolute CLOCK_MONOTONIC schedule, so
+// the periods do not drift. A cycle that finishes after the start of the
+// next period is an xrun: the client's Xrun() is called on the audio
+// thread and the schedule restarts from the late cycle. Output is
+// discarded.
+class DummyBackend : public AudioBackend {
+public:
+    DummyBackend(uint32_t sample_rate, uint32_t buffer_size,
+                 int rt_priority = kDummyRealtimePriority);
+    ~DummyBackend();
+
+    const char* GetName() const { return "dummy"; }
+
+    bool Open(const char* client_name, AudioBackendClient* client);
+    bool RegisterOutput(const char* name);
+    bool Activate();
+    void Close();
+
+    uint32_t GetSampleRate() const { return sample_rate_; }
+    uint32_t GetBufferSize() const { return buffer_size_; }
+    int GetRealtimePriority() const { return active_priority_; }
+    float GetCpuLoad() const;
+    void QueryTransport(TransportInfo* info) const;
+
+    // Cycles completed and deadlines missed since Activate (any thread)
+    uint64_t GetCycleCount() const;
+    uint32_t GetXrunCount() const;
+
+private:
+    static void* ThreadEntry(void* arg);
+    void Run();
+
+    // Nanoseconds spanned by a frame count at the sample rate
+    uint64_t FramesToNanos(uint64_t frames) const;
+
+    uint32_t sample_rate_;
+    uint32_t buffer_size_;
+    int rt_priority_;
+    int active_priority_;
+    AudioBackendClient* callbacks_;
+
+    std::vector<float> output_memory_;
+    std::vector<float*> outputs_;
+
+    pthread_t thread_;
+    bool thread_started_;
+    std::atomic<bool> running_;
+
+    // Written by the audio thread only
+    std::atomic<uint64_t> frame_;
+    std::atomic<uint64_t> cycles_;
+    std::atomic<uint32_t> xruns_;
+    std::atomic<float> cpu_load_;
+};
+
+}  // namespace grids_jack
+
+#endif  // DUMMY_BACKEND_H_
@@ -0,0 +1,157 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "engine_stats.h"
+
+#include <cstring>  // for memcpy
+
+namespace grids_jack {
+
+void EngineStats::Clear() {
+    callbacks = 0;
+    idle_callbacks = 0;
+    voices_active = 0;
+    voices_peak = 0;
+    voice_steals = 0;
+    triggers_total = 0;
+    triggers_coalesced = 0;
+    for (size_t i = 0; i < kStatsParts; i++) {
+        triggers_per_part[i] = 0;
+    }
+    pending_depth = 0;
+    pending_overflows = 0;
+    callback_ns = 0;
+    callback_max_ns = 0;
+    period_ns = 0;
+    dsp_load = 0.0f;
+    memory_bytes = 0;
+}
+
+EngineStatsPublisher::EngineStatsPublisher() : sequence_(0) {
+    for (size_t i = 0; i < kWords; i++) {
+        words_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void EngineStatsPublisher::Publish(const EngineStats& stats) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    uint32_t words[kWords] = {0};
+    memcpy(words, &stats, sizeof(stats));
+
+    // An odd sequence marks a write in progress
+    uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < kWords; i++) {
+        words_[i].store(words[i], std::memory_order_relaxed);
+    }
+
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+void EngineStatsPublisher::Read(EngineStats* out) const {
+    uint32_t words[kWords];
+    uint32_t before;
+    uint32_t after;
+
+    do {
+        before = sequence_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < kWords; i++) {
+            words[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    memcpy(out, words, sizeof(*out));
+}
+
+TimingHistogram::TimingHistogram() {
+    Clear();
+}
+
+void TimingHistogram::Record(uint32_t ns) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    // Single writer, so a plain load/store pair avoids a locked add
+    std::atomic<uint64_t>& count = counts_[BinIndex(ns)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void TimingHistogram::Clear() {
+    for (size_t i = 0; i < kNumBins; i++) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t TimingHistogram::GetCount() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < kNumBins; i++) {
+        total += counts_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint32_t TimingHistogram::Percentile(float quantile) const {
+    uint64_t counts[kNumBins];
+    uint64_t total = 0;
+    for (size_t i = 0; i < kNumBins; i++) {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    if (quantile < 0.0f) quantile = 0.0f;
+    if (quantile > 1.0f) quantile = 1.0f;
+
+    // Rank of the requested sample, 1-based
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumBins; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return BinUpperBound(i);
+        }
+    }
+    return BinUpperBound(kNumBins - 1);
+}
+
+size_t TimingHistogram::BinIndex(uint32_t ns) {
+    // Values below kSubBins get one exact bin each
+    if (ns < kSubBins) {
+        return ns;
+    }
+    uint32_t msb = 31 - static_cast<uint32_t>(__builtin_clz(ns));
+    uint32_t shift = msb - kSubBinBits;
+    return (msb - kSubBinBits + 1) * kSubBins + ((ns >> shift) & (kSubBins - 1));
+}
+
+uint32_t TimingHistogram::BinUpperBound(size_t bin) {
+    if (bin < kSubBins) {
+        return static_cast<uint32_t>(bin);
+    }
+    uint32_t octave = static_cast<uint32_t>(bin / kSubBins);  // msb - kSubBinBits + 1
+    uint32_t sub = static_cast<uint32_t>(bin % kSubBins);
+    uint32_t shift = octave - 1;
+    uint64_t lower = static_cast<uint64_t>(kSubBins + sub) << shift;
+    uint64_t upper = lower + (1ull << shift) - 1;
+    return upper > 0xffffffffull ? 0xffffffffu : static_cast<uint32_t>(upper);
+}
+
+}  // namespace grids_jack
@@ -0,0 +1,115 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ENGINE_STATS_H_
+#define ENGINE_STATS_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "monotonic_clock.h"
+
+namespace grids_jack {
+
+// Number of Grids drum parts tracked in the statistics (BD, SD, HH)
+constexpr size_t kStatsParts = 3;
+
+// Engine statistics published once per audio callback
+struct EngineStats {
+    uint64_t callbacks;               // Audio callbacks since start
+    uint64_t idle_callbacks;          // Callbacks that took the idle fast path
+    uint32_t voices_active;           // Voices still playing after the last callback
+    uint32_t voices_peak;             // Most voices rendered in one callback
+    uint64_t voice_steals;            // Triggers that cut off a playing voice
+    uint64_t triggers_total;          // All triggers sent to the sample player
+    uint64_t triggers_coalesced;      // Triggers merged into an existing voice
+    uint64_t triggers_per_part[kStatsParts];  // Pattern hits per drum part
+    uint32_t pending_depth;           // Humanized triggers waiting to fire
+    uint64_t pending_overflows;       // Humanized triggers fired early (queue full)
+    uint32_t callback_ns;             // Duration of the last callback
+    uint32_t callback_max_ns;         // Longest callback since start
+    uint32_t period_ns;               // Duration of one buffer at the sample rate
+    float dsp_load;                   // Last callback duration / period (0..1+)
+    uint64_t memory_bytes;            // Engine memory footprint at Init (see MemoryFootprint)
+
+    EngineStats() { Clear(); }
+
+    void Clear();
+};
+
+// Single-writer, multi-reader publication of EngineStats (a seqlock over
+// atomic words). The audio thread publishes without waiting; readers on
+// any thread retry until they see a snapshot that was not being written.
+class EngineStatsPublisher {
+public:
+    EngineStatsPublisher();
+
+    // Publish a new snapshot
+    // This is realtime-safe (wait-free) and should be called from the audio callback
+    void Publish(const EngineStats& stats);
+
+    // Copy the latest consistent snapshot (all zeros before the first Publish)
+    // NOT for the audio thread: may spin while a Publish is in progress
+    void Read(EngineStats* out) const;
+
+private:
+    static constexpr size_t kWords = (sizeof(EngineStats) + 3) / 4;
+
+    std::atomic<uint32_t> sequence_;
+    std::atomic<uint32_t> words_[kWords];
+};
+
+// Log-scale histogram of callback durations in nanoseconds
+// Each power of two is split into 8 linear sub-bins (<= 12.5% resolution).
+// Record() is called by a single writer (the audio thread); any thread
+// may read counts and percentiles while it runs.
+class TimingHistogram {
+public:
+    static constexpr uint32_t kSubBinBits = 3;
+    static constexpr uint32_t kSubBins = 1u << kSubBinBits;
+    static constexpr size_t kNumBins = (32 - kSubBinBits + 1) * kSubBins;
+
+    TimingHistogram();
+
+    // Count one duration
+    // This is realtime-safe (wait-free) and should be called from the audio callback
+    void Record(uint32_t ns);
+
+    // Reset all counts (not safe while a writer is recording)
+    void Clear();
+
+    // Total number of recorded durations
+    uint64_t GetCount() const;
+
+    // Count in a single bin
+    uint64_t GetBinCount(size_t bin) const {
+        return counts_[bin].load(std::memory_order_relaxed);
+    }
+
+    // Upper bound of the bin holding the given quantile (0.0-1.0),
+    // or 0 if nothing has been recorded
+    uint32_t Percentile(float quantile) const;
+
+    // Bin holding a duration, and the largest duration in a bin
+    static size_t BinIndex(uint32_t ns);
+    static uint32_t BinUpperBound(size_t bin);
+
+private:
+    std::atomic<uint64_t> counts_[kNumBins];
+};
+
+}  // namespace grids_jack
+
+#endif  // ENGINE_STATS_H_
@@ -0,0 +1,132 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "event_trace.h"
+
+#include <string.h>
+#include <unistd.h>
+
+namespace grids_jack {
+
+namespace {
+
+// How often the writer thread wakes up to drain the ring
+const useconds_t kWriterIntervalUs = 20000;
+
+// Records written per fwrite call
+const size_t kWriteBatch = 256;
+
+}  // namespace
+
+EventTrace::EventTrace()
+    : file_(nullptr),
+      running_(false),
+      written_(0),
+      dropped_(0),
+      dropped_reported_(0) {}
+
+EventTrace::~EventTrace() {
+    Close();
+}
+
+bool EventTrace::Open(const char* path, uint32_t sample_rate) {
+    Close();
+
+    file_ = fopen(path, "wb");
+    if (file_ == nullptr) {
+        fprintf(stderr, "Error: Could not create trace file %s\n", path);
+        return false;
+    }
+
+    TraceFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kTraceMagic, sizeof(header.magic));
+    header.version = kTraceVersion;
+    header.record_size = sizeof(TraceRecord);
+    header.sample_rate = sample_rate;
+    if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+        fprintf(stderr, "Error: Could not write trace file %s\n", path);
+        fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    written_.store(0);
+    dropped_.store(0);
+    dropped_reported_ = 0;
+    running_.store(true);
+    writer_ = std::thread(&EventTrace::WriterLoop, this);
+    return true;
+}
+
+void EventTrace::Close() {
+    if (file_ == nullptr) {
+        return;
+    }
+
+    running_.store(false);
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+
+    fclose(file_);
+    file_ = nullptr;
+}
+
+void EventTrace::Record(const TraceRecord& record) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    if (!ring_.Push(record)) {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    }
+}
+
+void EventTrace::WriterLoop() {
+    while (running_.load()) {
+        Drain();
+        usleep(kWriterIntervalUs);
+    }
+    // Records queued before Close() still reach the file
+    Drain();
+    fflush(file_);
+}
+
+void EventTrace::Drain() {
+    TraceRecord batch[kWriteBatch];
+    size_t count = 0;
+
+    while (ring_.Pop(&batch[count])) {
+        if (++count == kWriteBatch) {
+            written_.fetch_add(fwrite(batch, sizeof(TraceRecord), count, file_));
+            count = 0;
+        }
+    }
+
+    uint64_t dropped = dropped_.load();
+    if (dropped != dropped_reported_) {
+        TraceRecord& marker = batch[count++];
+        memset(&marker, 0, sizeof(marker));
+        marker.type = kTraceDropped;
+        marker.frame = dropped - dropped_reported_;
+        marker.voice = -1;
+        dropped_reported_ = dropped;
+    }
+
+    if (count > 0) {
+        written_.fetch_add(fwrite(batch, sizeof(TraceRecord), count, file_));
+    }
+}
+
+}  // namespace grids_jack
@@ -0,0 +1,125 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef EVENT_TRACE_H_
+#define EVENT_TRACE_H_
+
+#include <stdio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "spsc_ring.h"
+
+namespace grids_jack {
+
+// Trace file layout: one TraceFileHeader followed by TraceRecords, all in
+// host byte order (little-endian on every supported platform)
+static const char kTraceMagic[8] = {'G', 'R', 'I', 'D', 'S', 'T', 'R', 'C'};
+static const uint32_t kTraceVersion = 1;
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;      // sizeof(TraceRecord), for forward compatibility
+    uint32_t sample_rate;
+    uint32_t reserved;
+};
+
+// Event types
+enum TraceEventType : uint8_t {
+    kTraceTrigger = 1,         // A hit sent to the sample player
+    kTraceDropped = 2,         // Records lost to a full ring (count in frame)
+};
+
+// Trigger flags
+enum TraceFlags : uint8_t {
+    kTraceStolen = 1,          // Hit cut off a playing voice
+    kTraceCoalesced = 2,       // Hit merged into a voice from the same buffer
+    kTraceHumanized = 4,       // Hit went through the humanize queue
+    kTraceQueueFull = 8,       // Humanize queue was full, fired on the grid
+};
+
+// One traced event (32 bytes)
+struct TraceRecord {
+    uint64_t frame;            // Stream frame the event was due on
+    uint32_t block_offset;     // Frames from block start to 'frame'; the
+                               // voice sounds from block start, so this is
+                               // how early the hit plays
+    int32_t jitter;            // Humanize offset from the grid in frames
+    float velocity;
+    float pan;
+    int16_t voice;             // Voice slot, -1 if the note has no sample
+    uint8_t type;              // TraceEventType
+    uint8_t note;              // MIDI note
+    uint8_t part;              // DrumPart
+    uint8_t flags;             // TraceFlags
+    uint8_t x;                 // Grids map position when the event fired
+    uint8_t y;
+};
+
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord must stay 32 bytes");
+
+// Records events from the audio thread and streams them to a binary file
+// The audio thread pushes into a preallocated ring; a writer thread drains
+// it to disk, so tracing never blocks the callback. Records that do not
+// fit in the ring are counted and reported as a kTraceDropped record.
+class EventTrace {
+public:
+    // Ring size in records (128 KiB); about 4 seconds of dense triggers
+    // even if the writer thread were stalled
+    static constexpr size_t kRingCapacity = 4096;
+
+    EventTrace();
+    ~EventTrace();
+
+    // Create the trace file and start the writer thread
+    // Returns false if the file cannot be created
+    bool Open(const char* path, uint32_t sample_rate);
+
+    // Stop the writer thread after flushing every queued record
+    void Close();
+
+    bool IsOpen() const { return file_ != nullptr; }
+
+    // Queue a record for writing
+    // This is realtime-safe and should be called from the audio callback
+    void Record(const TraceRecord& record);
+
+    // Number of records written to the file
+    uint64_t GetWrittenCount() const { return written_.load(); }
+
+    // Number of records lost because the ring was full
+    uint64_t GetDroppedCount() const { return dropped_.load(); }
+
+private:
+    void WriterLoop();
+
+    // Write everything in the ring plus a marker for newly dropped records
+    void Drain();
+
+    SpscRing<TraceRecord, kRingCapacity> ring_;
+    FILE* file_;
+    std::thread writer_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t dropped_reported_;  // Writer thread only
+};
+
+}  // namespace grids_jack
+
+#endif  // EVENT_TRACE_H_
@@ -0,0 +1,43 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Fuzz harness for sample file name parsing
+//
+// The input is a file name as readdir() would return it (up to the first
+// NUL). An accepted name must start with the decimal note it was mapped
+// to, followed by a dot. Seed corpus: fuzz/filename/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "sample_bank.h"
+
+using namespace grids_jack;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    const char* text = reinterpret_cast<const char*>(data);
+    std::string name(text, strnlen(text, size));
+
+    uint8_t note = 0;
+    if (SampleBank::ParseMidiNote(name, &note)) {
+        size_t dot = name.find('.');
+        if (note > 127 || dot == std::string::npos || dot == 0) abort();
+        if (strtol(name.substr(0, dot).c_str(), nullptr, 10) != note) abort();
+    }
+    return 0;
+}
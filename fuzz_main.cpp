@@ -0,0 +1,115 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Standalone driver for the fuzz harnesses
+//
+// Without libFuzzer (GRIDS_FUZZ off) every fuzz_* target links this main
+// instead. It calls LLVMFuzzerTestOneInput once per file named on the
+// command line, recursing into directories in sorted order, or once on
+// stdin when no file is named. That is enough for AFL
+// (afl-fuzz -i fuzz/wav -o out -- build/fuzz_wav @@) and for replaying
+// the corpora under CTest. Arguments starting with '-' are libFuzzer
+// flags and are ignored, so both builds take the same command line.
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+static bool ReadAll(FILE* file, std::vector<uint8_t>* data) {
+    data->clear();
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data->insert(data->end(), buffer, buffer + n);
+    }
+    return !ferror(file);
+}
+
+// Run one input file, or every file below a directory
+// Returns the number of inputs run, or -1 if a path cannot be read
+static int RunPath(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        fprintf(stderr, "Error: Could not open %s\n", path.c_str());
+        return -1;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path.c_str());
+        if (dir == nullptr) {
+            fprintf(stderr, "Error: Could not open directory: %s\n", path.c_str());
+            return -1;
+        }
+        std::vector<std::string> names;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+
+        int count = 0;
+        for (const std::string& name : names) {
+            int n = RunPath(path + "/" + name);
+            if (n < 0) return -1;
+            count += n;
+        }
+        return count;
+    }
+
+    FILE* file = fopen(path.c_str(), "rb");
+    std::vector<uint8_t> data;
+    if (file == nullptr || !ReadAll(file, &data)) {
+        fprintf(stderr, "Error: Could not read %s\n", path.c_str());
+        if (file != nullptr) fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    int inputs = 0;
+    bool named = false;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') continue;
+        named = true;
+        int n = RunPath(argv[i]);
+        if (n < 0) return 1;
+        inputs += n;
+    }
+
+    if (!named) {
+        std::vector<uint8_t> data;
+        if (!ReadAll(stdin, &data)) {
+            fprintf(stderr, "Error: Could not read stdin\n");
+            return 1;
+        }
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+        inputs = 1;
+    }
+
+    fprintf(stderr, "Ran %d inputs\n", inputs);
+    return 0;
+}
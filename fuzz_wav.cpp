@@ -0,0 +1,63 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Fuzz harness for WAV ingestion
+//
+// The input is the content of a sample file. It goes through
+// SampleBank::LoadFile (libsndfile decode, channel and sample rate
+// checks, downmix, resampling to 48 kHz, denormal flush) from an
+// in-memory file. A file that loads must give a non-empty sample of
+// finite values. Seed corpus: fuzz/wav/
+//
+// The loader reports every rejected file on stderr; with libFuzzer, pass
+// -close_fd_mask=2 to keep the output readable.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cmath>
+
+#include "sample_bank.h"
+
+using namespace grids_jack;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    // One memory-backed file, rewritten for every input
+    static int fd = -1;
+    static char path[64];
+    if (fd < 0) {
+        fd = memfd_create("fuzz_wav", 0);
+        if (fd < 0) abort();
+        snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    }
+    if (ftruncate(fd, 0) != 0) abort();
+    if (size > 0 && pwrite(fd, data, size, 0) != static_cast<ssize_t>(size)) abort();
+
+    SampleBank bank;
+    if (bank.LoadFile(path, 60, 48000)) {
+        const Sample* sample = bank.GetSample(60);
+        if (sample == nullptr || sample->length == 0 ||
+            sample->length != sample->data.size()) {
+            abort();
+        }
+        for (float value : sample->data) {
+            if (!std::isfinite(value)) abort();
+        }
+    }
+    return 0;
+}
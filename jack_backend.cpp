@@ -0,0 +1,218 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "jack_backend.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+namespace grids_jack {
+
+JackBackend::JackBackend()
+    : client_(nullptr),
+      callbacks_(nullptr) {}
+
+JackBackend::~JackBackend() {
+    Close();
+}
+
+bool JackBackend::Open(const char* client_name, AudioBackendClient* client) {
+    jack_status_t status;
+
+    callbacks_ = client;
+
+    // Open JACK client
+    client_ = jack_client_open(client_name, JackNullOption, &status);
+    if (client_ == nullptr) {
+        fprintf(stderr, "Failed to open JACK client: status = 0x%x\n", status);
+        if (status & JackServerFailed) {
+            fprintf(stderr, "Unable to connect to JACK server\n");
+        }
+        return false;
+    }
+
+    if (status & JackNameNotUnique) {
+        const char* actual_name = jack_get_client_name(client_);
+        fprintf(stderr, "Unique name '%s' assigned\n", actual_name);
+    }
+
+    // Set process callback
+    if (jack_set_process_callback(client_, ProcessEntry, this) != 0) {
+        fprintf(stderr, "Failed to set JACK process callback\n");
+        return false;
+    }
+
+    // Set thread init callback (flush-to-zero for the process thread)
+    if (jack_set_thread_init_callback(client_, ThreadInitEntry, this) != 0) {
+        fprintf(stderr, "Failed to set JACK thread init callback\n");
+        return false;
+    }
+
+    // Set buffer size and sample rate callbacks
+    if (jack_set_buffer_size_callback(client_, BufferSizeEntry, this) != 0) {
+        fprintf(stderr, "Failed to set JACK buffer size callback\n");
+        return false;
+    }
+    if (jack_set_sample_rate_callback(client_, SampleRateEntry, this) != 0) {
+        fprintf(stderr, "Failed to set JACK sample rate callback\n");
+        return false;
+    }
+
+    // Set xrun callback (correlates xruns with engine load)
+    if (jack_set_xrun_callback(client_, XrunEntry, this) != 0) {
+        fprintf(stderr, "Failed to set JACK xrun callback\n");
+        return false;
+    }
+
+    // Register shutdown callback
+    jack_on_shutdown(client_, ShutdownEntry, this);
+
+    return true;
+}
+
+bool JackBackend::RegisterOutput(const char* name) {
+    jack_port_t* port = jack_port_register(client_, name, JACK_DEFAULT_AUDIO_TYPE,
+                                           JackPortIsOutput, 0);
+    if (port == nullptr) {
+        fprintf(stderr, "Failed to register output port %s\n", name);
+        return false;
+    }
+
+    ports_.push_back(port);
+    buffers_.push_back(nullptr);
+    return true;
+}
+
+bool JackBackend::Activate() {
+    if (jack_activate(client_) != 0) {
+        fprintf(stderr, "Failed to activate JACK client\n");
+        return false;
+    }
+    return true;
+}
+
+void JackBackend::ConnectOutputs() {
+    // Auto-connect to system playback ports (optional)
+    const char** ports = jack_get_ports(client_, nullptr, nullptr,
+                                        JackPortIsPhysical | JackPortIsInput);
+    if (ports != nullptr) {
+        ConnectTo(ports);
+        jack_free(ports);
+    } else {
+        fprintf(stderr, "No physical playback ports found - skipping auto-connection\n");
+        fprintf(stderr, "You may need to manually connect ports using qjackctl or jack_connect\n");
+    }
+
+    // Auto-connect to OBS Studio JACK input if available
+    const char** obs_ports = jack_get_ports(client_, "OBS Studio", nullptr,
+                                            JackPortIsInput);
+    if (obs_ports != nullptr) {
+        ConnectTo(obs_ports);
+        jack_free(obs_ports);
+    }
+}
+
+void JackBackend::ConnectTo(const char** ports) {
+    for (size_t i = 0; i < ports_.size() && ports[i] != nullptr; i++) {
+        const char* name = jack_port_name(ports_[i]);
+        int result = jack_connect(client_, name, ports[i]);
+        if (result == 0) {
+            fprintf(stderr, "Auto-connected %s to %s\n", name, ports[i]);
+        } else if (result == EEXIST) {
+            fprintf(stderr, "%s already connected to %s\n", name, ports[i]);
+        } else {
+            fprintf(stderr, "Failed to auto-connect %s to %s (error %d)\n", name, ports[i],
+                    result);
+        }
+    }
+}
+
+void JackBackend::Close() {
+    if (client_ != nullptr) {
+        jack_client_close(client_);
+        client_ = nullptr;
+    }
+    ports_.clear();
+    buffers_.clear();
+}
+
+uint32_t JackBackend::GetSampleRate() const {
+    return client_ != nullptr ? jack_get_sample_rate(client_) : 0;
+}
+
+uint32_t JackBackend::GetBufferSize() const {
+    return client_ != nullptr ? jack_get_buffer_size(client_) : 0;
+}
+
+int JackBackend::GetRealtimePriority() const {
+    return client_ != nullptr ? jack_client_real_time_priority(client_) : -1;
+}
+
+float JackBackend::GetCpuLoad() const {
+    return client_ != nullptr ? jack_cpu_load(client_) : 0.0f;
+}
+
+void JackBackend::QueryTransport(TransportInfo* info) const {
+    // REALTIME-SAFE: jack_transport_query may be called from the process thread
+    jack_position_t position;
+    jack_transport_state_t state = jack_transport_query(client_, &position);
+    info->rolling = state == JackTransportRolling;
+    info->frame = position.frame;
+    info->has_tempo = (position.valid & JackPositionBBT) != 0;
+    info->bpm = info->has_tempo ? static_cast<float>(position.beats_per_minute) : 0.0f;
+}
+
+int JackBackend::ProcessEntry(jack_nframes_t nframes, void* arg) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    JackBackend* backend = static_cast<JackBackend*>(arg);
+
+    for (size_t i = 0; i < backend->ports_.size(); i++) {
+        backend->buffers_[i] =
+            static_cast<float*>(jack_port_get_buffer(backend->ports_[i], nframes));
+        if (backend->buffers_[i] == nullptr) {
+            return 0;
+        }
+    }
+
+    backend->callbacks_->Process(backend->buffers_.data(), nframes);
+    return 0;
+}
+
+void JackBackend::ThreadInitEntry(void* arg) {
+    static_cast<JackBackend*>(arg)->callbacks_->ThreadInit();
+}
+
+int JackBackend::BufferSizeEntry(jack_nframes_t nframes, void* arg) {
+    static_cast<JackBackend*>(arg)->callbacks_->BufferSizeChanged(nframes);
+    return 0;
+}
+
+int JackBackend::SampleRateEntry(jack_nframes_t nframes, void* arg) {
+    static_cast<JackBackend*>(arg)->callbacks_->SampleRateChanged(nframes);
+    return 0;
+}
+
+int JackBackend::XrunEntry(void* arg) {
+    // Runs in a JACK notification thread, not the process thread
+    JackBackend* backend = static_cast<JackBackend*>(arg);
+    backend->callbacks_->Xrun(jack_get_xrun_delayed_usecs(backend->client_));
+    return 0;
+}
+
+void JackBackend::ShutdownEntry(void* arg) {
+    static_cast<JackBackend*>(arg)->callbacks_->Shutdown();
+}
+
+}  // namespace grids_jack
@@ -0,0 +1,70 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef JACK_BACKEND_H_
+#define JACK_BACKEND_H_
+
+#include <jack/jack.h>
+
+#include <vector>
+
+#include "audio_backend.h"
+
+namespace grids_jack {
+
+// Audio backend running as a JACK client
+class JackBackend : public AudioBackend {
+public:
+    JackBackend();
+    ~JackBackend();
+
+    const char* GetName() const { return "jack"; }
+
+    bool Open(const char* client_name, AudioBackendClient* client);
+    bool RegisterOutput(const char* name);
+    bool Activate();
+
+    // Connect to the physical playback ports, then to OBS Studio if running
+    void ConnectOutputs();
+
+    void Close();
+
+    uint32_t GetSampleRate() const;
+    uint32_t GetBufferSize() const;
+    int GetRealtimePriority() const;
+    float GetCpuLoad() const;
+    void QueryTransport(TransportInfo* info) const;
+
+private:
+    // Connect output i to ports[i] for each port in the list
+    void ConnectTo(const char** ports);
+
+    // JACK callbacks (arg is the backend)
+    static int ProcessEntry(jack_nframes_t nframes, void* arg);
+    static void ThreadInitEntry(void* arg);
+    static int BufferSizeEntry(jack_nframes_t nframes, void* arg);
+    static int SampleRateEntry(jack_nframes_t nframes, void* arg);
+    static int XrunEntry(void* arg);
+    static void ShutdownEntry(void* arg);
+
+    jack_client_t* client_;
+    AudioBackendClient* callbacks_;
+    std::vector<jack_port_t*> ports_;
+    std::vector<float*> buffers_;    // Per-cycle port buffers (audio thread)
+};
+
+}  // namespace grids_jack
+
+#endif  // JACK_BACKEND_H_
@@ -13,14 +13,26 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <jack/jack.h>
 #include <errno.h>
+#include <getopt.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <vector>
+
+#include "audio_backend.h"
+#include "audio_engine.h"
+#include "denormals.h"
+#include "dummy_backend.h"
+#include "engine_stats.h"
+#include "event_trace.h"
+#include "jack_backend.h"
+#include "midi_export.h"
+#include "offline_render.h"
 #include "sample_bank.h"
 #include "sample_player.h"
 #include "pattern_generator_wrapper.h"
@@ -28,8 +40,8 @@
 // Global flag for shutdown
 static volatile bool g_should_exit = false;
 
-// JACK client handle
-static jack_client_t* g_jack_client = nullptr;
+// Audio backend (--backend)
+static grids_jack::AudioBackend* g_backend = nullptr;
 
 // Sample bank
 static grids_jack::SampleBank g_sample_bank;
@@ -40,9 +52,30 @@ static grids_jack::SamplePlayer g_sample_player;
 // Pattern generator wrapper
 static grids_jack::PatternGeneratorWrapper g_pattern_generator;
 
-// JACK output ports
-static jack_port_t* g_output_port_left = nullptr;
-static jack_port_t* g_output_port_right = nullptr;
+// Audio engine (pattern clock, mixing, statistics) shared by all outputs
+static grids_jack::AudioEngine g_engine;
+
+// Optional trigger trace (-T)
+static grids_jack::EventTrace g_event_trace;
+
+// Sample rate the samples were loaded at, and the period the render
+// workers were sized for
+static uint32_t g_engine_sample_rate = 0;
+static uint32_t g_render_buffer_size = 0;
+
+// Engine state captured when the backend reports an xrun
+struct XrunRecord {
+    uint64_t callbacks;        // Callbacks completed before the xrun
+    uint32_t voices_active;    // Voices playing at the last callback
+    uint32_t callback_ns;      // Duration of the last callback
+    uint32_t period_ns;        // Period of the last callback
+    float delayed_usecs;       // Delay reported by the backend
+};
+
+// Only the first xruns are kept in detail; all of them are counted
+static const size_t kMaxXrunRecords = 64;
+static XrunRecord g_xrun_records[kMaxXrunRecords];
+static std::atomic<uint32_t> g_xrun_count(0);
 
 // Configuration
 struct Config {
@@ -56,11 +89,31 @@ struct Config {
     float output_gain;
     float humanize;
     float spread;
+    size_t render_threads;
+    const char* trace_file;
+    bool has_seed;
+    uint32_t seed;
+    const char* render_file;
+    uint32_t render_bars;
+    bool render_stems;
+    const char* midi_file;
+    bool bars_set;
+    bool stream_stdout;
+    grids_jack::PcmFormat stream_format;
+    bool stream_paced;
+    uint32_t render_sample_rate;
+    uint32_t block_size;
+    const char* backend;
 
     Config() : sample_directory("data"), bpm(120.0f), client_name("grids-jack"),
                verbose(false), num_parts(4), num_velocity_steps(32),
                lfo_enabled(false), output_gain(1.0f), humanize(0.0f),
-               spread(0.0f) {}
+               spread(0.0f), render_threads(1), trace_file(nullptr),
+               has_seed(false), seed(0), render_file(nullptr), render_bars(8),
+               render_stems(false), midi_file(nullptr),
+               bars_set(false), stream_stdout(false),
+               stream_format(grids_jack::kPcmFloat32), stream_paced(false),
+               render_sample_rate(48000), block_size(256), backend("jack") {}
 };
 
 static Config g_config;
@@ -72,109 +125,236 @@ void signal_handler(int sig) {
     g_should_exit = true;
 }
 
-// JACK process callback
-int jack_process_callback(jack_nframes_t nframes, void* arg) {
-    (void)arg;
-    
-    // Get output port buffers
-    float* out_left = (float*)jack_port_get_buffer(g_output_port_left, nframes);
-    float* out_right = (float*)jack_port_get_buffer(g_output_port_right, nframes);
-    
-    if (out_left == nullptr || out_right == nullptr) {
-        return 0;
+// Audio callbacks from the backend (JACK or dummy)
+class GridsClient : public grids_jack::AudioBackendClient {
+public:
+    void Process(float* const* outputs, uint32_t num_frames) {
+        // REALTIME-SAFE: No allocations, no locks, no system calls
+        g_engine.Process(outputs[0], outputs[1], num_frames);
     }
-    
-    // Process pattern generator to generate triggers
-    g_pattern_generator.Process(nframes);
-    
-    // Process audio through sample player (stereo with panning)
-    g_sample_player.ProcessStereo(out_left, out_right, nframes);
-
-    // Apply global output gain
-    if (g_config.output_gain != 1.0f) {
-        for (jack_nframes_t i = 0; i < nframes; i++) {
-            out_left[i] *= g_config.output_gain;
-            out_right[i] *= g_config.output_gain;
+
+    void ThreadInit() {
+        // Decaying sample tails must never hit the slow denormal path
+        grids_jack::DisableDenormals();
+    }
+
+    void BufferSizeChanged(uint32_t buffer_size) {
+        // Render workers mix into scratch buses sized for the largest
+        // period; grow them (no cycle runs concurrently with this call)
+        if (g_sample_player.GetRenderThreads() > 1 &&
+            buffer_size > g_render_buffer_size) {
+            fprintf(stderr, "Buffer size changed to %u frames\n", buffer_size);
+            g_render_buffer_size = buffer_size;
+            g_sample_player.SetRenderThreads(g_config.render_threads, buffer_size,
+                                             g_backend->GetRealtimePriority());
         }
     }
-    
-    return 0;
-}
 
-// JACK shutdown callback
-void jack_shutdown_callback(void* arg) {
-    (void)arg;
-    fprintf(stderr, "JACK server shut down, exiting...\n");
-    g_should_exit = true;
-}
+    void SampleRateChanged(uint32_t sample_rate) {
+        // Samples are resampled once at load time
+        if (g_engine_sample_rate != 0 && sample_rate != g_engine_sample_rate) {
+            fprintf(stderr, "Warning: Sample rate changed to %u Hz; samples were "
+                    "loaded at %u Hz and will play at the wrong pitch\n",
+                    sample_rate, g_engine_sample_rate);
+        }
+    }
 
-// Initialize JACK client
-bool init_jack() {
-    jack_status_t status;
-    
-    // Open JACK client
-    g_jack_client = jack_client_open(g_config.client_name, JackNullOption, &status);
-    if (g_jack_client == nullptr) {
-        fprintf(stderr, "Failed to open JACK client: status = 0x%x\n", status);
-        if (status & JackServerFailed) {
-            fprintf(stderr, "Unable to connect to JACK server\n");
+    void Xrun(float delayed_usecs) {
+        // May run on the audio thread (dummy backend): lock-free only
+        // The snapshot describes the last callback before the xrun
+        grids_jack::EngineStats stats;
+        g_engine.ReadStats(&stats);
+
+        uint32_t index = g_xrun_count.load(std::memory_order_relaxed);
+        if (index < kMaxXrunRecords) {
+            XrunRecord& record = g_xrun_records[index];
+            record.callbacks = stats.callbacks;
+            record.voices_active = stats.voices_active;
+            record.callback_ns = stats.callback_ns;
+            record.period_ns = stats.period_ns;
+            record.delayed_usecs = delayed_usecs;
         }
-        return false;
+        g_xrun_count.store(index + 1, std::memory_order_release);
     }
-    
-    if (status & JackNameNotUnique) {
-        const char* actual_name = jack_get_client_name(g_jack_client);
-        fprintf(stderr, "Unique name '%s' assigned\n", actual_name);
+
+    void Shutdown() {
+        fprintf(stderr, "Audio backend shut down, exiting...\n");
+        g_should_exit = true;
     }
-    
-    // Get and log sample rate and buffer size
-    jack_nframes_t sample_rate = jack_get_sample_rate(g_jack_client);
-    jack_nframes_t buffer_size = jack_get_buffer_size(g_jack_client);
-    fprintf(stderr, "JACK sample rate: %u Hz\n", sample_rate);
-    fprintf(stderr, "JACK buffer size: %u frames\n", buffer_size);
-    
-    if (g_config.verbose) {
-        fprintf(stderr, "JACK buffer duration: %.2f ms\n", 
-                (float)buffer_size / sample_rate * 1000.0f);
+};
+
+static GridsClient g_client;
+
+// Create the backend selected with --backend and register the outputs
+bool init_backend() {
+    if (strcmp(g_config.backend, "dummy") == 0) {
+        g_backend = new grids_jack::DummyBackend(g_config.render_sample_rate,
+                                                 g_config.block_size);
+    } else {
+        g_backend = new grids_jack::JackBackend();
     }
-    
-    // Set process callback
-    if (jack_set_process_callback(g_jack_client, jack_process_callback, nullptr) != 0) {
-        fprintf(stderr, "Failed to set JACK process callback\n");
+
+    if (!g_backend->Open(g_config.client_name, &g_client)) {
         return false;
     }
-    
-    // Register shutdown callback
-    jack_on_shutdown(g_jack_client, jack_shutdown_callback, nullptr);
-    
-    // Register stereo output ports
-    g_output_port_left = jack_port_register(g_jack_client, "output_L",
-                                           JACK_DEFAULT_AUDIO_TYPE,
-                                           JackPortIsOutput, 0);
-    if (g_output_port_left == nullptr) {
-        fprintf(stderr, "Failed to register left output port\n");
-        return false;
+
+    // Get and log sample rate and buffer size
+    uint32_t sample_rate = g_backend->GetSampleRate();
+    uint32_t buffer_size = g_backend->GetBufferSize();
+    fprintf(stderr, "Audio backend: %s\n", g_backend->GetName());
+    fprintf(stderr, "Sample rate: %u Hz\n", sample_rate);
+    fprintf(stderr, "Buffer size: %u frames\n", buffer_size);
+
+    if (g_config.verbose) {
+        fprintf(stderr, "Buffer duration: %.2f ms\n",
+                (float)buffer_size / sample_rate * 1000.0f);
     }
-    
-    g_output_port_right = jack_port_register(g_jack_client, "output_R",
-                                            JACK_DEFAULT_AUDIO_TYPE,
-                                            JackPortIsOutput, 0);
-    if (g_output_port_right == nullptr) {
-        fprintf(stderr, "Failed to register right output port\n");
+
+    // Register stereo outputs
+    if (!g_backend->RegisterOutput("output_L") || !g_backend->RegisterOutput("output_R")) {
         return false;
     }
-    
     fprintf(stderr, "Registered stereo output ports\n");
-    
+
     return true;
 }
 
-// Cleanup JACK client
-void cleanup_jack() {
-    if (g_jack_client != nullptr) {
-        jack_client_close(g_jack_client);
-        g_jack_client = nullptr;
+// Close and delete the backend (stops the audio thread)
+void cleanup_backend() {
+    if (g_backend != nullptr) {
+        g_backend->Close();
+        delete g_backend;
+        g_backend = nullptr;
+    }
+}
+
+// Express a duration as a percentage of the period
+static float percent_of_period(uint32_t ns, uint32_t period_ns) {
+    return period_ns > 0 ? 100.0f * ns / period_ns : 0.0f;
+}
+
+// Print a one-line engine status (reads the published snapshot)
+void print_stats_line() {
+    grids_jack::EngineStats stats;
+    g_engine.ReadStats(&stats);
+    fprintf(stderr, "[stats] voices %u (peak %u) triggers %llu steals %llu "
+            "pending %u dsp %.1f%% (p99 %.1f%%, max %.1f%%) xruns %u\n",
+            stats.voices_active, stats.voices_peak,
+            (unsigned long long)stats.triggers_total,
+            (unsigned long long)stats.voice_steals,
+            stats.pending_depth, stats.dsp_load * 100.0f,
+            percent_of_period(g_engine.GetCallbackHistogram().Percentile(0.99f), stats.period_ns),
+            percent_of_period(stats.callback_max_ns, stats.period_ns),
+            g_xrun_count.load(std::memory_order_acquire));
+}
+
+// Print xruns recorded since the last call
+void print_new_xruns(uint32_t* printed) {
+    uint32_t count = g_xrun_count.load(std::memory_order_acquire);
+    for (; *printed < count && *printed < kMaxXrunRecords; (*printed)++) {
+        const XrunRecord& record = g_xrun_records[*printed];
+        fprintf(stderr, "[xrun] #%u after callback %llu: %u voices, last callback "
+                "%.3f ms of %.3f ms, delayed %.0f us\n",
+                *printed + 1, (unsigned long long)record.callbacks,
+                record.voices_active, record.callback_ns / 1e6,
+                record.period_ns / 1e6, record.delayed_usecs);
     }
+    *printed = count;
+}
+
+// Express a byte count in KiB
+static double kib(size_t bytes) {
+    return bytes / 1024.0;
+}
+
+// Print the memory footprint by sample and by category (verbose startup)
+void print_memory_footprint() {
+    fprintf(stderr, "Memory per sample (decoded + padding + overhead):\n");
+    for (uint8_t note : g_sample_bank.GetAllNotes()) {
+        const grids_jack::Sample* sample = g_sample_bank.GetSample(note);
+        grids_jack::MemoryFootprint footprint;
+        grids_jack::SampleBank::AddFootprint(*sample, &footprint);
+        fprintf(stderr, "  Note %3u: %9.1f KiB + %.1f + %.1f  %s\n", note,
+                kib(footprint.sample_data), kib(footprint.sample_padding),
+                kib(footprint.sample_overhead), sample->filename.c_str());
+    }
+
+    grids_jack::MemoryFootprint footprint;
+    g_engine.GetMemoryFootprint(&footprint);
+    fprintf(stderr, "Memory footprint: %.1f KiB\n", kib(footprint.Total()));
+    fprintf(stderr, "  Sample data:     %9.1f KiB\n", kib(footprint.sample_data));
+    fprintf(stderr, "  Sample padding:  %9.1f KiB\n", kib(footprint.sample_padding));
+    fprintf(stderr, "  Sample overhead: %9.1f KiB\n", kib(footprint.sample_overhead));
+    fprintf(stderr, "  Voice pool:      %9.1f KiB\n", kib(footprint.voice_pool));
+    fprintf(stderr, "  Render buffers:  %9.1f KiB\n", kib(footprint.render_buffers));
+    fprintf(stderr, "  Trigger queue:   %9.1f KiB\n", kib(footprint.trigger_queue));
+    fprintf(stderr, "  Pattern state:   %9.1f KiB\n", kib(footprint.pattern_state));
+    fprintf(stderr, "  Engine state:    %9.1f KiB\n", kib(footprint.engine_state));
+}
+
+// Print engine statistics at shutdown
+void print_stats_summary() {
+    grids_jack::EngineStats stats;
+    g_engine.ReadStats(&stats);
+    if (stats.callbacks == 0) {
+        return;
+    }
+
+    fprintf(stderr, "Engine statistics:\n");
+    fprintf(stderr, "  Callbacks: %llu (%llu idle)\n",
+            (unsigned long long)stats.callbacks,
+            (unsigned long long)stats.idle_callbacks);
+    fprintf(stderr, "  Peak voices: %u\n", stats.voices_peak);
+    fprintf(stderr, "  Triggers: %llu (BD %llu, SD %llu, HH %llu), %llu coalesced\n",
+            (unsigned long long)stats.triggers_total,
+            (unsigned long long)stats.triggers_per_part[grids_jack::DRUM_PART_BD],
+            (unsigned long long)stats.triggers_per_part[grids_jack::DRUM_PART_SD],
+            (unsigned long long)stats.triggers_per_part[grids_jack::DRUM_PART_HH],
+            (unsigned long long)stats.triggers_coalesced);
+    fprintf(stderr, "  Voice steals: %llu\n", (unsigned long long)stats.voice_steals);
+    fprintf(stderr, "  Humanize queue overflows: %llu\n",
+            (unsigned long long)stats.pending_overflows);
+    fprintf(stderr, "  Memory footprint: %.1f KiB\n", kib(stats.memory_bytes));
+
+    // Histogram bins are upper bounds; the maximum is exact
+    uint32_t p50 = g_engine.GetCallbackHistogram().Percentile(0.50f);
+    uint32_t p99 = g_engine.GetCallbackHistogram().Percentile(0.99f);
+    if (p50 > stats.callback_max_ns) p50 = stats.callback_max_ns;
+    if (p99 > stats.callback_max_ns) p99 = stats.callback_max_ns;
+    fprintf(stderr, "  Callback time (period %.3f ms):\n", stats.period_ns / 1e6);
+    fprintf(stderr, "    p50 %.3f ms (%.1f%%)\n", p50 / 1e6,
+            percent_of_period(p50, stats.period_ns));
+    fprintf(stderr, "    p99 %.3f ms (%.1f%%)\n", p99 / 1e6,
+            percent_of_period(p99, stats.period_ns));
+    fprintf(stderr, "    max %.3f ms (%.1f%%)\n", stats.callback_max_ns / 1e6,
+            percent_of_period(stats.callback_max_ns, stats.period_ns));
+
+    uint32_t xruns = g_xrun_count.load(std::memory_order_acquire);
+    fprintf(stderr, "  Xruns: %u\n", xruns);
+    for (uint32_t i = 0; i < xruns && i < kMaxXrunRecords; i++) {
+        const XrunRecord& record = g_xrun_records[i];
+        fprintf(stderr, "    #%u after callback %llu: %u voices, last callback %.3f ms\n",
+                i + 1, (unsigned long long)record.callbacks, record.voices_active,
+                record.callback_ns / 1e6);
+    }
+    if (xruns > kMaxXrunRecords) {
+        fprintf(stderr, "    (%u more not recorded)\n", xruns - static_cast<uint32_t>(kMaxXrunRecords));
+    }
+}
+
+// Flush and close the trigger trace, if one is open
+void close_trace() {
+    if (!g_event_trace.IsOpen()) {
+        return;
+    }
+    g_event_trace.Close();
+    fprintf(stderr, "Trace: %llu records written to %s",
+            (unsigned long long)g_event_trace.GetWrittenCount(), g_config.trace_file);
+    if (g_event_trace.GetDroppedCount() > 0) {
+        fprintf(stderr, " (%llu dropped)",
+                (unsigned long long)g_event_trace.GetDroppedCount());
+    }
+    fprintf(stderr, "\n");
 }
 
 // Print usage information
@@ -189,15 +369,68 @@ void print_usage(const char* program_name) {
     fprintf(stderr, "  -o <gain>    Global output volume scaling (default: 1.0)\n");
     fprintf(stderr, "  -u <amt>     Humanize timing, 0.0-1.0 (default: 0.0)\n");
     fprintf(stderr, "  -r <spread>  Stereo spread, 0.0-1.0 (default: 0.0)\n");
+    fprintf(stderr, "  -t <threads> Voice render threads, 1-%zu (default: 1)\n",
+            grids_jack::kMaxRenderThreads);
+    fprintf(stderr, "  -T <file>    Record every trigger to a binary trace file\n");
+    fprintf(stderr, "  -S <seed>    Random seed for a repeatable pattern (default: time)\n");
     fprintf(stderr, "  -l           Enable LFO drift of x/y pattern positions\n");
     fprintf(stderr, "  -v           Verbose mode - show detailed diagnostic information\n");
     fprintf(stderr, "  -h           Show this help message\n");
+    fprintf(stderr, "Offline rendering (no JACK server needed):\n");
+    fprintf(stderr, "  --render <file>       Render to a 32-bit float stereo WAV file\n");
+    fprintf(stderr, "  --bars <n>            Length of the render in bars (default: 8)\n");
+    fprintf(stderr, "  --stems               Also write per-part and per-mapping stems in the\n");
+    fprintf(stderr, "                        same pass (<file>_bd.wav, <file>_m0_note36.wav...)\n");
+    fprintf(stderr, "  --midi <file>         Write --bars of the pattern to a Standard MIDI File\n");
+    fprintf(stderr, "                        (one track per sample, no audio rendered)\n");
+    fprintf(stderr, "  --stdout              Stream raw interleaved stereo PCM to stdout (endless\n");
+    fprintf(stderr, "                        unless --bars is given)\n");
+    fprintf(stderr, "  --format <fmt>        --stdout sample format: f32 or s16 (default: f32)\n");
+    fprintf(stderr, "  --realtime            Pace --stdout to wall-clock time instead of running\n");
+    fprintf(stderr, "                        as fast as the reader accepts\n");
+    fprintf(stderr, "  --block-size <frames> Frames per process block (default: 256)\n");
+    fprintf(stderr, "  --sample-rate <hz>    Render sample rate (default: 48000)\n");
+    fprintf(stderr, "Audio backend:\n");
+    fprintf(stderr, "  --backend <name>      jack, or dummy for a timed realtime thread with no\n");
+    fprintf(stderr, "                        audio device; dummy uses --sample-rate and\n");
+    fprintf(stderr, "                        --block-size (default: jack)\n");
 }
 
+// Long-only options
+enum {
+    kOptRender = 256,
+    kOptBars,
+    kOptStems,
+    kOptMidi,
+    kOptStdout,
+    kOptFormat,
+    kOptRealtime,
+    kOptBlockSize,
+    kOptSampleRate,
+    kOptBackend,
+};
+
+static const struct option kLongOptions[] = {
+    {"render", required_argument, nullptr, kOptRender},
+    {"bars", required_argument, nullptr, kOptBars},
+    {"stems", no_argument, nullptr, kOptStems},
+    {"midi", required_argument, nullptr, kOptMidi},
+    {"stdout", no_argument, nullptr, kOptStdout},
+    {"format", required_argument, nullptr, kOptFormat},
+    {"realtime", no_argument, nullptr, kOptRealtime},
+    {"block-size", required_argument, nullptr, kOptBlockSize},
+    {"sample-rate", required_argument, nullptr, kOptSampleRate},
+    {"backend", required_argument, nullptr, kOptBackend},
+    {"seed", required_argument, nullptr, 'S'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0},
+};
+
 // Parse command-line arguments
 bool parse_args(int argc, char* argv[]) {
     int opt;
-    while ((opt = getopt(argc, argv, "d:b:n:s:p:o:u:r:lvh")) != -1) {
+    while ((opt = getopt_long(argc, argv, "d:b:n:s:p:o:u:r:t:T:S:lvh",
+                              kLongOptions, nullptr)) != -1) {
         switch (opt) {
             case 'd':
                 g_config.sample_directory = optarg;
@@ -251,6 +484,83 @@ bool parse_args(int argc, char* argv[]) {
                     return false;
                 }
                 break;
+            case 't': {
+                int val = atoi(optarg);
+                if (val <= 0 || static_cast<size_t>(val) > grids_jack::kMaxRenderThreads) {
+                    fprintf(stderr, "Error: Render threads must be between 1 and %zu\n",
+                            grids_jack::kMaxRenderThreads);
+                    return false;
+                }
+                g_config.render_threads = static_cast<size_t>(val);
+                break;
+            }
+            case 'T':
+                g_config.trace_file = optarg;
+                break;
+            case 'S':
+                g_config.seed = static_cast<uint32_t>(strtoul(optarg, nullptr, 0));
+                g_config.has_seed = true;
+                break;
+            case kOptRender:
+                g_config.render_file = optarg;
+                break;
+            case kOptBars: {
+                int val = atoi(optarg);
+                if (val <= 0) {
+                    fprintf(stderr, "Error: Bars must be greater than 0\n");
+                    return false;
+                }
+                g_config.render_bars = static_cast<uint32_t>(val);
+                g_config.bars_set = true;
+                break;
+            }
+            case kOptStems:
+                g_config.render_stems = true;
+                break;
+            case kOptMidi:
+                g_config.midi_file = optarg;
+                break;
+            case kOptStdout:
+                g_config.stream_stdout = true;
+                break;
+            case kOptFormat:
+                if (strcmp(optarg, "f32") == 0) {
+                    g_config.stream_format = grids_jack::kPcmFloat32;
+                } else if (strcmp(optarg, "s16") == 0) {
+                    g_config.stream_format = grids_jack::kPcmS16;
+                } else {
+                    fprintf(stderr, "Error: Format must be f32 or s16\n");
+                    return false;
+                }
+                break;
+            case kOptRealtime:
+                g_config.stream_paced = true;
+                break;
+            case kOptBlockSize: {
+                int val = atoi(optarg);
+                if (val <= 0 || val > 8192) {
+                    fprintf(stderr, "Error: Block size must be between 1 and 8192\n");
+                    return false;
+                }
+                g_config.block_size = static_cast<uint32_t>(val);
+                break;
+            }
+            case kOptSampleRate: {
+                int val = atoi(optarg);
+                if (val < 8000 || val > 384000) {
+                    fprintf(stderr, "Error: Sample rate must be between 8000 and 384000\n");
+                    return false;
+                }
+                g_config.render_sample_rate = static_cast<uint32_t>(val);
+                break;
+            }
+            case kOptBackend:
+                if (strcmp(optarg, "jack") != 0 && strcmp(optarg, "dummy") != 0) {
+                    fprintf(stderr, "Error: Backend must be jack or dummy\n");
+                    return false;
+                }
+                g_config.backend = optarg;
+                break;
             case 'l':
                 g_config.lfo_enabled = true;
                 break;
@@ -268,6 +578,247 @@ bool parse_args(int argc, char* argv[]) {
     return true;
 }
 
+// Set up the pattern generator from the configuration
+// sample_player may be nullptr to generate triggers without audio
+void init_pattern(grids_jack::SamplePlayer* sample_player, uint32_t sample_rate,
+                  const std::vector<uint8_t>& notes) {
+    // Initialize pattern generator
+    g_pattern_generator.Init(sample_player, sample_rate, g_config.bpm);
+    fprintf(stderr, "Pattern generator initialized at %.1f BPM\n", g_config.bpm);
+
+    // A fixed seed makes the pattern, velocities and humanize repeatable
+    if (g_config.has_seed) {
+        g_pattern_generator.Seed(g_config.seed);
+        fprintf(stderr, "Random seed: %u\n", g_config.seed);
+    }
+    
+    // Enable LFO if configured
+    g_pattern_generator.SetLfoEnabled(g_config.lfo_enabled);
+
+    // Set humanization
+    if (g_config.humanize > 0.0f) {
+        g_pattern_generator.SetHumanize(g_config.humanize);
+    }
+
+    // Assign samples to drum parts with random X/Y positions
+    g_pattern_generator.AssignSamplesToParts(notes, g_config.num_parts,
+                                               g_config.num_velocity_steps);
+    // Set stereo spread (assigns pan positions across mappings)
+    if (g_config.spread > 0.0f) {
+        g_pattern_generator.SetSpread(g_config.spread);
+    }
+
+    const std::vector<grids_jack::SampleMapping>& mappings =
+        g_pattern_generator.GetSampleMappings();
+    fprintf(stderr, "Selected and assigned %zu samples to drum parts (BD, SD, HH)\n",
+            mappings.size());
+    
+    // In verbose mode, show detailed assignments
+    if (g_config.verbose) {
+        fprintf(stderr, "Sample assignments (verbose):\n");
+        for (size_t i = 0; i < mappings.size(); ++i) {
+            const char* part_name = "BD";
+            if (mappings[i].drum_part == grids_jack::DRUM_PART_SD) {
+                part_name = "SD";
+            } else if (mappings[i].drum_part == grids_jack::DRUM_PART_HH) {
+                part_name = "HH";
+            }
+            fprintf(stderr, "  Note %3u -> %s (x=%3u, y=%3u, pan=%+.2f) velocity pattern: ",
+                    mappings[i].midi_note, part_name,
+                    mappings[i].x, mappings[i].y, mappings[i].pan);
+            // Show first 16 steps of velocity pattern (0=low, 1=high)
+            for (int step = 0; step < 16; ++step) {
+                fprintf(stderr, "%u", mappings[i].velocity_pattern[step]);
+            }
+            fprintf(stderr, "...\n");
+        }
+        fprintf(stderr, "Pattern parameters: X=%u, Y=%u, Randomness=%u\n",
+                g_pattern_generator.GetPatternX(),
+                g_pattern_generator.GetPatternY(),
+                g_pattern_generator.GetRandomness());
+    }
+}
+
+// Load samples and set up the player, pattern generator and engine
+// buffer_size is the largest block Process will be called with
+bool init_engine(uint32_t sample_rate, uint32_t buffer_size, int rt_priority) {
+    // Load samples from directory
+    fprintf(stderr, "\n");
+    if (!g_sample_bank.LoadDirectory(g_config.sample_directory, sample_rate)) {
+        fprintf(stderr, "Error: No samples could be loaded\n");
+        return false;
+    }
+    
+    // Display loaded samples
+    std::vector<uint8_t> notes = g_sample_bank.GetAllNotes();
+    fprintf(stderr, "\nLoaded %zu samples with MIDI notes: ", notes.size());
+    for (size_t i = 0; i < notes.size(); i++) {
+        fprintf(stderr, "%u", notes[i]);
+        if (i < notes.size() - 1) {
+            fprintf(stderr, ", ");
+        }
+    }
+    fprintf(stderr, "\n\n");
+    
+    g_engine_sample_rate = sample_rate;
+    g_render_buffer_size = buffer_size;
+
+    // Initialize sample player
+    g_sample_player.Init(&g_sample_bank, sample_rate);
+    fprintf(stderr, "Sample player initialized with %zu voice pool\n", grids_jack::kMaxVoices);
+
+    // Spawn render workers at the audio thread's realtime priority
+    if (g_config.render_threads > 1) {
+        if (!g_sample_player.SetRenderThreads(g_config.render_threads, buffer_size,
+                                              rt_priority)) {
+            fprintf(stderr, "Error: Failed to start render threads\n");
+            return false;
+        }
+        fprintf(stderr, "Voice rendering split across %zu threads\n",
+                g_sample_player.GetRenderThreads());
+    }
+    
+    init_pattern(&g_sample_player, sample_rate, notes);
+
+    // Start the trace writer before the first callback
+    if (g_config.trace_file != nullptr) {
+        if (!g_event_trace.Open(g_config.trace_file, sample_rate)) {
+            return false;
+        }
+        g_pattern_generator.SetTrace(&g_event_trace);
+        fprintf(stderr, "Tracing triggers to %s\n", g_config.trace_file);
+    }
+
+    // Mixing, output gain and statistics for every block
+    g_engine.Init(&g_sample_player, &g_pattern_generator, sample_rate);
+    g_engine.SetOutputGain(g_config.output_gain);
+    if (g_config.verbose) {
+        print_memory_footprint();
+    }
+
+    // Print initial pattern
+    g_pattern_generator.PrintCurrentPattern();
+    fprintf(stderr, "\n");
+
+    return true;
+}
+
+// Render --bars of the pattern to a float WAV file without JACK
+// Drives the same AudioEngine::Process as the JACK callback, block by block
+int run_render() {
+    uint32_t sample_rate = g_config.render_sample_rate;
+    uint32_t block_size = g_config.block_size;
+
+    if (!init_engine(sample_rate, block_size, 0)) {
+        return 1;
+    }
+
+    uint64_t total_frames = grids_jack::FramesForBars(
+        g_config.render_bars, g_pattern_generator.GetFramesPerPulse());
+
+    fprintf(stderr, "Rendering %u bars (%llu frames, %.1f s) in blocks of %u...\n",
+            g_config.render_bars, (unsigned long long)total_frames,
+            static_cast<double>(total_frames) / sample_rate, block_size);
+
+    grids_jack::RenderResult result;
+    if (!grids_jack::RenderToWav(&g_engine, sample_rate, block_size, total_frames,
+                                 g_config.render_file, &result, &g_should_exit,
+                                 g_config.render_stems
+                                     ? &g_pattern_generator.GetSampleMappings()
+                                     : nullptr)) {
+        return 1;
+    }
+
+    double duration = static_cast<double>(result.frames) / sample_rate;
+    double elapsed = result.total_ns / 1e9;
+    fprintf(stderr, "Wrote %s in %.3f s (%.0fx realtime, %.3f s in the engine)\n",
+            g_config.render_file, elapsed, elapsed > 0.0 ? duration / elapsed : 0.0,
+            result.engine_ns / 1e9);
+    if (result.files > 1) {
+        fprintf(stderr, "  %u stems alongside the mix, %llu writer stalls\n",
+                result.files - 1, (unsigned long long)result.stalls);
+    }
+
+    if (g_config.verbose) {
+        print_stats_summary();
+    }
+    return 0;
+}
+
+// Write --bars of the pattern to a MIDI file
+// Only the sample file names are read; no audio is loaded or rendered
+int run_midi_export() {
+    uint32_t sample_rate = g_config.render_sample_rate;
+
+    std::vector<uint8_t> notes;
+    if (!g_sample_bank.ScanDirectory(g_config.sample_directory, &notes)) {
+        fprintf(stderr, "Error: No samples found in %s\n", g_config.sample_directory);
+        return 1;
+    }
+    init_pattern(nullptr, sample_rate, notes);
+
+    uint64_t total_frames = grids_jack::FramesForBars(
+        g_config.render_bars, g_pattern_generator.GetFramesPerPulse());
+
+    uint64_t start_ns = grids_jack::MonotonicNanos();
+    size_t num_notes = 0;
+    if (!grids_jack::ExportMidi(&g_pattern_generator, sample_rate, total_frames,
+                                g_config.midi_file, &num_notes)) {
+        return 1;
+    }
+    fprintf(stderr, "Wrote %s: %u bars, %zu notes on %zu tracks in %.3f ms\n",
+            g_config.midi_file, g_config.render_bars, num_notes,
+            g_pattern_generator.GetSampleMappings().size(),
+            (grids_jack::MonotonicNanos() - start_ns) / 1e6);
+    return 0;
+}
+
+// Stream raw PCM to stdout without JACK or files, e.g. into an encoder
+// Runs until --bars (if given), SIGINT/SIGTERM, or the reader exits
+int run_stream() {
+    uint32_t sample_rate = g_config.render_sample_rate;
+    uint32_t block_size = g_config.block_size;
+
+    if (isatty(STDOUT_FILENO)) {
+        fprintf(stderr, "Error: Refusing to write raw audio to a terminal; "
+                "pipe stdout into a program or file\n");
+        return 1;
+    }
+
+    if (!init_engine(sample_rate, block_size, 0)) {
+        return 1;
+    }
+
+    uint64_t total_frames = 0;
+    if (g_config.bars_set) {
+        total_frames = grids_jack::FramesForBars(
+            g_config.render_bars, g_pattern_generator.GetFramesPerPulse());
+    }
+
+    // A reader that exits is the normal end of the stream
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "Streaming %s stereo PCM at %u Hz to stdout (%s)...\n",
+            g_config.stream_format == grids_jack::kPcmS16 ? "s16" : "f32", sample_rate,
+            g_config.stream_paced ? "realtime" : "freewheeling");
+
+    grids_jack::RenderResult result;
+    bool ok = grids_jack::RenderToFd(&g_engine, sample_rate, block_size, total_frames,
+                                     STDOUT_FILENO, g_config.stream_format,
+                                     g_config.stream_paced, &result, &g_should_exit);
+
+    double duration = static_cast<double>(result.frames) / sample_rate;
+    double elapsed = result.total_ns / 1e9;
+    fprintf(stderr, "Streamed %.1f s of audio in %.3f s (%.0fx realtime, %.3f s in the engine)\n",
+            duration, elapsed, elapsed > 0.0 ? duration / elapsed : 0.0,
+            result.engine_ns / 1e9);
+
+    if (g_config.verbose) {
+        print_stats_summary();
+    }
+    return ok ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
     fprintf(stderr, "grids-jack: JACK audio client with Grids pattern generator\n");
     fprintf(stderr, "Version 1.0 - Phase 6: Polishing and Testing Complete\n\n");
@@ -305,194 +856,110 @@ int main(int argc, char* argv[]) {
     fprintf(stderr, "Configuration:\n");
     fprintf(stderr, "  Sample directory: %s\n", g_config.sample_directory);
     fprintf(stderr, "  BPM: %.1f\n", g_config.bpm);
+    fprintf(stderr, "  Audio backend: %s\n", g_config.backend);
     fprintf(stderr, "  JACK client name: %s\n", g_config.client_name);
     fprintf(stderr, "  Random parts: %zu\n", g_config.num_parts);
     fprintf(stderr, "  Velocity steps: %zu\n", g_config.num_velocity_steps);
     fprintf(stderr, "  Output gain: %.2f\n", g_config.output_gain);
     fprintf(stderr, "  Humanize: %.2f\n", g_config.humanize);
     fprintf(stderr, "  Spread: %.2f\n", g_config.spread);
+    fprintf(stderr, "  Render threads: %zu\n", g_config.render_threads);
+    if (g_config.trace_file != nullptr) {
+        fprintf(stderr, "  Trace file: %s\n", g_config.trace_file);
+    }
+    if (g_config.render_file != nullptr) {
+        fprintf(stderr, "  Render: %s (%u bars, %u Hz, %u-frame blocks%s)\n",
+                g_config.render_file, g_config.render_bars,
+                g_config.render_sample_rate, g_config.block_size,
+                g_config.render_stems ? ", stems" : "");
+    }
+    if (g_config.stream_stdout) {
+        fprintf(stderr, "  Stream: stdout (%s, %u Hz, %u-frame blocks, %s)\n",
+                g_config.stream_format == grids_jack::kPcmS16 ? "s16" : "f32",
+                g_config.render_sample_rate, g_config.block_size,
+                g_config.stream_paced ? "realtime" : "freewheeling");
+    }
+    if (g_config.midi_file != nullptr) {
+        fprintf(stderr, "  MIDI export: %s (%u bars)\n", g_config.midi_file,
+                g_config.render_bars);
+    }
     fprintf(stderr, "  LFO drift: %s\n", g_config.lfo_enabled ? "enabled" : "disabled");
     fprintf(stderr, "  Verbose mode: %s\n\n", g_config.verbose ? "enabled" : "disabled");
     
     // Setup signal handlers for graceful shutdown
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
-    
-    // Initialize JACK client
-    if (!init_jack()) {
-        fprintf(stderr, "Failed to initialize JACK client\n");
-        return 1;
-    }
-    
-    fprintf(stderr, "JACK client initialized successfully\n");
-    
-    // Get JACK sample rate for sample loading
-    jack_nframes_t sample_rate = jack_get_sample_rate(g_jack_client);
-    
-    // Load samples from directory
-    fprintf(stderr, "\n");
-    if (!g_sample_bank.LoadDirectory(g_config.sample_directory, sample_rate)) {
-        fprintf(stderr, "Error: No samples could be loaded\n");
-        cleanup_jack();
-        return 1;
-    }
-    
-    // Display loaded samples
-    std::vector<uint8_t> notes = g_sample_bank.GetAllNotes();
-    fprintf(stderr, "\nLoaded %zu samples with MIDI notes: ", notes.size());
-    for (size_t i = 0; i < notes.size(); i++) {
-        fprintf(stderr, "%u", notes[i]);
-        if (i < notes.size() - 1) {
-            fprintf(stderr, ", ");
-        }
-    }
-    fprintf(stderr, "\n\n");
-    
-    // Initialize sample player
-    g_sample_player.Init(&g_sample_bank, sample_rate);
-    fprintf(stderr, "Sample player initialized with %zu voice pool\n", grids_jack::kMaxVoices);
-    
-    // Initialize pattern generator
-    g_pattern_generator.Init(&g_sample_player, sample_rate, g_config.bpm);
-    fprintf(stderr, "Pattern generator initialized at %.1f BPM\n", g_config.bpm);
-    
-    // Enable LFO if configured
-    g_pattern_generator.SetLfoEnabled(g_config.lfo_enabled);
 
-    // Set humanization
-    if (g_config.humanize > 0.0f) {
-        g_pattern_generator.SetHumanize(g_config.humanize);
+    // MIDI export: no audio at all
+    if (g_config.midi_file != nullptr) {
+        return run_midi_export();
     }
 
-    // Assign samples to drum parts with random X/Y positions
-    g_pattern_generator.AssignSamplesToParts(notes, g_config.num_parts,
-                                               g_config.num_velocity_steps);
-    // Set stereo spread (assigns pan positions across mappings)
-    if (g_config.spread > 0.0f) {
-        g_pattern_generator.SetSpread(g_config.spread);
+    // PCM stream: no JACK client and no files
+    if (g_config.stream_stdout) {
+        int result = run_stream();
+        close_trace();
+        return result;
     }
 
-    const std::vector<grids_jack::SampleMapping>& mappings =
-        g_pattern_generator.GetSampleMappings();
-    fprintf(stderr, "Selected and assigned %zu samples to drum parts (BD, SD, HH)\n",
-            mappings.size());
+    // Offline render: no JACK client at all
+    if (g_config.render_file != nullptr) {
+        int result = run_render();
+        close_trace();
+        return result;
+    }
     
-    // In verbose mode, show detailed assignments
-    if (g_config.verbose) {
-        fprintf(stderr, "Sample assignments (verbose):\n");
-        for (size_t i = 0; i < mappings.size(); ++i) {
-            const char* part_name = "BD";
-            if (mappings[i].drum_part == grids_jack::DRUM_PART_SD) {
-                part_name = "SD";
-            } else if (mappings[i].drum_part == grids_jack::DRUM_PART_HH) {
-                part_name = "HH";
-            }
-            fprintf(stderr, "  Note %3u -> %s (x=%3u, y=%3u, pan=%+.2f) velocity pattern: ",
-                    mappings[i].midi_note, part_name,
-                    mappings[i].x, mappings[i].y, mappings[i].pan);
-            // Show first 16 steps of velocity pattern (0=low, 1=high)
-            for (int step = 0; step < 16; ++step) {
-                fprintf(stderr, "%u", mappings[i].velocity_pattern[step]);
-            }
-            fprintf(stderr, "...\n");
-        }
-        fprintf(stderr, "Pattern parameters: X=%u, Y=%u, Randomness=%u\n",
-                g_pattern_generator.GetPatternX(),
-                g_pattern_generator.GetPatternY(),
-                g_pattern_generator.GetRandomness());
+    // Open the audio backend
+    if (!init_backend()) {
+        fprintf(stderr, "Failed to initialize %s backend\n", g_config.backend);
+        cleanup_backend();
+        return 1;
+    }
+    
+    fprintf(stderr, "Audio backend initialized successfully\n");
+    
+    // Samples are loaded at the backend's sample rate
+    if (!init_engine(g_backend->GetSampleRate(), g_backend->GetBufferSize(),
+                     g_backend->GetRealtimePriority())) {
+        cleanup_backend();
+        return 1;
     }
 
-    // Print initial pattern
-    g_pattern_generator.PrintCurrentPattern();
-    fprintf(stderr, "\n");
-
-    // Activate JACK client
-    if (jack_activate(g_jack_client) != 0) {
-        fprintf(stderr, "Failed to activate JACK client\n");
-        cleanup_jack();
+    // Start the audio callbacks
+    if (!g_backend->Activate()) {
+        cleanup_backend();
         return 1;
     }
     
-    fprintf(stderr, "JACK client activated\n");
+    fprintf(stderr, "Audio backend activated\n");
     
-    // Auto-connect to system playback ports (optional)
-    const char** ports = jack_get_ports(g_jack_client, nullptr, nullptr,
-                                       JackPortIsPhysical | JackPortIsInput);
-    if (ports != nullptr) {
-        // Connect left channel
-        if (ports[0] != nullptr) {
-            int result = jack_connect(g_jack_client,
-                                     jack_port_name(g_output_port_left),
-                                     ports[0]);
-            if (result == 0) {
-                fprintf(stderr, "Auto-connected output_L to %s\n", ports[0]);
-            } else if (result == EEXIST) {
-                fprintf(stderr, "output_L already connected to %s\n", ports[0]);
-            } else {
-                fprintf(stderr, "Failed to auto-connect output_L to %s (error %d)\n", ports[0], result);
-            }
-        }
-        // Connect right channel
-        if (ports[1] != nullptr) {
-            int result = jack_connect(g_jack_client,
-                                     jack_port_name(g_output_port_right),
-                                     ports[1]);
-            if (result == 0) {
-                fprintf(stderr, "Auto-connected output_R to %s\n", ports[1]);
-            } else if (result == EEXIST) {
-                fprintf(stderr, "output_R already connected to %s\n", ports[1]);
-            } else {
-                fprintf(stderr, "Failed to auto-connect output_R to %s (error %d)\n", ports[1], result);
-            }
-        }
-        jack_free(ports);
-    } else {
-        fprintf(stderr, "No physical playback ports found - skipping auto-connection\n");
-        fprintf(stderr, "You may need to manually connect ports using qjackctl or jack_connect\n");
-    }
-
-    // Auto-connect to OBS Studio JACK input if available
-    const char** obs_ports = jack_get_ports(g_jack_client, "OBS Studio", nullptr,
-                                            JackPortIsInput);
-    if (obs_ports != nullptr) {
-        if (obs_ports[0] != nullptr) {
-            int result = jack_connect(g_jack_client,
-                                     jack_port_name(g_output_port_left),
-                                     obs_ports[0]);
-            if (result == 0) {
-                fprintf(stderr, "Auto-connected output_L to %s\n", obs_ports[0]);
-            } else if (result == EEXIST) {
-                fprintf(stderr, "output_L already connected to %s\n", obs_ports[0]);
-            } else {
-                fprintf(stderr, "Failed to auto-connect output_L to %s (error %d)\n", obs_ports[0], result);
-            }
-        }
-        if (obs_ports[0] != nullptr && obs_ports[1] != nullptr) {
-            int result = jack_connect(g_jack_client,
-                                     jack_port_name(g_output_port_right),
-                                     obs_ports[1]);
-            if (result == 0) {
-                fprintf(stderr, "Auto-connected output_R to %s\n", obs_ports[1]);
-            } else if (result == EEXIST) {
-                fprintf(stderr, "output_R already connected to %s\n", obs_ports[1]);
-            } else {
-                fprintf(stderr, "Failed to auto-connect output_R to %s (error %d)\n", obs_ports[1], result);
-            }
-        }
-        jack_free(obs_ports);
-    }
+    // Auto-connect to system playback (and OBS Studio) if the backend can
+    g_backend->ConnectOutputs();
 
     fprintf(stderr, "\nPress Ctrl+C to exit\n\n");
     
     // Main loop - wait for shutdown signal, print pattern changes
+    // (and xruns plus engine statistics every 5 seconds in verbose mode)
+    int loop_count = 0;
+    uint32_t xruns_printed = 0;
     while (!g_should_exit) {
         g_pattern_generator.PrintPendingPattern();
+        if (g_config.verbose) {
+            print_new_xruns(&xruns_printed);
+            if (++loop_count % 50 == 0) {
+                print_stats_line();
+            }
+        }
         usleep(100000);  // 100ms
     }
     
     // Cleanup
     fprintf(stderr, "Shutting down...\n");
-    cleanup_jack();
+    cleanup_backend();
+
+    print_stats_summary();
+
+    close_trace();
     
     fprintf(stderr, "Goodbye!\n");
     return 0;
@@ -0,0 +1,62 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MEMORY_FOOTPRINT_H_
+#define MEMORY_FOOTPRINT_H_
+
+#include <cstddef>
+
+namespace grids_jack {
+
+// Bytes held by the engine, by category. Components add their share with
+// AddFootprint(); objects count with their full size wherever they live,
+// heap blocks with their capacity. Allocator headers and thread stacks
+// are not included.
+struct MemoryFootprint {
+    size_t sample_data;      // Decoded sample frames
+    size_t sample_padding;   // Sample buffer capacity past the last frame
+    size_t sample_overhead;  // Bank object, map nodes and file names
+    size_t voice_pool;       // Player object: voices, voice lists, counters
+    size_t render_buffers;   // Render pool and worker scratch buses
+    size_t trigger_queue;    // Pending humanized triggers
+    size_t pattern_state;    // Pattern clock, mappings and velocity patterns
+    size_t engine_state;     // Engine object: statistics and histogram
+
+    MemoryFootprint() { Clear(); }
+
+    void Clear() {
+        sample_data = 0;
+        sample_padding = 0;
+        sample_overhead = 0;
+        voice_pool = 0;
+        render_buffers = 0;
+        trigger_queue = 0;
+        pattern_state = 0;
+        engine_state = 0;
+    }
+
+    size_t SampleBytes() const {
+        return sample_data + sample_padding + sample_overhead;
+    }
+
+    size_t Total() const {
+        return SampleBytes() + voice_pool + render_buffers + trigger_queue +
+               pattern_state + engine_state;
+    }
+};
+
+}  // namespace grids_jack
+
+#endif  // MEMORY_FOOTPRINT_H_
@@ -0,0 +1,253 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "midi_export.h"
+
+#include <stdio.h>
+
+namespace grids_jack {
+
+namespace {
+
+// Largest positive SMF division (bit 15 selects SMPTE timing)
+const uint32_t kMaxTicksPerQuarter = 0x7FFF;
+
+// Longest single clock step; triggers do not depend on the block size
+const uint32_t kExportBlockFrames = 65536;
+
+const char* const kPartNames[DRUM_PART_COUNT] = {"BD", "SD", "HH"};
+
+void PutU16(std::vector<uint8_t>* out, uint32_t value) {
+    out->push_back(static_cast<uint8_t>(value >> 8));
+    out->push_back(static_cast<uint8_t>(value));
+}
+
+void PutU32(std::vector<uint8_t>* out, uint32_t value) {
+    PutU16(out, value >> 16);
+    PutU16(out, value & 0xFFFF);
+}
+
+// Variable-length quantity: 7 bits per byte, most significant first
+void PutVarLen(std::vector<uint8_t>* out, uint32_t value) {
+    uint8_t bytes[5];
+    int count = 0;
+    do {
+        bytes[count++] = static_cast<uint8_t>(value & 0x7F);
+        value >>= 7;
+    } while (value != 0);
+    while (count > 1) {
+        out->push_back(bytes[--count] | 0x80);
+    }
+    out->push_back(bytes[0]);
+}
+
+void PutTrackName(std::vector<uint8_t>* out, const std::string& name) {
+    PutVarLen(out, 0);
+    out->push_back(0xFF);
+    out->push_back(0x03);
+    PutVarLen(out, static_cast<uint32_t>(name.size()));
+    out->insert(out->end(), name.begin(), name.end());
+}
+
+void PutEndOfTrack(std::vector<uint8_t>* out, uint32_t delta) {
+    PutVarLen(out, delta);
+    out->push_back(0xFF);
+    out->push_back(0x2F);
+    out->push_back(0x00);
+}
+
+// Write an MTrk chunk
+bool WriteChunk(FILE* file, const char* type, const std::vector<uint8_t>& body) {
+    std::vector<uint8_t> header(type, type + 4);
+    PutU32(&header, static_cast<uint32_t>(body.size()));
+    return fwrite(header.data(), 1, header.size(), file) == header.size() &&
+           fwrite(body.data(), 1, body.size(), file) == body.size();
+}
+
+}  // namespace
+
+MidiExport::MidiExport() : num_notes_(0) {}
+
+void MidiExport::Reset(const std::vector<SampleMapping>& mappings) {
+    tracks_.resize(mappings.size());
+    for (size_t i = 0; i < mappings.size(); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s note %u", kPartNames[mappings[i].drum_part],
+                 static_cast<unsigned>(mappings[i].midi_note));
+        tracks_[i].name = name;
+        tracks_[i].midi_note = mappings[i].midi_note;
+        tracks_[i].notes.clear();
+    }
+    num_notes_ = 0;
+}
+
+void MidiExport::OnTrigger(uint64_t frame, uint16_t mapping, uint8_t midi_note,
+                           float velocity) {
+    (void)midi_note;
+    if (mapping >= tracks_.size()) {
+        return;
+    }
+
+    int value = static_cast<int>(velocity * 127.0f + 0.5f);
+    Note note;
+    note.frame = frame;
+    note.velocity = static_cast<uint8_t>(value < 1 ? 1 : (value > 127 ? 127 : value));
+    tracks_[mapping].notes.push_back(note);
+    num_notes_++;
+}
+
+uint16_t MidiExport::TicksPerQuarter(uint32_t frames_per_pulse) {
+    uint64_t frames_per_quarter = 24 * static_cast<uint64_t>(frames_per_pulse);
+    if (frames_per_quarter == 0 || frames_per_quarter > kMaxTicksPerQuarter) {
+        return kFallbackTicksPerQuarter;
+    }
+    return static_cast<uint16_t>(frames_per_quarter);
+}
+
+void MidiExport::EncodeTrack(const Track& track, uint64_t frames_per_quarter,
+                             uint16_t division, uint64_t end_tick,
+                             std::vector<uint8_t>* out) const {
+    out->clear();
+    PutTrackName(out, track.name);
+
+    uint64_t gate_ticks = static_cast<uint64_t>(division) * kGatePulses / 24;
+    uint64_t last_tick = 0;
+    const std::vector<Note>& notes = track.notes;
+    for (size_t i = 0; i < notes.size(); i++) {
+        uint64_t on_tick = (notes[i].frame * division + frames_per_quarter / 2) /
+                           frames_per_quarter;
+        uint8_t velocity = notes[i].velocity;
+
+        // Hits landing on the same tick become one note at the louder velocity
+        while (i + 1 < notes.size()) {
+            uint64_t next_tick = (notes[i + 1].frame * division + frames_per_quarter / 2) /
+                                 frames_per_quarter;
+            if (next_tick != on_tick) {
+                break;
+            }
+            if (notes[i + 1].velocity > velocity) {
+                velocity = notes[i + 1].velocity;
+            }
+            i++;
+        }
+
+        // Hold for the gate, but release before the next hit
+        uint64_t off_tick = on_tick + gate_ticks;
+        if (i + 1 < notes.size()) {
+            uint64_t next_tick = (notes[i + 1].frame * division + frames_per_quarter / 2) /
+                                 frames_per_quarter;
+            if (next_tick < off_tick) {
+                off_tick = next_tick;
+            }
+        }
+
+        PutVarLen(out, static_cast<uint32_t>(on_tick - last_tick));
+        out->push_back(0x90 | kChannel);
+        out->push_back(track.midi_note);
+        out->push_back(velocity);
+        PutVarLen(out, static_cast<uint32_t>(off_tick - on_tick));
+        out->push_back(0x80 | kChannel);
+        out->push_back(track.midi_note);
+        out->push_back(0);
+        last_tick = off_tick;
+    }
+
+    PutEndOfTrack(out, static_cast<uint32_t>(end_tick > last_tick ? end_tick - last_tick : 0));
+}
+
+bool MidiExport::Write(const char* path, uint32_t sample_rate, uint32_t frames_per_pulse,
+                       uint64_t total_frames) const {
+    uint16_t division = TicksPerQuarter(frames_per_pulse);
+    uint64_t frames_per_quarter = 24 * static_cast<uint64_t>(frames_per_pulse);
+    uint64_t end_tick = (total_frames * division + frames_per_quarter / 2) / frames_per_quarter;
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Error: Could not create %s\n", path);
+        return false;
+    }
+
+    std::vector<uint8_t> chunk;
+    PutU16(&chunk, 1);  // Format 1: simultaneous tracks
+    PutU16(&chunk, static_cast<uint32_t>(tracks_.size() + 1));
+    PutU16(&chunk, division);
+    bool ok = WriteChunk(file, "MThd", chunk);
+
+    // Tempo track: name, tempo of the actual (integer) clock period, 4/4
+    chunk.clear();
+    PutTrackName(&chunk, "grids-jack");
+    uint32_t usec_per_quarter = static_cast<uint32_t>(
+        (frames_per_quarter * 1000000 + sample_rate / 2) / sample_rate);
+    PutVarLen(&chunk, 0);
+    chunk.push_back(0xFF);
+    chunk.push_back(0x51);
+    chunk.push_back(0x03);
+    chunk.push_back(static_cast<uint8_t>(usec_per_quarter >> 16));
+    chunk.push_back(static_cast<uint8_t>(usec_per_quarter >> 8));
+    chunk.push_back(static_cast<uint8_t>(usec_per_quarter));
+    PutVarLen(&chunk, 0);
+    chunk.push_back(0xFF);
+    chunk.push_back(0x58);
+    chunk.push_back(0x04);
+    chunk.push_back(4);     // Numerator
+    chunk.push_back(2);     // Denominator 2^2
+    chunk.push_back(24);    // MIDI clocks per metronome click
+    chunk.push_back(8);     // 32nd notes per quarter
+    PutEndOfTrack(&chunk, static_cast<uint32_t>(end_tick));
+    ok = ok && WriteChunk(file, "MTrk", chunk);
+
+    for (size_t i = 0; i < tracks_.size() && ok; i++) {
+        EncodeTrack(tracks_[i], frames_per_quarter, division, end_tick, &chunk);
+        ok = WriteChunk(file, "MTrk", chunk);
+    }
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Write to %s failed\n", path);
+    }
+    return ok;
+}
+
+bool ExportMidi(PatternGeneratorWrapper* pattern_generator, uint32_t sample_rate,
+                uint64_t total_frames, const char* path, size_t* num_notes) {
+    MidiExport midi;
+    midi.Reset(pattern_generator->GetSampleMappings());
+    pattern_generator->SetTriggerListener(&midi);
+
+    // Skip to the frame before each event in one step, then run the event
+    // frame alone, so the per-frame loop only ever sees single frames
+    for (uint64_t done = 0; done < total_frames;) {
+        uint32_t next = pattern_generator->FramesUntilNextEvent();
+        uint32_t frames = next > 1 ? next - 1 : 1;
+        if (frames > kExportBlockFrames) {
+            frames = kExportBlockFrames;
+        }
+        if (total_frames - done < frames) {
+            frames = static_cast<uint32_t>(total_frames - done);
+        }
+        pattern_generator->Process(frames);
+        done += frames;
+    }
+    pattern_generator->SetTriggerListener(nullptr);
+
+    if (num_notes != nullptr) {
+        *num_notes = midi.GetNoteCount();
+    }
+    return midi.Write(path, sample_rate, pattern_generator->GetFramesPerPulse(), total_frames);
+}
+
+}  // namespace grids_jack
@@ -0,0 +1,91 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MIDI_EXPORT_H_
+#define MIDI_EXPORT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pattern_generator_wrapper.h"
+
+namespace grids_jack {
+
+// Collects triggers and writes them as a Type-1 Standard MIDI File: a
+// tempo track followed by one track per sample mapping, notes on the
+// General MIDI drum channel
+//
+// Ticks are frames whenever a quarter note fits the 15-bit SMF division
+// (24 * frames_per_pulse <= 32767, e.g. from 88 BPM up at 48 kHz), so
+// note times are the exact frames the triggers are due on, humanize
+// included. Slower tempos round to the nearest 1/kFallbackTicksPerQuarter.
+// The rendered audio is quantized to the render block instead (voices
+// start on the first frame of the block a trigger falls in), so a hit in
+// a WAV from the same render can sound up to one block before its note.
+class MidiExport : public TriggerListener {
+public:
+    static constexpr uint8_t kChannel = 9;                 // MIDI channel 10
+    static constexpr uint32_t kGatePulses = 6;             // Sixteenth note
+    static constexpr uint16_t kFallbackTicksPerQuarter = 7680;
+
+    MidiExport();
+
+    // Start collecting for these mappings (drops anything collected)
+    void Reset(const std::vector<SampleMapping>& mappings);
+
+    void OnTrigger(uint64_t frame, uint16_t mapping, uint8_t midi_note, float velocity);
+
+    // Notes collected since Reset
+    size_t GetNoteCount() const { return num_notes_; }
+
+    // SMF division used for a clock period
+    static uint16_t TicksPerQuarter(uint32_t frames_per_pulse);
+
+    // Write the collected notes; total_frames sets the length of every
+    // track. Returns false on I/O errors
+    bool Write(const char* path, uint32_t sample_rate, uint32_t frames_per_pulse,
+               uint64_t total_frames) const;
+
+private:
+    struct Note {
+        uint64_t frame;
+        uint8_t velocity;
+    };
+
+    struct Track {
+        std::string name;
+        uint8_t midi_note;
+        std::vector<Note> notes;
+    };
+
+    // Encode one mapping's notes as an MTrk chunk body
+    void EncodeTrack(const Track& track, uint64_t frames_per_quarter, uint16_t division,
+                     uint64_t end_tick, std::vector<uint8_t>* out) const;
+
+    std::vector<Track> tracks_;
+    size_t num_notes_;
+};
+
+// Run the pattern generator's clock for total_frames without rendering
+// audio and write every trigger to a MIDI file at path. Initialize the
+// generator with a nullptr sample player (or pause audio) beforehand.
+// num_notes (optional) receives the note count.
+bool ExportMidi(PatternGeneratorWrapper* pattern_generator, uint32_t sample_rate,
+                uint64_t total_frames, const char* path, size_t* num_notes = nullptr);
+
+}  // namespace grids_jack
+
+#endif  // MIDI_EXPORT_H_
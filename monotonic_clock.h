@@ -0,0 +1,45 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MONOTONIC_CLOCK_H_
+#define MONOTONIC_CLOCK_H_
+
+#include <errno.h>
+#include <time.h>
+
+#include <cstdint>
+
+namespace grids_jack {
+
+// Monotonic clock in nanoseconds (vDSO on Linux, no system call)
+inline uint64_t MonotonicNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+           static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Sleep until MonotonicNanos() reaches deadline_ns (NOT realtime-safe)
+inline void SleepUntil(uint64_t deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(deadline_ns / 1000000000ull);
+    ts.tv_nsec = static_cast<long>(deadline_ns % 1000000000ull);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+}  // namespace grids_jack
+
+#endif  // MONOTONIC_CLOCK_H_
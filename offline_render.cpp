@@ -0,0 +1,255 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "offline_render.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "denormals.h"
+#include "monotonic_clock.h"
+#include "wav_writer.h"
+
+namespace grids_jack {
+
+namespace {
+
+// Write all of data, retrying short writes
+// Returns 0, or the errno of the failed write
+int WriteAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return 0;
+}
+
+// Interleave one block into out as 16-bit PCM
+void InterleaveS16(const float* left, const float* right, uint32_t num_frames,
+                   int16_t* out) {
+    for (uint32_t i = 0; i < num_frames; i++) {
+        float l = left[i] * 32767.0f;
+        float r = right[i] * 32767.0f;
+        l = l > 32767.0f ? 32767.0f : (l < -32768.0f ? -32768.0f : l);
+        r = r > 32767.0f ? 32767.0f : (r < -32768.0f ? -32768.0f : r);
+        out[2 * i] = static_cast<int16_t>(lrintf(l));
+        out[2 * i + 1] = static_cast<int16_t>(lrintf(r));
+    }
+}
+
+}  // namespace
+
+uint64_t FramesForBars(uint32_t bars, uint32_t frames_per_pulse) {
+    // Whole bars of 4 quarter notes at 24 pulses each, on the clock grid
+    return static_cast<uint64_t>(bars) * 96 * frames_per_pulse;
+}
+
+std::string StemPath(const char* path, const char* suffix) {
+    std::string base(path);
+    if (base.size() > 4 && base.compare(base.size() - 4, 4, ".wav") == 0) {
+        base.erase(base.size() - 4);
+    }
+    return base + "_" + suffix + ".wav";
+}
+
+bool RenderToWav(AudioEngine* engine, uint32_t sample_rate, uint32_t block_size,
+                 uint64_t total_frames, const char* path, RenderResult* result,
+                 const volatile bool* cancel, const std::vector<SampleMapping>* stems) {
+    result->frames = 0;
+    result->engine_ns = 0;
+    result->total_ns = 0;
+    result->files = 0;
+    result->stalls = 0;
+
+    static const char* const kPartSuffixes[DRUM_PART_COUNT] = {"bd", "sd", "hh"};
+    size_t num_mappings = stems != nullptr ? stems->size() : 0;
+
+    // Writer 0 is the mix, then one per drum part, then one per mapping
+    std::vector<std::string> paths(1, path);
+    if (num_mappings > 0) {
+        for (int part = 0; part < DRUM_PART_COUNT; part++) {
+            paths.push_back(StemPath(path, kPartSuffixes[part]));
+        }
+        for (size_t m = 0; m < num_mappings; m++) {
+            char suffix[32];
+            snprintf(suffix, sizeof(suffix), "m%zu_note%u", m,
+                     static_cast<unsigned>((*stems)[m].midi_note));
+            paths.push_back(StemPath(path, suffix));
+        }
+    }
+
+    std::vector<WavWriter> writers(paths.size());
+    for (size_t f = 0; f < writers.size(); f++) {
+        if (!writers[f].Open(paths[f].c_str(), sample_rate, block_size)) {
+            return false;
+        }
+    }
+    result->files = static_cast<uint32_t>(writers.size());
+
+    // Planar L/R buffers: the mix, the part stems, the mapping buses
+    std::vector<float> buffers(2 * writers.size() * block_size);
+    std::vector<float*> channels(2 * writers.size());
+    for (size_t c = 0; c < channels.size(); c++) {
+        channels[c] = &buffers[c * block_size];
+    }
+    float** part_channels = &channels[2];
+    float* const* bus_channels = &channels[2 + 2 * DRUM_PART_COUNT];
+
+    // Same floating-point mode as the audio thread
+    ScopedDenormalsOff denormals_off;
+
+    uint64_t start_ns = MonotonicNanos();
+    while (result->frames < total_frames && (cancel == nullptr || !*cancel)) {
+        uint32_t frames = block_size;
+        if (total_frames - result->frames < frames) {
+            frames = static_cast<uint32_t>(total_frames - result->frames);
+        }
+
+        uint64_t block_start_ns = MonotonicNanos();
+        if (num_mappings > 0) {
+            engine->ProcessStems(channels[0], channels[1], bus_channels, num_mappings, frames);
+        } else {
+            engine->Process(channels[0], channels[1], frames);
+        }
+        result->engine_ns += MonotonicNanos() - block_start_ns;
+
+        // Part stems are the sum of their mappings' buses
+        if (num_mappings > 0) {
+            for (size_t c = 0; c < 2 * DRUM_PART_COUNT; c++) {
+                memset(part_channels[c], 0, frames * sizeof(float));
+            }
+            for (size_t m = 0; m < num_mappings; m++) {
+                int part = (*stems)[m].drum_part;
+                for (int side = 0; side < 2; side++) {
+                    float* dst = part_channels[2 * part + side];
+                    const float* src = bus_channels[2 * m + side];
+                    for (uint32_t i = 0; i < frames; i++) {
+                        dst[i] += src[i];
+                    }
+                }
+            }
+        }
+
+        for (size_t f = 0; f < writers.size(); f++) {
+            writers[f].Write(channels[2 * f], channels[2 * f + 1], frames);
+        }
+        result->frames += frames;
+    }
+
+    bool ok = true;
+    for (size_t f = 0; f < writers.size(); f++) {
+        if (!writers[f].Close()) {
+            ok = false;
+        }
+        result->stalls += writers[f].GetStallCount();
+    }
+    result->total_ns = MonotonicNanos() - start_ns;
+    return ok;
+}
+
+bool RenderToFd(AudioEngine* engine, uint32_t sample_rate, uint32_t block_size,
+                uint64_t total_frames, int fd, PcmFormat format, bool paced,
+                RenderResult* result, const volatile bool* cancel) {
+    result->frames = 0;
+    result->engine_ns = 0;
+    result->total_ns = 0;
+    result->files = 0;
+    result->stalls = 0;
+
+    uint32_t blocks_per_write = (kStreamWriteFrames + block_size - 1) / block_size;
+    size_t sample_bytes = format == kPcmS16 ? sizeof(int16_t) : sizeof(float);
+    size_t frame_bytes = 2 * sample_bytes;
+    std::vector<uint8_t> output(static_cast<size_t>(blocks_per_write) * block_size * frame_bytes);
+    std::vector<float> left(block_size);
+    std::vector<float> right(block_size);
+
+    // Same floating-point mode as the audio thread
+    ScopedDenormalsOff denormals_off;
+
+    uint64_t start_ns = MonotonicNanos();
+    size_t pending_bytes = 0;
+    bool ok = true;
+    bool reader_gone = false;
+    while ((total_frames == 0 || result->frames < total_frames) &&
+           (cancel == nullptr || !*cancel)) {
+        uint32_t frames = block_size;
+        if (total_frames != 0 && total_frames - result->frames < frames) {
+            frames = static_cast<uint32_t>(total_frames - result->frames);
+        }
+
+        uint64_t block_start_ns = MonotonicNanos();
+        engine->Process(left.data(), right.data(), frames);
+        result->engine_ns += MonotonicNanos() - block_start_ns;
+
+        uint8_t* out = &output[pending_bytes];
+        if (format == kPcmS16) {
+            InterleaveS16(left.data(), right.data(), frames, reinterpret_cast<int16_t*>(out));
+        } else {
+            float* interleaved = reinterpret_cast<float*>(out);
+            for (uint32_t i = 0; i < frames; i++) {
+                interleaved[2 * i] = left[i];
+                interleaved[2 * i + 1] = right[i];
+            }
+        }
+        pending_bytes += frames * frame_bytes;
+        result->frames += frames;
+
+        bool last = total_frames != 0 && result->frames >= total_frames;
+        if (pending_bytes + block_size * frame_bytes > output.size() || last) {
+            int error = WriteAll(fd, output.data(), pending_bytes);
+            pending_bytes = 0;
+            if (error == EPIPE) {
+                reader_gone = true;
+                break;
+            }
+            if (error != 0) {
+                fprintf(stderr, "Error: Write failed: %s\n", strerror(error));
+                ok = false;
+                break;
+            }
+        }
+
+        if (paced) {
+            SleepUntil(start_ns + result->frames * 1000000000ull / sample_rate);
+        }
+    }
+
+    // Whatever is left after a cancel
+    if (ok && !reader_gone && pending_bytes > 0) {
+        int error = WriteAll(fd, output.data(), pending_bytes);
+        if (error != 0 && error != EPIPE) {
+            fprintf(stderr, "Error: Write failed: %s\n", strerror(error));
+            ok = false;
+        }
+    }
+
+    result->total_ns = MonotonicNanos() - start_ns;
+    return ok;
+}
+
+}  // namespace grids_jack
@@ -0,0 +1,80 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef OFFLINE_RENDER_H_
+#define OFFLINE_RENDER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio_engine.h"
+#include "pattern_generator_wrapper.h"
+
+namespace grids_jack {
+
+// Outcome of RenderToWav
+struct RenderResult {
+    uint64_t frames;       // Frames written
+    uint64_t engine_ns;    // Time spent in AudioEngine::Process
+    uint64_t total_ns;     // Wall time including file writes
+    uint32_t files;        // WAV files written (mix plus stems)
+    uint64_t stalls;       // Blocks that waited for a writer thread
+};
+
+// Sample format of RenderToFd (interleaved stereo, host byte order)
+enum PcmFormat {
+    kPcmFloat32,    // 32-bit float
+    kPcmS16,        // Signed 16-bit, clipped to full scale
+};
+
+// Frames collected before each write() in RenderToFd
+const uint32_t kStreamWriteFrames = 4096;
+
+// Frames in a whole number of bars (4/4, 24 pulses per quarter note)
+uint64_t FramesForBars(uint32_t bars, uint32_t frames_per_pulse);
+
+// Stem file name for a render to path: "<base>_<suffix>.wav", where base
+// is path without a trailing ".wav"
+std::string StemPath(const char* path, const char* suffix);
+
+// Render total_frames through engine in blocks of block_size and write
+// them to a 32-bit float stereo WAV file at path. Stops early (and still
+// closes the file) if *cancel becomes true. Returns false on I/O errors.
+//
+// With stems (the engine's sample mappings), the same pass also writes
+// one file per drum part (_bd, _sd, _hh) and one per mapping
+// (_m<index>_note<note>), each post-gain like the mix. Every file is
+// encoded on its own writer thread.
+bool RenderToWav(AudioEngine* engine, uint32_t sample_rate, uint32_t block_size,
+                 uint64_t total_frames, const char* path, RenderResult* result,
+                 const volatile bool* cancel = nullptr,
+                 const std::vector<SampleMapping>* stems = nullptr);
+
+// Render through engine in blocks of block_size and stream the result as
+// raw PCM to fd (stdout, for piping into an encoder). Blocks are
+// converted into one reusable buffer that is written out every
+// kStreamWriteFrames frames (rounded up to whole blocks).
+// total_frames = 0 streams until *cancel becomes true or the reader
+// closes the pipe (SIGPIPE must be ignored). paced holds the stream to
+// wall-clock time; otherwise it runs as fast as the reader accepts.
+// Returns false on write errors other than a closed pipe.
+bool RenderToFd(AudioEngine* engine, uint32_t sample_rate, uint32_t block_size,
+                uint64_t total_frames, int fd, PcmFormat format, bool paced,
+                RenderResult* result, const volatile bool* cancel = nullptr);
+
+}  // namespace grids_jack
+
+#endif  // OFFLINE_RENDER_H_
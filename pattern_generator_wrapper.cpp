@@ -42,10 +42,19 @@ PatternGeneratorWrapper::PatternGeneratorWrapper()
       pattern_changed_(false),
       humanize_amount_(0.0f),
       humanize_max_frames_(0),
-      humanize_rng_state_(0) {
+      num_pending_triggers_(0),
+      pending_overflows_(0),
+      humanize_rng_state_(0),
+      trace_(nullptr),
+      listener_(nullptr),
+      frame_count_(0),
+      block_offset_(0) {
   for (size_t i = 0; i < kMaxPendingTriggers; ++i) {
     pending_triggers_[i].active = false;
   }
+  for (int i = 0; i < DRUM_PART_COUNT; ++i) {
+    part_triggers_[i] = 0;
+  }
 }
 
 PatternGeneratorWrapper::~PatternGeneratorWrapper() {
@@ -63,8 +72,7 @@ void PatternGeneratorWrapper::Init(SamplePlayer* sample_player,
   grids::PatternGenerator::Init();
   
   // Initialize random seed with current time
-  srand(static_cast<unsigned int>(time(nullptr)));
-  avrlib::Random::Seed(static_cast<uint32_t>(rand()));
+  Seed(static_cast<uint32_t>(time(nullptr)));
   
   // Set default pattern parameters (center of map)
   grids::PatternGeneratorSettings* settings =
@@ -87,7 +95,19 @@ void PatternGeneratorWrapper::Init(SamplePlayer* sample_player,
   pending_pattern_y_ = 0;
   pattern_changed_ = false;
 
+  for (int i = 0; i < DRUM_PART_COUNT; ++i) {
+    part_triggers_[i] = 0;
+  }
+  pending_overflows_ = 0;
+  frame_count_ = 0;
+  block_offset_ = 0;
+
   UpdateFramesPerPulse();
+}
+
+void PatternGeneratorWrapper::Seed(uint32_t seed) {
+  srand(seed);
+  avrlib::Random::Seed(static_cast<uint32_t>(rand()));
 
   // Seed humanize RNG
   humanize_rng_state_ = static_cast<uint32_t>(rand());
@@ -192,6 +212,15 @@ void PatternGeneratorWrapper::SetSpread(float spread) {
   }
 }
 
+void PatternGeneratorWrapper::AddFootprint(MemoryFootprint* footprint) const {
+  footprint->trigger_queue += sizeof(pending_triggers_);
+  footprint->pattern_state += sizeof(*this) - sizeof(pending_triggers_) +
+      sample_mappings_.capacity() * sizeof(SampleMapping);
+  for (const SampleMapping& mapping : sample_mappings_) {
+    footprint->pattern_state += mapping.velocity_pattern.capacity();
+  }
+}
+
 uint32_t PatternGeneratorWrapper::HumanizeRand() {
   humanize_rng_state_ = humanize_rng_state_ * 1664525u + 1013904223u;
   return humanize_rng_state_;
@@ -199,45 +228,105 @@ uint32_t PatternGeneratorWrapper::HumanizeRand() {
 
 void PatternGeneratorWrapper::QueueHumanizedTrigger(uint8_t midi_note,
                                                      float velocity,
-                                                     float pan) {
+                                                     float pan,
+                                                     uint8_t part,
+                                                     uint16_t mapping) {
   for (size_t i = 0; i < kMaxPendingTriggers; ++i) {
     if (!pending_triggers_[i].active) {
+      int32_t delay =
+          static_cast<int32_t>(HumanizeRand() % (2 * humanize_max_frames_ + 1));
       pending_triggers_[i].midi_note = midi_note;
       pending_triggers_[i].velocity = velocity;
       pending_triggers_[i].pan = pan;
-      pending_triggers_[i].delay_frames =
-          static_cast<int32_t>(HumanizeRand() % (2 * humanize_max_frames_ + 1));
+      pending_triggers_[i].delay_frames = delay;
+      // The clock runs humanize_max_frames_ ahead of the grid, and a
+      // zero delay still fires on the next frame
+      pending_triggers_[i].jitter_frames =
+          (delay > 1 ? delay : 1) - static_cast<int32_t>(humanize_max_frames_);
+      pending_triggers_[i].part = part;
+      pending_triggers_[i].mapping = mapping;
       pending_triggers_[i].active = true;
+      num_pending_triggers_++;
       return;
     }
   }
   // Queue full - fire immediately
-  sample_player_->Trigger(midi_note, velocity, pan);
+  pending_overflows_++;
+  FireTrigger(midi_note, velocity, pan, part, mapping,
+              -static_cast<int32_t>(humanize_max_frames_), kTraceQueueFull);
 }
 
 void PatternGeneratorWrapper::ProcessPendingTriggers() {
+  if (num_pending_triggers_ == 0) {
+    return;
+  }
   for (size_t i = 0; i < kMaxPendingTriggers; ++i) {
     if (pending_triggers_[i].active) {
       if (--pending_triggers_[i].delay_frames <= 0) {
-        sample_player_->Trigger(pending_triggers_[i].midi_note,
-                                pending_triggers_[i].velocity,
-                                pending_triggers_[i].pan);
+        FireTrigger(pending_triggers_[i].midi_note,
+                    pending_triggers_[i].velocity,
+                    pending_triggers_[i].pan,
+                    pending_triggers_[i].part,
+                    pending_triggers_[i].mapping,
+                    pending_triggers_[i].jitter_frames,
+                    kTraceHumanized);
         pending_triggers_[i].active = false;
+        num_pending_triggers_--;
       }
     }
   }
 }
 
+uint32_t PatternGeneratorWrapper::FramesUntilNextEvent() const {
+  // The per-frame loop counts the frame before comparing, so a pulse is
+  // due frames_per_pulse_ - frames_since_last_tick_ frames from now
+  uint32_t next = 1;
+  if (frames_since_last_tick_ < frames_per_pulse_) {
+    next = frames_per_pulse_ - frames_since_last_tick_;
+  }
+
+  // A pending trigger fires on the frame its delay counts down to zero,
+  // even if humanize has been turned off since it was queued
+  if (num_pending_triggers_ > 0) {
+    for (size_t i = 0; i < kMaxPendingTriggers; ++i) {
+      if (pending_triggers_[i].active) {
+        int32_t delay = pending_triggers_[i].delay_frames;
+        uint32_t due = delay > 1 ? static_cast<uint32_t>(delay) : 1;
+        if (due < next) {
+          next = due;
+        }
+      }
+    }
+  }
+
+  return next;
+}
+
 void PatternGeneratorWrapper::Process(uint32_t num_frames) {
-  if (sample_player_ == nullptr) {
+  if (sample_player_ == nullptr && listener_ == nullptr) {
     return;
   }
-  
+
+  // Fast path: nothing fires in this block, so advancing the counters in
+  // one step is equivalent to the per-frame loop below
+  if (FramesUntilNextEvent() > num_frames) {
+    frames_since_last_tick_ += num_frames;
+    if (num_pending_triggers_ > 0) {
+      for (size_t i = 0; i < kMaxPendingTriggers; ++i) {
+        if (pending_triggers_[i].active) {
+          pending_triggers_[i].delay_frames -= static_cast<int32_t>(num_frames);
+        }
+      }
+    }
+    frame_count_ += num_frames;
+    return;
+  }
+
   for (uint32_t i = 0; i < num_frames; ++i) {
+    block_offset_ = i;
+
     // Process pending humanized triggers
-    if (humanize_max_frames_ > 0) {
-      ProcessPendingTriggers();
-    }
+    ProcessPendingTriggers();
 
     frames_since_last_tick_++;
 
@@ -287,12 +376,16 @@ void PatternGeneratorWrapper::Process(uint32_t num_frames) {
       grids::PatternGenerator::IncrementPulseCounter();
     }
   }
+
+  frame_count_ += num_frames;
 }
 
 void PatternGeneratorWrapper::ProcessTriggers(uint8_t state) {
   // Check each drum part trigger bit
   for (int part = 0; part < grids::kNumParts; ++part) {
     if (state & (1 << part)) {
+      part_triggers_[part]++;
+
       // This part has a trigger, find all samples assigned to it
       for (size_t i = 0; i < sample_mappings_.size(); ++i) {
         if (sample_mappings_[i].drum_part == static_cast<DrumPart>(part)) {
@@ -303,9 +396,12 @@ void PatternGeneratorWrapper::ProcessTriggers(uint8_t state) {
           // Trigger the sample with computed velocity and pan
           float pan = sample_mappings_[i].pan;
           if (humanize_max_frames_ > 0) {
-            QueueHumanizedTrigger(sample_mappings_[i].midi_note, velocity, pan);
+            QueueHumanizedTrigger(sample_mappings_[i].midi_note, velocity, pan,
+                                  static_cast<uint8_t>(part),
+                                  static_cast<uint16_t>(i));
           } else {
-            sample_player_->Trigger(sample_mappings_[i].midi_note, velocity, pan);
+            FireTrigger(sample_mappings_[i].midi_note, velocity, pan,
+                        static_cast<uint8_t>(part), static_cast<uint16_t>(i), 0, 0);
           }
           
           // Step the velocity pattern forward (only when triggered)
@@ -318,6 +414,45 @@ void PatternGeneratorWrapper::ProcessTriggers(uint8_t state) {
   }
 }
 
+void PatternGeneratorWrapper::FireTrigger(uint8_t midi_note, float velocity,
+                                          float pan, uint8_t part,
+                                          uint16_t mapping, int32_t jitter,
+                                          uint8_t flags) {
+  // REALTIME-SAFE: No allocations, no locks, no system calls
+  if (listener_ != nullptr) {
+    listener_->OnTrigger(frame_count_ + block_offset_, mapping, midi_note,
+                         velocity);
+  }
+  if (sample_player_ == nullptr) {
+    return;
+  }
+
+  if (trace_ == nullptr) {
+    sample_player_->Trigger(midi_note, velocity, pan, nullptr, mapping);
+    return;
+  }
+
+  TriggerInfo info;
+  sample_player_->Trigger(midi_note, velocity, pan, &info, mapping);
+
+  TraceRecord record;
+  record.frame = frame_count_ + block_offset_;
+  record.block_offset = block_offset_;
+  record.jitter = jitter;
+  record.velocity = velocity;
+  record.pan = pan;
+  record.voice = info.voice;
+  record.type = kTraceTrigger;
+  record.note = midi_note;
+  record.part = part;
+  record.flags = flags;
+  if (info.stolen) record.flags |= kTraceStolen;
+  if (info.coalesced) record.flags |= kTraceCoalesced;
+  record.x = GetPatternX();
+  record.y = GetPatternY();
+  trace_->Record(record);
+}
+
 bool PatternGeneratorWrapper::EvaluateVelocityPattern(
     const SampleMapping& mapping) const {
   // Read the velocity pattern value at the current step
@@ -343,6 +478,12 @@ void PatternGeneratorWrapper::SetRandomness(uint8_t randomness) {
   settings->options.drums.randomness = randomness;
 }
 
+void PatternGeneratorWrapper::SetDensity(DrumPart part, uint8_t density) {
+  grids::PatternGeneratorSettings* settings =
+      grids::PatternGenerator::mutable_settings();
+  settings->density[part] = density;
+}
+
 uint8_t PatternGeneratorWrapper::GetPatternX() const {
   return grids::PatternGenerator::mutable_settings()->options.drums.x;
 }
@@ -355,6 +496,10 @@ uint8_t PatternGeneratorWrapper::GetRandomness() const {
   return grids::PatternGenerator::mutable_settings()->options.drums.randomness;
 }
 
+uint8_t PatternGeneratorWrapper::GetDensity(DrumPart part) const {
+  return grids::PatternGenerator::mutable_settings()->density[part];
+}
+
 void PatternGeneratorWrapper::ComputePatternBits(
     uint32_t bits[DRUM_PART_COUNT], uint8_t x, uint8_t y) const {
   grids::PatternGeneratorSettings* settings =
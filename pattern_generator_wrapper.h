@@ -19,6 +19,8 @@
 #include <stdint.h>
 #include <vector>
 
+#include "event_trace.h"
+#include "memory_footprint.h"
 #include "sample_player.h"
 #include "grids/pattern_generator.h"
 
@@ -31,6 +33,9 @@ struct PendingTrigger {
   float velocity;
   float pan;
   int32_t delay_frames;
+  int32_t jitter_frames;  // Offset from the grid position (for tracing)
+  uint8_t part;
+  uint16_t mapping;       // Index into the sample mappings (stem bus)
   bool active;
 };
 
@@ -58,14 +63,35 @@ struct SampleMapping {
   float lfo_y_freq;   // LFO frequency for y (radians per frame)
 };
 
+// Receives every trigger the pattern generator fires (see
+// PatternGeneratorWrapper::SetTriggerListener)
+class TriggerListener {
+ public:
+  virtual ~TriggerListener() {}
+
+  // frame: frames since Init, including humanize jitter
+  // mapping: index into GetSampleMappings()
+  // Called on the thread running Process, so live listeners must be
+  // realtime-safe
+  virtual void OnTrigger(uint64_t frame, uint16_t mapping, uint8_t midi_note,
+                         float velocity) = 0;
+};
+
 class PatternGeneratorWrapper {
  public:
   PatternGeneratorWrapper();
   ~PatternGeneratorWrapper();
   
   // Initialize with sample player, sample rate, and BPM
+  // sample_player may be nullptr to only generate triggers for a
+  // TriggerListener (no audio)
   void Init(SamplePlayer* sample_player, uint32_t sample_rate, float bpm);
   
+  // Reseed every random source (sample selection, velocity patterns, LFO
+  // phases, Grids randomness, humanize). Init seeds from the clock; call
+  // this after Init and before AssignSamplesToParts for a repeatable run
+  void Seed(uint32_t seed);
+
   // Assign samples to drum parts with random X/Y positions
   // num_parts: how many random samples to select
   // num_velocity_steps: length of random velocity pattern per sample
@@ -74,23 +100,36 @@ class PatternGeneratorWrapper {
   
   // Process audio block and generate triggers
   // This should be called from the JACK process callback
+  // Blocks with no pulse or pending trigger only advance the clock
   void Process(uint32_t num_frames);
+
+  // Frames until the next pulse or humanized trigger, counting the frame
+  // it happens on (1 = the first frame of the next Process call)
+  // Realtime-safe; an event is due in a block iff this is <= num_frames
+  uint32_t FramesUntilNextEvent() const;
   
   // Set tempo (BPM)
   void SetTempo(float bpm);
   
   // Get current tempo
   float GetTempo() const { return bpm_; }
+
+  // Get clock period in frames (24 pulses per quarter note)
+  uint32_t GetFramesPerPulse() const { return frames_per_pulse_; }
   
   // Set pattern parameters
   void SetPatternX(uint8_t x);
   void SetPatternY(uint8_t y);
   void SetRandomness(uint8_t randomness);
+
+  // Set fill density of one part (0 = silent, 255 = every step)
+  void SetDensity(DrumPart part, uint8_t density);
   
   // Get pattern parameters
   uint8_t GetPatternX() const;
   uint8_t GetPatternY() const;
   uint8_t GetRandomness() const;
+  uint8_t GetDensity(DrumPart part) const;
   
   // Enable/disable LFO modulation of x/y positions
   void SetLfoEnabled(bool enabled) { lfo_enabled_ = enabled; }
@@ -104,17 +143,49 @@ class PatternGeneratorWrapper {
   void SetSpread(float spread);
   float GetSpread() const { return spread_; }
 
+  // Record every trigger into an event trace (nullptr to disable)
+  // Set before the audio callback starts; the trace must outlive Process
+  void SetTrace(EventTrace* trace) { trace_ = trace; }
+
+  // Report every trigger to a listener (nullptr to disable)
+  // Set before Process is first called; the listener must outlive it
+  void SetTriggerListener(TriggerListener* listener) { listener_ = listener; }
+
+  // Frames processed since Init
+  uint64_t GetFrameCount() const { return frame_count_; }
+
   // Print the current pattern to stderr
   void PrintCurrentPattern();
 
   // Check if pattern changed (call from main thread, prints if changed)
   void PrintPendingPattern();
 
+  // Get number of pattern hits per drum part since Init (for statistics)
+  uint64_t GetPartTriggerCount(DrumPart part) const {
+    return part_triggers_[part];
+  }
+
+  // Get number of humanized triggers waiting to fire
+  uint32_t GetPendingTriggerCount() const { return num_pending_triggers_; }
+
+  // Get number of humanized triggers fired early because the queue was full
+  uint64_t GetPendingOverflowCount() const { return pending_overflows_; }
+
+  // Compute pattern bitmasks (bit n set = step n fires) for a map
+  // position at the current densities and pattern length
+  // Realtime-safe; used for pattern display and benchmarks
+  void ComputePatternBits(uint32_t bits[DRUM_PART_COUNT],
+                          uint8_t x, uint8_t y) const;
+
   // Get sample mappings (for diagnostic output)
   const std::vector<SampleMapping>& GetSampleMappings() const {
     return sample_mappings_;
   }
 
+  // Add the pending trigger queue and the rest of the generator (clock,
+  // mappings and their velocity patterns) to footprint
+  void AddFootprint(MemoryFootprint* footprint) const;
+
  private:
   SamplePlayer* sample_player_;
   uint32_t sample_rate_;
@@ -137,10 +208,6 @@ class PatternGeneratorWrapper {
   uint8_t pending_pattern_y_;
   volatile bool pattern_changed_;
 
-  // Compute pattern bitmasks for current x/y settings
-  void ComputePatternBits(uint32_t bits[DRUM_PART_COUNT],
-                          uint8_t x, uint8_t y) const;
-
   // Detect pattern change (realtime-safe, called from audio thread)
   void DetectPatternChange();
 
@@ -161,11 +228,28 @@ class PatternGeneratorWrapper {
   float humanize_amount_;
   uint32_t humanize_max_frames_;
   PendingTrigger pending_triggers_[kMaxPendingTriggers];
+  uint32_t num_pending_triggers_;
+  uint64_t pending_overflows_;
   uint32_t humanize_rng_state_;
 
+  // Statistics
+  uint64_t part_triggers_[DRUM_PART_COUNT];
+
+  // Event tracing
+  EventTrace* trace_;
+  TriggerListener* listener_;
+  uint64_t frame_count_;    // Frames before the current block
+  uint32_t block_offset_;   // Frame within the current block
+
   uint32_t HumanizeRand();
-  void QueueHumanizedTrigger(uint8_t midi_note, float velocity, float pan);
+  void QueueHumanizedTrigger(uint8_t midi_note, float velocity, float pan,
+                             uint8_t part, uint16_t mapping);
   void ProcessPendingTriggers();
+
+  // Send a hit to the listener and sample player, and trace it if enabled
+  // The player renders the hit on stem bus `mapping` (see ProcessStems)
+  void FireTrigger(uint8_t midi_note, float velocity, float pan, uint8_t part,
+                   uint16_t mapping, int32_t jitter, uint8_t flags);
 };
 
 }  // namespace grids_jack
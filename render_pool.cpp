@@ -0,0 +1,248 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "render_pool.h"
+
+#include <sched.h>
+#include <stdio.h>
+
+#include "denormals.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace grids_jack {
+
+namespace {
+
+// Iterations a worker busy-waits for the next cycle before sleeping
+const int kSpinIterations = 4000;
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+}  // namespace
+
+RenderWorkerPool::ThreadHook RenderWorkerPool::thread_hook_ = nullptr;
+
+void RenderWorkerPool::SetThreadHook(ThreadHook hook) {
+    thread_hook_ = hook;
+}
+
+RenderWorkerPool::RenderWorkerPool()
+    : job_(nullptr),
+      context_(nullptr),
+      generation_(0),
+      pending_(0),
+      sleepers_(0),
+      running_(false) {}
+
+RenderWorkerPool::~RenderWorkerPool() {
+    Stop();
+}
+
+bool RenderWorkerPool::Start(size_t num_threads, int rt_priority) {
+    Stop();
+
+    if (num_threads < 1 || num_threads > kMaxRenderThreads) {
+        fprintf(stderr, "Error: Render threads must be between 1 and %zu\n",
+                kMaxRenderThreads);
+        return false;
+    }
+
+    // Workers start waiting for generation 1, so no Run() can be missed
+    generation_.store(0);
+    pending_.store(0);
+    sleepers_.store(0);
+    running_.store(true);
+
+    size_t num_workers = num_threads - 1;
+    args_.resize(num_workers);
+    threads_.reserve(num_workers);
+
+    for (size_t i = 0; i < num_workers; i++) {
+        args_[i].pool = this;
+        args_[i].index = i + 1;
+
+        pthread_t thread;
+        int result = -1;
+
+        if (rt_priority > 0) {
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+            struct sched_param param;
+            param.sched_priority = rt_priority;
+            pthread_attr_setschedparam(&attr, &param);
+            result = pthread_create(&thread, &attr, WorkerEntry, &args_[i]);
+            pthread_attr_destroy(&attr);
+            if (result != 0 && i == 0) {
+                fprintf(stderr, "Warning: Could not create realtime render thread "
+                        "(error %d), using normal scheduling\n", result);
+            }
+        }
+
+        if (result != 0) {
+            result = pthread_create(&thread, nullptr, WorkerEntry, &args_[i]);
+        }
+
+        if (result != 0) {
+            fprintf(stderr, "Error: Failed to create render thread (error %d)\n", result);
+            Stop();
+            return false;
+        }
+
+        threads_.push_back(thread);
+    }
+
+    return true;
+}
+
+void RenderWorkerPool::Stop() {
+    if (threads_.empty()) {
+        args_.clear();
+        return;
+    }
+
+    running_.store(false);
+    generation_.fetch_add(1);
+    WakeWorkers();
+
+    for (size_t i = 0; i < threads_.size(); i++) {
+        pthread_join(threads_[i], nullptr);
+    }
+
+    threads_.clear();
+    args_.clear();
+}
+
+void RenderWorkerPool::AddFootprint(MemoryFootprint* footprint) const {
+    footprint->render_buffers += sizeof(*this) +
+        threads_.capacity() * sizeof(pthread_t) + args_.capacity() * sizeof(WorkerArg);
+}
+
+void RenderWorkerPool::Run(Job job, void* context) {
+    // REALTIME-SAFE: No allocations, no locks; a futex wake only when
+    // a worker has gone to sleep between cycles
+
+    if (threads_.empty()) {
+        job(context, 0);
+        return;
+    }
+
+    job_ = job;
+    context_ = context;
+    pending_.store(static_cast<uint32_t>(threads_.size()), std::memory_order_relaxed);
+
+    // Publish the job; pairs with the sleepers_/generation_ check in
+    // WaitForGeneration so a worker can never sleep through a cycle
+    generation_.fetch_add(1);
+    if (sleepers_.load() > 0) {
+        WakeWorkers();
+    }
+
+    // The calling thread renders slot 0 while workers render the rest
+    job(context, 0);
+
+    // Workers finish within microseconds unless the machine is
+    // oversubscribed, in which case yield so they can get a core
+    int spins = 0;
+    while (pending_.load(std::memory_order_acquire) != 0) {
+        if (++spins < kSpinIterations) {
+            CpuRelax();
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+void* RenderWorkerPool::WorkerEntry(void* arg) {
+    WorkerArg* worker = static_cast<WorkerArg*>(arg);
+    worker->pool->WorkerLoop(worker->index);
+    return nullptr;
+}
+
+void RenderWorkerPool::WorkerLoop(size_t index) {
+    uint32_t seen = 0;
+
+    // Workers mix audio too, so they need the same FTZ/DAZ mode
+    DisableDenormals();
+
+    // Read once: pthread_create orders the hook before this thread
+    ThreadHook hook = thread_hook_;
+    if (hook != nullptr) {
+        hook(true);
+    }
+
+    while (true) {
+        WaitForGeneration(seen);
+        seen = generation_.load(std::memory_order_acquire);
+
+        if (!running_.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        job_(context_, index);
+        pending_.fetch_sub(1, std::memory_order_release);
+    }
+
+    if (hook != nullptr) {
+        hook(false);
+    }
+}
+
+void RenderWorkerPool::WaitForGeneration(uint32_t seen) {
+    for (int i = 0; i < kSpinIterations; i++) {
+        if (generation_.load(std::memory_order_acquire) != seen) {
+            return;
+        }
+        CpuRelax();
+    }
+
+    sleepers_.fetch_add(1);
+    while (generation_.load() == seen) {
+#ifdef __linux__
+        // std::atomic<uint32_t> is layout-compatible with uint32_t
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&generation_),
+                FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr, 0);
+#else
+        sched_yield();
+#endif
+    }
+    sleepers_.fetch_sub(1);
+}
+
+void RenderWorkerPool::WakeWorkers() {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&generation_),
+            FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+}  // namespace grids_jack
@@ -0,0 +1,112 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef RENDER_POOL_H_
+#define RENDER_POOL_H_
+
+#include <pthread.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "memory_footprint.h"
+
+namespace grids_jack {
+
+// Upper bound on render threads (including the calling audio thread)
+constexpr size_t kMaxRenderThreads = 16;
+
+// A pool of pre-spawned worker threads that execute one job per audio cycle.
+// The calling thread always runs slot 0 itself; workers run slots 1..N-1.
+// Workers spin briefly after each cycle and then sleep on a futex, so Run()
+// never allocates or takes a lock.
+class RenderWorkerPool {
+public:
+    // Job executed once per thread slot; worker_index is in [0, GetThreadCount())
+    typedef void (*Job)(void* context, size_t worker_index);
+
+    // Called on every worker thread with true when it starts, before its
+    // first job, and with false just before it exits
+    typedef void (*ThreadHook)(bool starting);
+
+    RenderWorkerPool();
+    ~RenderWorkerPool();
+
+    // Spawn num_threads - 1 workers (the caller is the remaining thread)
+    // rt_priority > 0 requests SCHED_FIFO; falls back to normal scheduling
+    // if the process lacks permission. NOT realtime-safe.
+    bool Start(size_t num_threads, int rt_priority);
+
+    // Stop and join all workers. NOT realtime-safe.
+    void Stop();
+
+    // Install a hook for workers started afterwards, in every pool (e.g. to
+    // mark them realtime in checked builds); nullptr removes it.
+    // NOT realtime-safe; call before Start().
+    static void SetThreadHook(ThreadHook hook);
+
+    // Total number of thread slots (1 when no workers are running)
+    size_t GetThreadCount() const { return threads_.size() + 1; }
+
+    // Add the pool and its worker bookkeeping to footprint->render_buffers
+    // (thread stacks are not counted)
+    void AddFootprint(MemoryFootprint* footprint) const;
+
+    // Run job on every slot and wait for all of them to finish
+    // This is realtime-safe and should be called from the audio callback
+    void Run(Job job, void* context);
+
+private:
+    struct WorkerArg {
+        RenderWorkerPool* pool;
+        size_t index;
+    };
+
+    static void* WorkerEntry(void* arg);
+    void WorkerLoop(size_t index);
+
+    // Block until generation_ differs from seen (spin, then futex wait)
+    void WaitForGeneration(uint32_t seen);
+
+    // Wake any workers sleeping on generation_
+    void WakeWorkers();
+
+    static ThreadHook thread_hook_;
+
+    std::vector<pthread_t> threads_;
+    std::vector<WorkerArg> args_;
+
+    // Current job (written before generation_ is published)
+    Job job_;
+    void* context_;
+
+    // Incremented once per Run(); workers wait for it to change
+    std::atomic<uint32_t> generation_;
+
+    // Number of workers that have not yet finished the current job
+    std::atomic<uint32_t> pending_;
+
+    // Number of workers currently sleeping in the futex
+    std::atomic<uint32_t> sleepers_;
+
+    // Cleared by Stop() to make workers exit
+    std::atomic<bool> running_;
+};
+
+}  // namespace grids_jack
+
+#endif  // RENDER_POOL_H_
@@ -0,0 +1,226 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Interposers for realtime-safety checks. Only link this into test
+// executables: every allocation in the process goes through these.
+
+#include "rt_check.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if !defined(__GLIBC__)
+#error "rt_check.cpp relies on glibc's __libc_malloc family; disable GRIDS_RT_CHECK"
+#endif
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace grids_jack {
+
+namespace {
+
+// Initial-exec TLS: reading it never allocates, even inside malloc
+__thread bool t_realtime __attribute__((tls_model("initial-exec"))) = false;
+
+typedef int (*MutexLockFn)(pthread_mutex_t*);
+typedef ssize_t (*ReadFn)(int, void*, size_t);
+typedef ssize_t (*WriteFn)(int, const void*, size_t);
+typedef int (*OpenFn)(const char*, int, ...);
+typedef int (*OpenAtFn)(int, const char*, int, ...);
+typedef int (*CloseFn)(int);
+typedef int (*NanosleepFn)(const struct timespec*, struct timespec*);
+typedef int (*UsleepFn)(useconds_t);
+
+MutexLockFn real_mutex_lock = nullptr;
+ReadFn real_read = nullptr;
+WriteFn real_write = nullptr;
+OpenFn real_open = nullptr;
+OpenAtFn real_openat = nullptr;
+CloseFn real_close = nullptr;
+NanosleepFn real_nanosleep = nullptr;
+UsleepFn real_usleep = nullptr;
+
+template <typename Fn>
+Fn Resolve(Fn* slot, const char* name) {
+    if (*slot == nullptr) {
+        *slot = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+    }
+    return *slot;
+}
+
+// Resolve everything up front so dlsym never runs on a checked thread;
+// the wrappers still resolve lazily for calls made before this runs
+__attribute__((constructor)) void ResolveAll() {
+    Resolve(&real_mutex_lock, "pthread_mutex_lock");
+    Resolve(&real_read, "read");
+    Resolve(&real_write, "write");
+    Resolve(&real_open, "open");
+    Resolve(&real_openat, "openat");
+    Resolve(&real_close, "close");
+    Resolve(&real_nanosleep, "nanosleep");
+    Resolve(&real_usleep, "usleep");
+}
+
+void WriteStderr(const char* text) {
+    WriteFn write_fn = Resolve(&real_write, "write");
+    if (write_fn != nullptr) {
+        ssize_t ignored = write_fn(STDERR_FILENO, text, strlen(text));
+        (void)ignored;
+    }
+}
+
+// Report the offending call and abort
+__attribute__((noinline)) void Violation(const char* function) {
+    // Let the report itself allocate and write
+    t_realtime = false;
+
+    WriteStderr("\nREALTIME VIOLATION: ");
+    WriteStderr(function);
+    WriteStderr(" called on a realtime thread\n");
+
+    void* frames[64];
+    int depth = backtrace(frames, 64);
+    backtrace_symbols_fd(frames, depth, STDERR_FILENO);
+
+    abort();
+}
+
+inline void Check(const char* function) {
+    if (__builtin_expect(t_realtime, false)) {
+        Violation(function);
+    }
+}
+
+}  // namespace
+
+void SetRealtimeThread(bool realtime) {
+    t_realtime = realtime;
+}
+
+bool IsRealtimeThread() {
+    return t_realtime;
+}
+
+bool RealtimeChecksAvailable() {
+    return true;
+}
+
+}  // namespace grids_jack
+
+using grids_jack::Check;
+using grids_jack::Resolve;
+
+// Allocation. operator new/delete in libstdc++ call these, so they are
+// covered without replacing every overload.
+extern "C" void* malloc(size_t size) {
+    Check("malloc");
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    Check("calloc");
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    Check("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr) {
+    if (ptr != nullptr) {
+        Check("free");
+    }
+    __libc_free(ptr);
+}
+
+extern "C" int posix_memalign(void** result, size_t alignment, size_t size) {
+    Check("posix_memalign");
+    void* ptr = __libc_memalign(alignment, size);
+    if (ptr == nullptr) {
+        return ENOMEM;
+    }
+    *result = ptr;
+    return 0;
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) {
+    Check("aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+// Locks
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    Check("pthread_mutex_lock");
+    return Resolve(&grids_jack::real_mutex_lock, "pthread_mutex_lock")(mutex);
+}
+
+// Blocking system calls
+extern "C" ssize_t read(int fd, void* buffer, size_t count) {
+    Check("read");
+    return Resolve(&grids_jack::real_read, "read")(fd, buffer, count);
+}
+
+extern "C" ssize_t write(int fd, const void* buffer, size_t count) {
+    Check("write");
+    return Resolve(&grids_jack::real_write, "write")(fd, buffer, count);
+}
+
+extern "C" int open(const char* path, int flags, ...) {
+    Check("open");
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+    return Resolve(&grids_jack::real_open, "open")(path, flags, mode);
+}
+
+extern "C" int openat(int dirfd, const char* path, int flags, ...) {
+    Check("openat");
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+    return Resolve(&grids_jack::real_openat, "openat")(dirfd, path, flags, mode);
+}
+
+extern "C" int close(int fd) {
+    Check("close");
+    return Resolve(&grids_jack::real_close, "close")(fd);
+}
+
+extern "C" int nanosleep(const struct timespec* request, struct timespec* remaining) {
+    Check("nanosleep");
+    return Resolve(&grids_jack::real_nanosleep, "nanosleep")(request, remaining);
+}
+
+extern "C" int usleep(useconds_t usec) {
+    Check("usleep");
+    return Resolve(&grids_jack::real_usleep, "usleep")(usec);
+}
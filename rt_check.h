@@ -0,0 +1,58 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef RT_CHECK_H_
+#define RT_CHECK_H_
+
+namespace grids_jack {
+
+// Realtime-safety enforcement (test builds only, see GRIDS_RT_CHECK)
+//
+// Linking rt_check.cpp into an executable interposes malloc/calloc/
+// realloc/free (and therefore operator new/delete), pthread_mutex_lock
+// and the blocking system calls read, write, open, openat, close,
+// nanosleep and usleep. While the calling thread is marked realtime,
+// any of these aborts the process with a stack trace naming the call.
+//
+// Not covered: sched_yield and futex(2), which the render pool uses by
+// design when it has to wait for or wake its workers.
+
+// Mark or unmark the calling thread as a realtime (audio) thread
+void SetRealtimeThread(bool realtime);
+
+// True if the calling thread is marked realtime
+bool IsRealtimeThread();
+
+// True if the interposers are linked into this executable
+bool RealtimeChecksAvailable();
+
+// Marks the calling thread realtime for the lifetime of the object
+class ScopedRealtimeThread {
+public:
+    ScopedRealtimeThread() : previous_(IsRealtimeThread()) {
+        SetRealtimeThread(true);
+    }
+    ~ScopedRealtimeThread() { SetRealtimeThread(previous_); }
+
+private:
+    bool previous_;
+
+    ScopedRealtimeThread(const ScopedRealtimeThread&);
+    ScopedRealtimeThread& operator=(const ScopedRealtimeThread&);
+};
+
+}  // namespace grids_jack
+
+#endif  // RT_CHECK_H_
@@ -21,9 +21,23 @@
 #include <string.h>
 #include <algorithm>
 #include <cmath>
+#include <set>
+
+#include "denormals.h"
 
 namespace grids_jack {
 
+// Frames decoded per sf_readf_float call
+static const sf_count_t kDecodeChunkFrames = 65536;
+
+// Most frames reserved up front from the header's frame count; longer
+// files grow the buffer as they decode
+static const sf_count_t kMaxReserveFrames = 1 << 22;
+
+// Lowest source sample rate accepted; resampling from a header that
+// claims a few Hz would multiply the length by the rate ratio
+static const int kMinSourceSampleRate = 1000;
+
 SampleBank::SampleBank() {}
 
 SampleBank::~SampleBank() {}
@@ -97,6 +111,84 @@ bool SampleBank::LoadDirectory(const std::string& path, uint32_t target_sample_r
     return loaded_count > 0;
 }
 
+bool SampleBank::ScanDirectory(const std::string& path,
+                               std::vector<uint8_t>* notes) const {
+    notes->clear();
+
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        fprintf(stderr, "Error: Could not open directory: %s\n", path.c_str());
+        return false;
+    }
+
+    // Same filtering as LoadDirectory; a set keeps notes sorted and unique
+    std::set<uint8_t> found;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_type == DT_DIR || entry->d_name[0] == '.') {
+            continue;
+        }
+        const char* name = entry->d_name;
+        size_t len = strlen(name);
+        if (len < 4 || strcasecmp(name + len - 4, ".wav") != 0) {
+            continue;
+        }
+        uint8_t midi_note;
+        if (ParseMidiNote(name, &midi_note)) {
+            found.insert(midi_note);
+        }
+    }
+    closedir(dir);
+
+    notes->assign(found.begin(), found.end());
+    return !notes->empty();
+}
+
+bool SampleBank::LoadFile(const std::string& filepath, uint8_t midi_note,
+                          uint32_t target_sample_rate) {
+    Sample sample;
+    size_t slash = filepath.rfind('/');
+    sample.filename = slash == std::string::npos ? filepath : filepath.substr(slash + 1);
+    sample.midi_note = midi_note;
+    if (!LoadWavFile(filepath, target_sample_rate, &sample)) {
+        return false;
+    }
+    samples_[midi_note] = sample;
+    return true;
+}
+
+void SampleBank::AddSample(uint8_t midi_note, const std::vector<float>& data,
+                           const std::string& name) {
+    Sample& sample = samples_[midi_note];
+    sample.data = data;
+    sample.length = data.size();
+    FlushDenormals(sample.data.data(), sample.data.size());
+    sample.midi_note = midi_note;
+    sample.filename = name;
+}
+
+void SampleBank::AddFootprint(const Sample& sample, MemoryFootprint* footprint) {
+    footprint->sample_data += sample.data.size() * sizeof(float);
+    footprint->sample_padding += (sample.data.capacity() - sample.data.size()) * sizeof(float);
+
+    // A map node is the red-black tree links and colour plus the stored pair
+    footprint->sample_overhead += 4 * sizeof(void*) + sizeof(std::pair<const uint8_t, Sample>);
+
+    // Short names live inside the string object
+    const char* name = sample.filename.data();
+    const char* object = reinterpret_cast<const char*>(&sample.filename);
+    if (name < object || name >= object + sizeof(sample.filename)) {
+        footprint->sample_overhead += sample.filename.capacity() + 1;
+    }
+}
+
+void SampleBank::AddFootprint(MemoryFootprint* footprint) const {
+    footprint->sample_overhead += sizeof(*this);
+    for (const auto& entry : samples_) {
+        AddFootprint(entry.second, footprint);
+    }
+}
+
 const Sample* SampleBank::GetSample(uint8_t midi_note) const {
     auto it = samples_.find(midi_note);
     if (it == samples_.end()) {
@@ -116,7 +208,7 @@ std::vector<uint8_t> SampleBank::GetAllNotes() const {
     return notes;
 }
 
-bool SampleBank::ParseMidiNote(const std::string& filename, uint8_t* out_note) const {
+bool SampleBank::ParseMidiNote(const std::string& filename, uint8_t* out_note) {
     // Expected format: "60.1.1.1.0.wav" where first field is MIDI note
     size_t dot_pos = filename.find('.');
     if (dot_pos == std::string::npos || dot_pos == 0) {
@@ -151,34 +243,72 @@ bool SampleBank::LoadWavFile(const std::string& filepath, uint32_t target_sample
         return false;
     }
     
+    // Reject what cannot be converted before decoding anything
+    if (sf_info.channels != 1 && sf_info.channels != 2) {
+        fprintf(stderr, "Error: Unsupported channel count: %d\n", sf_info.channels);
+        sf_close(sf);
+        return false;
+    }
+    if (sf_info.samplerate < kMinSourceSampleRate) {
+        fprintf(stderr, "Error: Unsupported sample rate: %d\n", sf_info.samplerate);
+        sf_close(sf);
+        return false;
+    }
+
     // Check if we need to handle stereo or sample rate conversion
     bool is_stereo = (sf_info.channels == 2);
     bool needs_resample = (static_cast<uint32_t>(sf_info.samplerate) != target_sample_rate);
     
-    // Read all samples as float
+    // Read all samples as float, in chunks: a corrupt header can claim
+    // more frames than the file holds, so memory grows with what actually
+    // decodes (the reservation is capped)
     std::vector<float> raw_data;
-    sf_count_t total_frames = sf_info.frames;
-    raw_data.resize(total_frames * sf_info.channels);
-    
-    sf_count_t read_count = sf_readf_float(sf, raw_data.data(), total_frames);
-    if (read_count != total_frames) {
+    size_t channels = static_cast<size_t>(sf_info.channels);
+    if (sf_info.frames > 0) {
+        raw_data.reserve(std::min(sf_info.frames, kMaxReserveFrames) * channels);
+    }
+    for (sf_count_t remaining = sf_info.frames; remaining > 0;) {
+        sf_count_t chunk = std::min(remaining, kDecodeChunkFrames);
+        size_t offset = raw_data.size();
+        raw_data.resize(offset + chunk * channels);
+        sf_count_t read_count = sf_readf_float(sf, raw_data.data() + offset, chunk);
+        if (read_count < 0) read_count = 0;
+        raw_data.resize(offset + read_count * channels);
+        if (read_count < chunk) break;
+        remaining -= chunk;
+    }
+    sf_count_t total_frames = static_cast<sf_count_t>(raw_data.size() / channels);
+    if (total_frames != sf_info.frames) {
         fprintf(stderr, "Warning: Expected %lld frames, read %lld frames from: %s\n",
-               (long long)total_frames, (long long)read_count, filepath.c_str());
-        raw_data.resize(read_count * sf_info.channels);
-        total_frames = read_count;
+               (long long)sf_info.frames, (long long)total_frames, filepath.c_str());
     }
     
     sf_close(sf);
+
+    if (total_frames == 0) {
+        fprintf(stderr, "Error: No audio frames in: %s\n", filepath.c_str());
+        return false;
+    }
+
+    // Float files can hold NaN or infinity, which would poison the mix
+    size_t non_finite = 0;
+    for (size_t i = 0; i < raw_data.size(); i++) {
+        if (!std::isfinite(raw_data[i])) {
+            raw_data[i] = 0.0f;
+            non_finite++;
+        }
+    }
+    if (non_finite > 0) {
+        fprintf(stderr, "Warning: Replaced %zu non-finite samples with silence in: %s\n",
+               non_finite, filepath.c_str());
+    }
     
     // Convert stereo to mono if needed
     std::vector<float> mono_data;
     if (is_stereo) {
         ConvertStereoToMono(raw_data, &mono_data);
-    } else if (sf_info.channels == 1) {
-        mono_data = raw_data;
     } else {
-        fprintf(stderr, "Error: Unsupported channel count: %d\n", sf_info.channels);
-        return false;
+        mono_data = raw_data;
     }
     
     // Resample if needed
@@ -191,6 +321,9 @@ bool SampleBank::LoadWavFile(const std::string& filepath, uint32_t target_sample
         out_sample->data = mono_data;
         out_sample->length = mono_data.size();
     }
+
+    // Silence inaudible tails so mixing never produces denormals
+    FlushDenormals(out_sample->data.data(), out_sample->data.size());
     
     return true;
 }
@@ -21,6 +21,8 @@
 #include <string>
 #include <vector>
 
+#include "memory_footprint.h"
+
 namespace grids_jack {
 
 // Represents a single audio sample loaded into memory
@@ -43,6 +45,21 @@ public:
     // Returns true on success, false if no samples could be loaded
     bool LoadDirectory(const std::string& path, uint32_t target_sample_rate);
     
+    // List the MIDI notes LoadDirectory would map, without decoding audio
+    // (sorted like GetAllNotes). Returns false if the directory cannot be
+    // read or holds no sample files
+    bool ScanDirectory(const std::string& path, std::vector<uint8_t>* notes) const;
+
+    // Load one WAV file and map it to midi_note, replacing any sample
+    // already there. Returns false if the file cannot be decoded
+    bool LoadFile(const std::string& filepath, uint8_t midi_note,
+                  uint32_t target_sample_rate);
+
+    // Add a sample directly (generated material, benchmarks, tests)
+    // Replaces any sample already mapped to the same MIDI note
+    void AddSample(uint8_t midi_note, const std::vector<float>& data,
+                   const std::string& name);
+
     // Get a sample by MIDI note number
     // Returns nullptr if note not found
     const Sample* GetSample(uint8_t midi_note) const;
@@ -52,12 +69,19 @@ public:
     
     // Get total number of loaded samples
     size_t GetSampleCount() const { return samples_.size(); }
-    
-private:
+
+    // Add the memory held by one stored sample (frames, unused buffer
+    // capacity, map node and file name) to footprint
+    static void AddFootprint(const Sample& sample, MemoryFootprint* footprint);
+
+    // Add the memory held by the bank and all its samples to footprint
+    void AddFootprint(MemoryFootprint* footprint) const;
+
     // Parse MIDI note number from filename (e.g., "60.1.1.1.0.wav" -> 60)
     // Returns true on success, false if parsing failed
-    bool ParseMidiNote(const std::string& filename, uint8_t* out_note) const;
+    static bool ParseMidiNote(const std::string& filename, uint8_t* out_note);
     
+private:
     // Load a single WAV file
     // Returns true on success, false on error
     bool LoadWavFile(const std::string& filepath, uint32_t target_sample_rate, Sample* out_sample);
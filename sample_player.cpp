@@ -15,6 +15,8 @@
 
 #include "sample_player.h"
 
+#include <stdio.h>
+
 #include <cmath>
 #include <cstring>  // for memset
 
@@ -24,12 +26,136 @@
 
 namespace grids_jack {
 
+namespace {
+
+// Mix one voice into the output, specialized at compile time on kFlags so
+// the common cases (center pan, unity gain, voice outlasting the block)
+// carry no extra multiplies or per-voice branches
+template <uint8_t kFlags>
+void MixVoice(Voice& voice, float* left, float* right,
+              float* bus_left, float* bus_right, uint32_t num_frames) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    const bool kStereo = (kFlags & kMixStereo) != 0;
+    const bool kUnity = (kFlags & kMixUnityGain) != 0;
+    const bool kCenter = (kFlags & kMixCenterPan) != 0;
+    const bool kFull = (kFlags & kMixFullBlock) != 0;
+    const bool kBus = (kFlags & kMixBus) != 0;
+
+    uint32_t frames = num_frames;
+    if (!kFull) {
+        uint32_t frames_remaining = voice.sample_length - voice.position;
+        if (frames > frames_remaining) {
+            frames = frames_remaining;
+        }
+    }
+
+    const float* src = voice.sample_data + voice.position;
+
+    if (kStereo) {
+        if (kUnity) {
+            for (uint32_t i = 0; i < frames; i++) {
+                left[i] += src[i];
+                right[i] += src[i];
+                if (kBus) {
+                    bus_left[i] += src[i];
+                    bus_right[i] += src[i];
+                }
+            }
+        } else if (kCenter) {
+            const float g = voice.gain_left;
+            for (uint32_t i = 0; i < frames; i++) {
+                float s = src[i] * g;
+                left[i] += s;
+                right[i] += s;
+                if (kBus) {
+                    bus_left[i] += s;
+                    bus_right[i] += s;
+                }
+            }
+        } else {
+            const float gl = voice.gain_left;
+            const float gr = voice.gain_right;
+            for (uint32_t i = 0; i < frames; i++) {
+                float s = src[i];
+                left[i] += s * gl;
+                right[i] += s * gr;
+                if (kBus) {
+                    bus_left[i] += s * gl;
+                    bus_right[i] += s * gr;
+                }
+            }
+        }
+    } else {
+        if (kUnity) {
+            for (uint32_t i = 0; i < frames; i++) {
+                left[i] += src[i];
+                if (kBus) {
+                    bus_left[i] += src[i];
+                }
+            }
+        } else {
+            const float g = voice.gain;
+            for (uint32_t i = 0; i < frames; i++) {
+                left[i] += src[i] * g;
+                if (kBus) {
+                    bus_left[i] += src[i] * g;
+                }
+            }
+        }
+    }
+
+    voice.position += frames;
+
+    // A full-block voice has samples left by construction
+    if (!kFull && voice.IsFinished()) {
+        voice.Reset();
+    }
+}
+
+typedef void (*MixKernel)(Voice&, float*, float*, float*, float*, uint32_t);
+
+// Indexed by MixFlags; unity gain is only ever set together with center pan
+// for stereo output, center pan is never set for mono output, and stem
+// buses are only rendered in stereo
+const MixKernel kMixKernels[kMixKernelCount] = {
+    &MixVoice<0>,  &MixVoice<1>,  &MixVoice<2>,  &MixVoice<3>,
+    &MixVoice<4>,  &MixVoice<5>,  &MixVoice<6>,  &MixVoice<7>,
+    &MixVoice<8>,  &MixVoice<9>,  &MixVoice<10>, &MixVoice<11>,
+    &MixVoice<12>, &MixVoice<13>, &MixVoice<14>, &MixVoice<15>,
+    &MixVoice<16>, &MixVoice<17>, &MixVoice<18>, &MixVoice<19>,
+    &MixVoice<20>, &MixVoice<21>, &MixVoice<22>, &MixVoice<23>,
+    &MixVoice<24>, &MixVoice<25>, &MixVoice<26>, &MixVoice<27>,
+    &MixVoice<28>, &MixVoice<29>, &MixVoice<30>, &MixVoice<31>,
+};
+
+// Pick the kernel for a voice rendering num_frames frames
+inline MixKernel SelectKernel(const Voice& voice, uint8_t flags, uint32_t num_frames) {
+    if (voice.sample_length - voice.position > num_frames) {
+        flags |= kMixFullBlock;
+    }
+    return kMixKernels[flags];
+}
+
+}  // namespace
+
 SamplePlayer::SamplePlayer()
     : next_voice_index_(0),
       sample_bank_(nullptr),
       sample_rate_(0),
       active_voice_count_(0),
-      total_triggers_(0) {
+      total_triggers_(0),
+      coalesced_triggers_(0),
+      voice_steals_(0),
+      peak_voice_count_(0),
+      coalescing_enabled_(true),
+      stem_buses_enabled_(false),
+      num_fresh_voices_(0),
+      tile_frames_(kDefaultTileFrames),
+      num_live_voices_(0),
+      max_render_frames_(0),
+      job_left_(nullptr),
+      job_right_(nullptr),
+      job_frames_(0) {
     // Initialize all voices as inactive
     for (auto& voice : voice_pool_) {
         voice.Reset();
@@ -46,6 +172,10 @@ void SamplePlayer::Init(const SampleBank* bank, uint32_t sample_rate) {
     next_voice_index_ = 0;
     active_voice_count_ = 0;
     total_triggers_ = 0;
+    coalesced_triggers_ = 0;
+    voice_steals_ = 0;
+    peak_voice_count_ = 0;
+    num_fresh_voices_ = 0;
     
     // Reset all voices
     for (auto& voice : voice_pool_) {
@@ -53,9 +183,16 @@ void SamplePlayer::Init(const SampleBank* bank, uint32_t sample_rate) {
     }
 }
 
-void SamplePlayer::Trigger(uint8_t midi_note, float velocity, float pan) {
+void SamplePlayer::Trigger(uint8_t midi_note, float velocity, float pan,
+                           TriggerInfo* info, uint16_t bus) {
     // REALTIME-SAFE: No allocations, no locks, no system calls
 
+    if (info != nullptr) {
+        info->voice = -1;
+        info->stolen = false;
+        info->coalesced = false;
+    }
+
     if (sample_bank_ == nullptr) {
         return;  // Not initialized
     }
@@ -76,6 +213,30 @@ void SamplePlayer::Trigger(uint8_t midi_note, float velocity, float pan) {
     float left_gain = cosf(theta);
     float right_gain = sinf(theta);
 
+    // Without stems the bus only separates hits that mix identically
+    if (!stem_buses_enabled_) {
+        bus = kNoBus;
+    }
+
+    // Merge with a voice playing the same sample from the same frame;
+    // both would render identical data
+    if (coalescing_enabled_) {
+        for (size_t i = 0; i < num_fresh_voices_; i++) {
+            Voice& fresh = voice_pool_[fresh_voices_[i]];
+            if (fresh.active && fresh.position == 0 &&
+                fresh.sample_data == sample->data.data() && fresh.bus == bus) {
+                fresh.Merge(velocity, left_gain, right_gain);
+                coalesced_triggers_++;
+                total_triggers_++;
+                if (info != nullptr) {
+                    info->voice = static_cast<int16_t>(fresh_voices_[i]);
+                    info->coalesced = true;
+                }
+                return;
+            }
+        }
+    }
+
     // Find a voice slot (circular allocation with voice stealing)
     Voice& voice = voice_pool_[next_voice_index_];
 
@@ -83,13 +244,24 @@ void SamplePlayer::Trigger(uint8_t midi_note, float velocity, float pan) {
     bool was_active = voice.active;
 
     // Initialize the voice with the sample
-    voice.Init(sample->data.data(), sample->length, velocity, left_gain, right_gain);
+    voice.Init(sample->data.data(), sample->length, velocity, left_gain, right_gain, bus);
     
     // Update statistics (only increment if this wasn't already active)
     if (!was_active) {
         active_voice_count_++;
+    } else {
+        voice_steals_++;
     }
     total_triggers_++;
+
+    if (num_fresh_voices_ < kMaxVoices) {
+        fresh_voices_[num_fresh_voices_++] = static_cast<uint16_t>(next_voice_index_);
+    }
+
+    if (info != nullptr) {
+        info->voice = static_cast<int16_t>(next_voice_index_);
+        info->stolen = was_active;
+    }
     
     // Advance to next voice slot (circular)
     next_voice_index_ = (next_voice_index_ + 1) % kMaxVoices;
@@ -104,9 +276,13 @@ void SamplePlayer::Process(float* output, uint32_t num_frames) {
     
     // Clear output buffer
     memset(output, 0, num_frames * sizeof(float));
+
+    // Voices triggered from here on start on a later frame
+    num_fresh_voices_ = 0;
     
     // Reset active voice count
     active_voice_count_ = 0;
+    uint32_t rendered = 0;
     
     // Mix all active voices
     for (auto& voice : voice_pool_) {
@@ -120,31 +296,20 @@ void SamplePlayer::Process(float* output, uint32_t num_frames) {
             continue;
         }
         
-        // Count active voice
-        active_voice_count_++;
-        
         // Mix this voice into the output buffer
-        uint32_t frames_to_render = num_frames;
-        uint32_t frames_remaining = voice.sample_length - voice.position;
-        
-        // Don't read past the end of the sample
-        if (frames_to_render > frames_remaining) {
-            frames_to_render = frames_remaining;
-        }
-        
-        // Add samples to output buffer
-        for (uint32_t i = 0; i < frames_to_render; i++) {
-            output[i] += voice.sample_data[voice.position + i] * voice.gain;
-        }
-        
-        // Advance playback position
-        voice.position += frames_to_render;
-        
-        // If voice finished during this buffer, mark as inactive
-        if (voice.IsFinished()) {
-            voice.Reset();
+        SelectKernel(voice, voice.mono_flags, num_frames)(voice, output, nullptr,
+                                                          nullptr, nullptr, num_frames);
+        rendered++;
+
+        // Count voices still playing after this buffer
+        if (voice.active) {
+            active_voice_count_++;
         }
     }
+
+    if (rendered > peak_voice_count_) {
+        peak_voice_count_ = rendered;
+    }
 }
 
 void SamplePlayer::ProcessStereo(float* left, float* right, uint32_t num_frames) {
@@ -154,15 +319,67 @@ void SamplePlayer::ProcessStereo(float* left, float* right, uint32_t num_frames)
         return;
     }
 
+    BeginStereoCycle(left, right, num_frames);
+
+    size_t num_threads = render_pool_.GetThreadCount();
+    bool parallel = num_threads > 1 &&
+                    num_frames <= max_render_frames_ &&
+                    num_live_voices_ >= num_threads * kMinVoicesPerRenderThread;
+
+    if (parallel) {
+        job_left_ = left;
+        job_right_ = right;
+        job_frames_ = num_frames;
+        render_pool_.Run(RenderJob, this);
+
+        // Reduce the worker buses into the output
+        for (size_t t = 1; t < num_threads; t++) {
+            const float* bus_left = &scratch_buses_[(t - 1) * 2 * max_render_frames_];
+            const float* bus_right = bus_left + max_render_frames_;
+            for (uint32_t i = 0; i < num_frames; i++) {
+                left[i] += bus_left[i];
+                right[i] += bus_right[i];
+            }
+        }
+    } else {
+        RenderStereo(live_voices_, num_live_voices_, left, right, num_frames);
+    }
+
+    EndStereoCycle();
+}
+
+void SamplePlayer::ProcessStems(float* left, float* right, float* const* bus_outputs,
+                                size_t num_buses, uint32_t num_frames) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+
+    if (left == nullptr || right == nullptr || num_frames == 0) {
+        return;
+    }
+
+    for (size_t b = 0; b < 2 * num_buses; b++) {
+        memset(bus_outputs[b], 0, num_frames * sizeof(float));
+    }
+
+    BeginStereoCycle(left, right, num_frames);
+    RenderStereo(live_voices_, num_live_voices_, left, right, num_frames,
+                 bus_outputs, num_buses);
+    EndStereoCycle();
+}
+
+void SamplePlayer::BeginStereoCycle(float* left, float* right, uint32_t num_frames) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+
     // Clear output buffers
     memset(left, 0, num_frames * sizeof(float));
     memset(right, 0, num_frames * sizeof(float));
 
-    // Reset active voice count
-    active_voice_count_ = 0;
+    // Voices triggered from here on start on a later frame
+    num_fresh_voices_ = 0;
 
-    // Mix all active voices with panning
-    for (auto& voice : voice_pool_) {
+    // Collect live voices, retiring any that already finished
+    num_live_voices_ = 0;
+    for (size_t i = 0; i < kMaxVoices; i++) {
+        Voice& voice = voice_pool_[i];
         if (!voice.active) {
             continue;
         }
@@ -172,28 +389,123 @@ void SamplePlayer::ProcessStereo(float* left, float* right, uint32_t num_frames)
             continue;
         }
 
-        active_voice_count_++;
+        live_voices_[num_live_voices_++] = static_cast<uint16_t>(i);
+    }
 
-        uint32_t frames_to_render = num_frames;
-        uint32_t frames_remaining = voice.sample_length - voice.position;
+    if (num_live_voices_ > peak_voice_count_) {
+        peak_voice_count_ = static_cast<uint32_t>(num_live_voices_);
+    }
+}
 
-        if (frames_to_render > frames_remaining) {
-            frames_to_render = frames_remaining;
+void SamplePlayer::EndStereoCycle() {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+
+    // Count voices still playing after this buffer
+    active_voice_count_ = 0;
+    for (size_t v = 0; v < num_live_voices_; v++) {
+        if (voice_pool_[live_voices_[v]].active) {
+            active_voice_count_++;
         }
+    }
+}
+
+void SamplePlayer::AddFootprint(MemoryFootprint* footprint) const {
+    // The render pool is a member, so it is counted once, as render buffers
+    footprint->voice_pool += sizeof(*this) - sizeof(render_pool_);
+    render_pool_.AddFootprint(footprint);
+    footprint->render_buffers += scratch_buses_.capacity() * sizeof(float);
+}
 
-        float gl = voice.gain * voice.pan_left;
-        float gr = voice.gain * voice.pan_right;
+bool SamplePlayer::SetRenderThreads(size_t num_threads, uint32_t max_frames,
+                                    int rt_priority) {
+    render_pool_.Stop();
+    scratch_buses_.clear();
+    max_render_frames_ = 0;
 
-        for (uint32_t i = 0; i < frames_to_render; i++) {
-            float s = voice.sample_data[voice.position + i];
-            left[i] += s * gl;
-            right[i] += s * gr;
+    if (num_threads <= 1) {
+        return true;
+    }
+
+    if (num_threads > kMaxRenderThreads) {
+        fprintf(stderr, "Error: Render threads must be at most %zu\n", kMaxRenderThreads);
+        return false;
+    }
+
+    scratch_buses_.assign((num_threads - 1) * 2 * max_frames, 0.0f);
+    max_render_frames_ = max_frames;
+
+    return render_pool_.Start(num_threads, rt_priority);
+}
+
+void SamplePlayer::RenderJob(void* context, size_t worker_index) {
+    // REALTIME-SAFE: Runs on the audio thread or a pool worker
+    SamplePlayer* player = static_cast<SamplePlayer*>(context);
+
+    size_t num_threads = player->render_pool_.GetThreadCount();
+    size_t count = player->num_live_voices_;
+    size_t begin = count * worker_index / num_threads;
+    size_t end = count * (worker_index + 1) / num_threads;
+    uint32_t num_frames = player->job_frames_;
+
+    float* left = player->job_left_;
+    float* right = player->job_right_;
+
+    // Workers other than the audio thread mix into their private bus
+    if (worker_index > 0) {
+        left = &player->scratch_buses_[(worker_index - 1) * 2 * player->max_render_frames_];
+        right = left + player->max_render_frames_;
+        memset(left, 0, num_frames * sizeof(float));
+        memset(right, 0, num_frames * sizeof(float));
+    }
+
+    player->RenderStereo(&player->live_voices_[begin], end - begin,
+                         left, right, num_frames);
+}
+
+void SamplePlayer::RenderStereo(const uint16_t* indices, size_t count,
+                                float* left, float* right, uint32_t num_frames,
+                                float* const* bus_outputs, size_t num_buses) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+
+    uint32_t tile = tile_frames_;
+    if (tile == 0 || tile > num_frames) {
+        tile = num_frames;
+    }
+
+    // Every voice covers a tile before any voice moves to the next one,
+    // so the tile's accumulators stay cached across all voices
+    for (uint32_t offset = 0; offset < num_frames; offset += tile) {
+        uint32_t frames = num_frames - offset;
+        if (frames > tile) {
+            frames = tile;
         }
+        RenderStereoTile(indices, count, left + offset, right + offset, frames,
+                         bus_outputs, num_buses, offset);
+    }
+}
+
+void SamplePlayer::RenderStereoTile(const uint16_t* indices, size_t count,
+                                    float* left, float* right, uint32_t num_frames,
+                                    float* const* bus_outputs, size_t num_buses,
+                                    uint32_t bus_offset) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
 
-        voice.position += frames_to_render;
+    for (size_t v = 0; v < count; v++) {
+        Voice& voice = voice_pool_[indices[v]];
 
-        if (voice.IsFinished()) {
-            voice.Reset();
+        // Finished in an earlier tile of this buffer
+        if (!voice.active) {
+            continue;
+        }
+
+        if (voice.bus < num_buses) {
+            float* bus_left = bus_outputs[2 * voice.bus] + bus_offset;
+            float* bus_right = bus_outputs[2 * voice.bus + 1] + bus_offset;
+            SelectKernel(voice, static_cast<uint8_t>(voice.stereo_flags | kMixBus), num_frames)(
+                voice, left, right, bus_left, bus_right, num_frames);
+        } else {
+            SelectKernel(voice, voice.stereo_flags, num_frames)(
+                voice, left, right, nullptr, nullptr, num_frames);
         }
     }
 }
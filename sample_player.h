@@ -17,8 +17,12 @@
 #define SAMPLE_PLAYER_H_
 
 #include <array>
+#include <cmath>
 #include <cstdint>
+#include <vector>
 
+#include "denormals.h"
+#include "render_pool.h"
 #include "sample_bank.h"
 
 namespace grids_jack {
@@ -26,6 +30,26 @@ namespace grids_jack {
 // Maximum number of simultaneously playing voices
 constexpr size_t kMaxVoices = 256;
 
+// Default frames per render tile; L/R accumulators for a tile stay in L1
+constexpr uint32_t kDefaultTileFrames = 128;
+
+// Minimum live voices per render thread before the pool is used;
+// below this the fork/join overhead outweighs the parallel mixing
+constexpr size_t kMinVoicesPerRenderThread = 8;
+
+// Stem bus of voices that are only rendered into the mix
+constexpr uint16_t kNoBus = 0xffff;
+
+// Mix kernel selection bits (see MixVoice in sample_player.cpp)
+enum MixFlags : uint8_t {
+    kMixStereo = 1 << 0,     // Stereo output (otherwise mono)
+    kMixUnityGain = 1 << 1,  // All output gains are 1.0 (no multiply)
+    kMixCenterPan = 1 << 2,  // Left and right gains are equal (one multiply)
+    kMixFullBlock = 1 << 3,  // Voice plays past the end of the block
+    kMixBus = 1 << 4,        // Also accumulate into the voice's stem bus
+    kMixKernelCount = 1 << 5
+};
+
 // Represents a single playing voice
 struct Voice {
     const float* sample_data;  // Pointer to sample data (non-owning)
@@ -34,11 +58,19 @@ struct Voice {
     float gain;                // Volume (default 1.0)
     float pan_left;            // Left channel gain from panning
     float pan_right;           // Right channel gain from panning
+    float gain_left;           // gain * pan_left, precomputed for mixing
+    float gain_right;          // gain * pan_right, precomputed for mixing
+    uint8_t mono_flags;        // Kernel bits for mono output
+    uint8_t stereo_flags;      // Kernel bits for stereo output
+    uint16_t bus;              // Stem bus (see ProcessStems)
     bool active;               // Whether this voice is currently playing
 
     Voice() : sample_data(nullptr), sample_length(0), position(0),
               gain(1.0f), pan_left(0.70710678f), pan_right(0.70710678f),
-              active(false) {}
+              gain_left(0.70710678f), gain_right(0.70710678f),
+              mono_flags(0), stereo_flags(0), bus(0), active(false) {
+        UpdateMixGains();
+    }
 
     // Reset voice to inactive state
     void Reset() {
@@ -48,19 +80,61 @@ struct Voice {
         gain = 1.0f;
         pan_left = 0.70710678f;
         pan_right = 0.70710678f;
+        bus = 0;
         active = false;
+        UpdateMixGains();
     }
 
-    // Initialize voice with sample data and pan gains
+    // Initialize voice with sample data, pan gains and stem bus
     void Init(const float* data, uint32_t length, float velocity,
-              float left = 0.70710678f, float right = 0.70710678f) {
+              float left = 0.70710678f, float right = 0.70710678f,
+              uint16_t bus_index = 0) {
         sample_data = data;
         sample_length = length;
         position = 0;
         gain = velocity;
         pan_left = left;
         pan_right = right;
+        bus = bus_index;
         active = true;
+        UpdateMixGains();
+    }
+
+    // Fold another hit of the same sample, starting on the same frame,
+    // into this voice by summing its gains
+    void Merge(float velocity, float left, float right) {
+        gain += velocity;
+        gain_left += velocity * left;
+        gain_right += velocity * right;
+        UpdateMixFlags();
+    }
+
+    // Recompute the mix gains and kernel bits from gain and pan
+    void UpdateMixGains() {
+        gain_left = gain * pan_left;
+        gain_right = gain * pan_right;
+        UpdateMixFlags();
+    }
+
+    // Recompute the kernel bits from the mix gains
+    void UpdateMixFlags() {
+        // A hard-panned voice leaves ~1e-8 on the far channel (cos(pi/2)),
+        // which would turn quiet tails into denormals
+        if (fabsf(gain_left) < kGainGuard) gain_left = 0.0f;
+        if (fabsf(gain_right) < kGainGuard) gain_right = 0.0f;
+
+        mono_flags = 0;
+        if (gain == 1.0f) {
+            mono_flags |= kMixUnityGain;
+        }
+
+        stereo_flags = kMixStereo;
+        if (gain_left == gain_right) {
+            stereo_flags |= kMixCenterPan;
+            if (gain_left == 1.0f) {
+                stereo_flags |= kMixUnityGain;
+            }
+        }
     }
     
     // Check if voice has finished playing
@@ -69,6 +143,13 @@ struct Voice {
     }
 };
 
+// Outcome of a Trigger() call (for tracing)
+struct TriggerInfo {
+    int16_t voice;     // Voice slot that plays the hit, -1 if no sample
+    bool stolen;       // An active voice was cut off
+    bool coalesced;    // Merged into a voice started in the same buffer
+};
+
 // Manages a pool of voices for playing samples with infinite polyphony
 class SamplePlayer {
 public:
@@ -82,7 +163,24 @@ public:
     // Trigger a sample to play
     // This is realtime-safe and can be called from the audio callback
     // velocity: 0.0 to 1.0, pan: -1.0 (left) to 1.0 (right)
-    void Trigger(uint8_t midi_note, float velocity, float pan = 0.0f);
+    // Repeat hits of a sample before the next Process call start on the
+    // same frame, so they are merged into one voice (see SetCoalescing)
+    // info (optional) receives the voice slot used
+    // bus selects the stem the voice is rendered into by ProcessStems
+    // (ignored unless SetStemBuses is on)
+    void Trigger(uint8_t midi_note, float velocity, float pan = 0.0f,
+                 TriggerInfo* info = nullptr, uint16_t bus = 0);
+
+    // Enable/disable merging of identical hits into one voice (default on)
+    void SetCoalescing(bool enabled) { coalescing_enabled_ = enabled; }
+    bool GetCoalescing() const { return coalescing_enabled_; }
+
+    // Keep the bus passed to Trigger() for ProcessStems (default off)
+    // While off, voices start on kNoBus, so hits of one sample from
+    // different mappings still coalesce. AudioEngine sets this for every
+    // cycle from whether it renders stems
+    void SetStemBuses(bool enabled) { stem_buses_enabled_ = enabled; }
+    bool GetStemBuses() const { return stem_buses_enabled_; }
 
     // Process audio for one buffer (mono)
     // This is realtime-safe and should be called from the audio callback
@@ -91,13 +189,56 @@ public:
 
     // Process audio for one buffer (stereo with panning)
     // This is realtime-safe and should be called from the audio callback
+    // With render threads enabled, live voices are split across the pool
     void ProcessStereo(float* left, float* right, uint32_t num_frames);
+
+    // Process audio for one buffer into the stereo mix and stem buses
+    // bus_outputs holds num_buses L/R pairs: bus b is rendered into
+    // bus_outputs[2 * b] and bus_outputs[2 * b + 1]. Each voice is mixed
+    // once, accumulating into the mix and its bus together, so the mix is
+    // identical to ProcessStereo. Voices on a bus >= num_buses only reach
+    // the mix. Always renders on the calling thread.
+    // This is realtime-safe.
+    void ProcessStems(float* left, float* right, float* const* bus_outputs,
+                      size_t num_buses, uint32_t num_frames);
+
+    // Enable parallel stereo rendering on num_threads threads (1 = serial)
+    // max_frames bounds the buffer size; larger buffers render serially
+    // rt_priority > 0 requests SCHED_FIFO for the worker threads
+    // NOT realtime-safe: call before the audio callback is running
+    bool SetRenderThreads(size_t num_threads, uint32_t max_frames,
+                          int rt_priority = 0);
+
+    // Set the tile size for stereo rendering: all live voices are mixed
+    // over one tile before advancing to the next (0 = whole buffer)
+    void SetTileSize(uint32_t frames) { tile_frames_ = frames; }
+    uint32_t GetTileSize() const { return tile_frames_; }
+
+    // Get number of render threads (including the audio thread)
+    size_t GetRenderThreads() const { return render_pool_.GetThreadCount(); }
     
-    // Get number of currently active voices
+    // Get number of currently active voices (still playing after the last
+    // Process/ProcessStereo call, plus any triggered since)
     uint32_t GetActiveVoiceCount() const { return active_voice_count_; }
     
     // Get total number of voices triggered (for statistics)
     uint64_t GetTotalTriggersCount() const { return total_triggers_; }
+
+    // Get number of triggers merged into an existing voice (for statistics)
+    uint64_t GetCoalescedTriggersCount() const { return coalesced_triggers_; }
+
+    // Get number of triggers that cut off a playing voice (for statistics)
+    uint64_t GetVoiceStealCount() const { return voice_steals_; }
+
+    // Get the most voices rendered in a single buffer (for statistics)
+    uint32_t GetPeakVoiceCount() const { return peak_voice_count_; }
+
+    // Get the sample bank passed to Init (nullptr before Init)
+    const SampleBank* GetSampleBank() const { return sample_bank_; }
+
+    // Add the player (voice pool) and its render buffers to footprint;
+    // the sample bank is accounted separately
+    void AddFootprint(MemoryFootprint* footprint) const;
     
 private:
     // Pre-allocated voice pool
@@ -117,6 +258,61 @@ private:
     
     // Total number of triggers (for statistics)
     uint64_t total_triggers_;
+
+    // Total number of triggers merged into another voice (for statistics)
+    uint64_t coalesced_triggers_;
+
+    // Total number of active voices cut off by a trigger (for statistics)
+    uint64_t voice_steals_;
+
+    // Most voices rendered in one buffer (for statistics)
+    uint32_t peak_voice_count_;
+
+    // Voices started since the last Process call (all begin on its first frame)
+    bool coalescing_enabled_;
+    bool stem_buses_enabled_;
+    uint16_t fresh_voices_[kMaxVoices];
+    size_t num_fresh_voices_;
+
+    // Frames per render tile (0 = whole buffer)
+    uint32_t tile_frames_;
+
+    // Indices of voices rendered in the current cycle
+    uint16_t live_voices_[kMaxVoices];
+    size_t num_live_voices_;
+
+    // Worker threads for parallel stereo rendering
+    RenderWorkerPool render_pool_;
+
+    // Private L/R scratch buses for workers 1..N-1 (2 * max_render_frames_ each)
+    std::vector<float> scratch_buses_;
+    uint32_t max_render_frames_;
+
+    // Output of the cycle currently being rendered by the pool
+    float* job_left_;
+    float* job_right_;
+    uint32_t job_frames_;
+
+    // Pool job: mix one slice of live_voices_ into that worker's bus
+    static void RenderJob(void* context, size_t worker_index);
+
+    // Clear the outputs of a stereo cycle and collect the live voices
+    void BeginStereoCycle(float* left, float* right, uint32_t num_frames);
+
+    // Count the live voices still playing after a stereo cycle
+    void EndStereoCycle();
+
+    // Mix the listed voices into left/right (and their stem buses, if
+    // given) tile by tile
+    void RenderStereo(const uint16_t* indices, size_t count,
+                      float* left, float* right, uint32_t num_frames,
+                      float* const* bus_outputs = nullptr, size_t num_buses = 0);
+
+    // Mix the listed voices over one tile and retire finished ones
+    // bus_offset is the tile's first frame within the bus buffers
+    void RenderStereoTile(const uint16_t* indices, size_t count,
+                      float* left, float* right, uint32_t num_frames,
+                      float* const* bus_outputs, size_t num_buses, uint32_t bus_offset);
 };
 
 }  // namespace grids_jack
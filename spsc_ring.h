@@ -0,0 +1,79 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace grids_jack {
+
+// Fixed-capacity single-producer, single-consumer queue
+// Storage is preallocated inside the object, so Push() and Pop() are
+// wait-free and safe to call from the audio thread. Exactly one thread
+// may push and exactly one (possibly other) thread may pop.
+template <typename T, size_t kCapacity>
+class SpscRing {
+    static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head_(0), tail_(0) {}
+
+    // Append an item; returns false (and drops it) if the ring is full
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    bool Push(const T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == kCapacity) {
+            return false;
+        }
+        items_[head & (kCapacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Remove the oldest item; returns false if the ring is empty
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    bool Pop(T* item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *item = items_[tail & (kCapacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Number of queued items (exact only on the producer or consumer thread)
+    size_t Size() const {
+        return head_.load(std::memory_order_acquire) -
+               tail_.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t Capacity() { return kCapacity; }
+
+private:
+    // Producer and consumer indices live on separate cache lines
+    std::atomic<size_t> head_;
+    char head_padding_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_;
+    char tail_padding_[64 - sizeof(std::atomic<size_t>)];
+    T items_[kCapacity];
+};
+
+}  // namespace grids_jack
+
+#endif  // SPSC_RING_H_
@@ -0,0 +1,227 @@
+// Test for denormal handling
+// This test verifies that:
+// 1. DisableDenormals() flushes denormal arithmetic to zero on this CPU
+// 2. Render pool workers run with flush-to-zero enabled
+// 3. The load-time guard keeps mixing denormal-free without FTZ support
+// 4. ScopedDenormalsOff restores the previous mode
+
+#include <stdio.h>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "denormals.h"
+#include "render_pool.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+
+using namespace grids_jack;
+
+// Multiply through volatiles so the compiler cannot fold the result
+static float Multiply(float a, float b) {
+  volatile float va = a;
+  volatile float vb = b;
+  return va * vb;
+}
+
+static bool IsDenormal(float value) {
+  return std::fpclassify(value) == FP_SUBNORMAL;
+}
+
+// Test flush-to-zero on a fresh thread (default floating-point mode)
+bool TestFlushToZero() {
+  fprintf(stderr, "\nTest: Flush To Zero\n");
+  fprintf(stderr, "===================\n");
+
+  bool ok = true;
+  std::thread thread([&ok]() {
+    float before = Multiply(1e-37f, 0.01f);
+    if (IsDenormal(before)) {
+      fprintf(stderr, "  Default mode produces denormal %g\n", before);
+    } else {
+      fprintf(stderr, "  Note: Denormals already flushed by default\n");
+    }
+
+    if (!DisableDenormals()) {
+      fprintf(stderr, "  SKIP: No flush-to-zero mode on this CPU, "
+              "relying on the load-time guard\n");
+      return;
+    }
+
+    if (!DenormalsDisabled()) {
+      fprintf(stderr, "  FAIL: Flush-to-zero not reported as active\n");
+      ok = false;
+      return;
+    }
+
+    float after = Multiply(1e-37f, 0.01f);
+    if (after != 0.0f) {
+      fprintf(stderr, "  FAIL: Expected 0 with FTZ, got %g\n", after);
+      ok = false;
+      return;
+    }
+
+    fprintf(stderr, "  PASS: Denormal result flushed to zero\n");
+  });
+  thread.join();
+
+  return ok;
+}
+
+static void RecordFlushMode(void* context, size_t worker_index) {
+  bool* flags = static_cast<bool*>(context);
+  flags[worker_index] = DenormalsDisabled();
+}
+
+// Test that pool workers disable denormals before their first job
+bool TestWorkerThreads() {
+  fprintf(stderr, "\nTest: Worker Threads\n");
+  fprintf(stderr, "====================\n");
+
+  // Workers are spawned from a thread in the default mode, so they
+  // must enable flush-to-zero themselves
+  const size_t num_threads = 4;
+  RenderWorkerPool pool;
+  if (!pool.Start(num_threads, 0)) {
+    fprintf(stderr, "  FAIL: Could not start pool\n");
+    return false;
+  }
+
+  // Slot 0 is the audio thread, which the backend configures
+  ScopedDenormalsOff guard;
+  if (!DenormalsDisabled()) {
+    fprintf(stderr, "  SKIP: No flush-to-zero mode on this CPU\n");
+    return true;
+  }
+
+  bool flags[kMaxRenderThreads] = {false};
+  pool.Run(RecordFlushMode, flags);
+  pool.Stop();
+
+  for (size_t i = 0; i < num_threads; i++) {
+    if (!flags[i]) {
+      fprintf(stderr, "  FAIL: Render slot %zu runs without flush-to-zero\n", i);
+      return false;
+    }
+  }
+
+  fprintf(stderr, "  PASS: All %zu render slots flush denormals\n", num_threads);
+  return true;
+}
+
+// Test the load-time guard on a thread without FTZ, as on CPUs that lack it
+bool TestLoadTimeGuard() {
+  fprintf(stderr, "\nTest: Load-Time Guard\n");
+  fprintf(stderr, "=====================\n");
+
+  bool ok = true;
+  std::thread thread([&ok]() {
+    // A tail decaying exponentially through the denormal range
+    const uint32_t length = 4096;
+    std::vector<float> data(length);
+    for (uint32_t i = 0; i < length; i++) {
+      data[i] = 0.5f * expf(-0.03f * static_cast<float>(i));
+    }
+
+    SampleBank bank;
+    bank.AddSample(60, data, "tail");
+    const Sample* sample = bank.GetSample(60);
+
+    for (uint32_t i = 0; i < length; i++) {
+      float value = sample->data[i];
+      if (value != 0.0f && fabsf(value) < kDenormalGuard) {
+        fprintf(stderr, "  FAIL: Frame %u (%g) not flushed\n", i, value);
+        ok = false;
+        return;
+      }
+      if (fabsf(data[i]) >= kDenormalGuard && value != data[i]) {
+        fprintf(stderr, "  FAIL: Audible frame %u was modified\n", i);
+        ok = false;
+        return;
+      }
+    }
+
+    // Mix at low velocity and hard pan, the worst case for tiny products
+    SamplePlayer player;
+    player.Init(&bank, 48000);
+    player.Trigger(60, 0.1f, 1.0f);
+
+    float left[256];
+    float right[256];
+    for (uint32_t pos = 0; pos < length; pos += 256) {
+      player.ProcessStereo(left, right, 256);
+      for (uint32_t i = 0; i < 256; i++) {
+        if (IsDenormal(left[i]) || IsDenormal(right[i])) {
+          fprintf(stderr, "  FAIL: Denormal output at frame %u\n", pos + i);
+          ok = false;
+          return;
+        }
+      }
+    }
+
+    fprintf(stderr, "  PASS: Tail mixed without denormals\n");
+  });
+  thread.join();
+
+  return ok;
+}
+
+// Test that the scoped guard restores the previous mode
+bool TestScopedGuard() {
+  fprintf(stderr, "\nTest: Scoped Guard\n");
+  fprintf(stderr, "==================\n");
+
+  bool ok = true;
+  std::thread thread([&ok]() {
+    bool before = DenormalsDisabled();
+    {
+      ScopedDenormalsOff guard;
+      float inside = Multiply(1e-37f, 0.01f);
+      if (DenormalsDisabled() && inside != 0.0f) {
+        fprintf(stderr, "  FAIL: Denormal produced inside guard\n");
+        ok = false;
+      }
+    }
+    if (DenormalsDisabled() != before) {
+      fprintf(stderr, "  FAIL: Mode not restored after guard\n");
+      ok = false;
+    }
+  });
+  thread.join();
+
+  if (ok) {
+    fprintf(stderr, "  PASS: Previous mode restored\n");
+  }
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+
+  fprintf(stderr, "Denormal Handling Test Suite\n");
+  fprintf(stderr, "============================\n");
+
+  int passed = 0;
+  int failed = 0;
+
+  if (TestFlushToZero()) passed++; else failed++;
+  if (TestWorkerThreads()) passed++; else failed++;
+  if (TestLoadTimeGuard()) passed++; else failed++;
+  if (TestScopedGuard()) passed++; else failed++;
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
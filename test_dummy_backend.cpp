@@ -0,0 +1,304 @@
+// Test for the dummy audio backend
+// This test verifies that:
+// 1. Cycles run at exact period timing on the backend's audio thread
+// 2. A cycle that overruns its period is reported as an xrun
+// 3. The engine runs on the dummy backend like it does on JACK
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "audio_engine.h"
+#include "dummy_backend.h"
+#include "engine_stats.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+#include "pattern_generator_wrapper.h"
+
+using namespace grids_jack;
+
+// Records what the backend calls, and optionally overruns one cycle
+class RecordingClient : public AudioBackendClient {
+public:
+  RecordingClient(DummyBackend* backend, size_t max_cycles)
+      : backend_(backend), timestamps_(max_cycles, 0), cycles_(0),
+        thread_inits_(0), init_before_process_(true), frames_ok_(true),
+        overrun_cycle_(-1), overrun_ns_(0), xruns_(0), xrun_delay_us_(0.0f),
+        xrun_on_audio_thread_(true) {}
+
+  void Process(float* const* outputs, uint32_t num_frames) {
+    uint64_t now = MonotonicNanos();
+    if (thread_inits_ == 0) init_before_process_ = false;
+
+    // The transport has advanced by exactly the cycles already run
+    TransportInfo transport;
+    backend_->QueryTransport(&transport);
+    if (transport.frame != cycles_ * num_frames ||
+        num_frames != backend_->GetBufferSize() || outputs[1] == nullptr) {
+      frames_ok_ = false;
+    }
+
+    if (cycles_ < timestamps_.size()) timestamps_[cycles_] = now;
+    if (static_cast<int64_t>(cycles_) == overrun_cycle_) {
+      while (MonotonicNanos() - now < overrun_ns_) {
+      }
+    }
+    cycles_++;
+  }
+
+  void ThreadInit() {
+    audio_thread_ = pthread_self();
+    thread_inits_++;
+  }
+
+  void Xrun(float delayed_usecs) {
+    if (!pthread_equal(pthread_self(), audio_thread_)) xrun_on_audio_thread_ = false;
+    if (delayed_usecs > xrun_delay_us_) xrun_delay_us_ = delayed_usecs;
+    xruns_++;
+  }
+
+  DummyBackend* backend_;
+  std::vector<uint64_t> timestamps_;
+  uint64_t cycles_;
+  int thread_inits_;
+  bool init_before_process_;
+  bool frames_ok_;
+  int64_t overrun_cycle_;
+  uint64_t overrun_ns_;
+  uint32_t xruns_;
+  float xrun_delay_us_;
+  bool xrun_on_audio_thread_;
+  pthread_t audio_thread_;
+};
+
+static void SleepMs(unsigned int ms) {
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&ts, nullptr);
+}
+
+static bool OpenStereo(DummyBackend* backend, AudioBackendClient* client) {
+  return backend->Open("test", client) && backend->RegisterOutput("output_L") &&
+         backend->RegisterOutput("output_R") && backend->Activate();
+}
+
+// Test that cycles follow the period without drift
+bool TestPeriodTiming() {
+  fprintf(stderr, "\nTest: Period Timing\n");
+  fprintf(stderr, "===================\n");
+
+  const uint32_t sample_rate = 48000;
+  const uint32_t buffer_size = 256;
+  const double period_ns = 1e9 * buffer_size / sample_rate;
+
+  DummyBackend backend(sample_rate, buffer_size);
+  RecordingClient client(&backend, 1024);
+  if (!OpenStereo(&backend, &client)) {
+    fprintf(stderr, "  FAIL: Could not start the dummy backend\n");
+    return false;
+  }
+  SleepMs(1000);
+  backend.Close();
+
+  fprintf(stderr, "  %llu cycles in 1 s (priority %d), %u xruns, load %.2f%%\n",
+          (unsigned long long)backend.GetCycleCount(), backend.GetRealtimePriority(),
+          backend.GetXrunCount(), backend.GetCpuLoad());
+
+  if (client.thread_inits_ != 1 || !client.init_before_process_) {
+    fprintf(stderr, "  FAIL: ThreadInit ran %d times, before first cycle: %d\n",
+            client.thread_inits_, client.init_before_process_);
+    return false;
+  }
+  if (!client.frames_ok_) {
+    fprintf(stderr, "  FAIL: Transport frame or buffer size wrong in a cycle\n");
+    return false;
+  }
+  if (client.cycles_ != backend.GetCycleCount()) {
+    fprintf(stderr, "  FAIL: Client saw %llu cycles, backend counted %llu\n",
+            (unsigned long long)client.cycles_,
+            (unsigned long long)backend.GetCycleCount());
+    return false;
+  }
+
+  // 187.5 periods per second; allow for thread start and stop
+  if (client.cycles_ < 170 || client.cycles_ > 200) {
+    fprintf(stderr, "  FAIL: %llu cycles, expected about 187\n",
+            (unsigned long long)client.cycles_);
+    return false;
+  }
+
+  // Without xruns the schedule is absolute, so the average period is exact
+  // to within the wakeup jitter of the first and last cycle
+  if (backend.GetXrunCount() == 0) {
+    size_t n = static_cast<size_t>(client.cycles_);
+    double mean = static_cast<double>(client.timestamps_[n - 1] - client.timestamps_[0]) /
+                  (n - 1);
+    fprintf(stderr, "  Mean period %.1f us (nominal %.1f us)\n", mean / 1000.0,
+            period_ns / 1000.0);
+    if (mean < period_ns * 0.99 || mean > period_ns * 1.01) {
+      fprintf(stderr, "  FAIL: Mean period off by more than 1%%\n");
+      return false;
+    }
+  } else {
+    fprintf(stderr, "  Note: Xruns on this machine, skipping the drift check\n");
+  }
+
+  fprintf(stderr, "  PASS: Cycles follow the period on the audio thread\n");
+  return true;
+}
+
+// Test that a cycle running for several periods is reported as an xrun
+bool TestXrunDetected() {
+  fprintf(stderr, "\nTest: Xrun Detected\n");
+  fprintf(stderr, "===================\n");
+
+  const uint32_t sample_rate = 48000;
+  const uint32_t buffer_size = 128;
+  const double period_us = 1e6 * buffer_size / sample_rate;
+
+  DummyBackend backend(sample_rate, buffer_size);
+  RecordingClient client(&backend, 1024);
+  client.overrun_cycle_ = 20;
+  client.overrun_ns_ = static_cast<uint64_t>(3 * period_us * 1000.0);
+  if (!OpenStereo(&backend, &client)) {
+    fprintf(stderr, "  FAIL: Could not start the dummy backend\n");
+    return false;
+  }
+  SleepMs(300);
+  backend.Close();
+
+  fprintf(stderr, "  %llu cycles, %u xruns, worst %.0f us late (period %.0f us)\n",
+          (unsigned long long)backend.GetCycleCount(), backend.GetXrunCount(),
+          client.xrun_delay_us_, period_us);
+
+  if (client.xruns_ == 0 || client.xruns_ != backend.GetXrunCount()) {
+    fprintf(stderr, "  FAIL: Overrun not reported (%u callbacks, %u counted)\n",
+            client.xruns_, backend.GetXrunCount());
+    return false;
+  }
+  if (!client.xrun_on_audio_thread_) {
+    fprintf(stderr, "  FAIL: Xrun callback not on the audio thread\n");
+    return false;
+  }
+
+  // Three periods of work in one period: two periods late at least
+  if (client.xrun_delay_us_ < 1.9 * period_us) {
+    fprintf(stderr, "  FAIL: Reported delay %.0f us is too small\n", client.xrun_delay_us_);
+    return false;
+  }
+
+  // The schedule restarts after the xrun rather than stopping
+  if (client.cycles_ < 100) {
+    fprintf(stderr, "  FAIL: Only %llu cycles after the overrun\n",
+            (unsigned long long)client.cycles_);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: Overrun reported with its delay, cycles resumed\n");
+  return true;
+}
+
+// Drives the engine from the backend the way main.cpp does
+class EngineClient : public AudioBackendClient {
+public:
+  explicit EngineClient(AudioEngine* engine) : engine_(engine) {}
+
+  void Process(float* const* outputs, uint32_t num_frames) {
+    engine_->Process(outputs[0], outputs[1], num_frames);
+  }
+
+  AudioEngine* engine_;
+};
+
+// Test the engine on the dummy backend
+bool TestEngineOnDummyBackend(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Engine On Dummy Backend\n");
+  fprintf(stderr, "=============================\n");
+
+  const uint32_t sample_rate = 48000;
+  const uint32_t buffer_size = 128;
+
+  SamplePlayer player;
+  player.Init(&bank, sample_rate);
+  PatternGeneratorWrapper pattern_gen;
+  pattern_gen.Init(&player, sample_rate, 174.0f);
+  pattern_gen.SetHumanize(0.5f);
+  pattern_gen.AssignSamplesToParts(bank.GetAllNotes(), 8, 32);
+
+  AudioEngine engine;
+  engine.Init(&player, &pattern_gen, sample_rate);
+
+  DummyBackend backend(sample_rate, buffer_size);
+  EngineClient client(&engine);
+  if (!OpenStereo(&backend, &client)) {
+    fprintf(stderr, "  FAIL: Could not start the dummy backend\n");
+    return false;
+  }
+  SleepMs(1000);
+  float load = backend.GetCpuLoad();
+  backend.Close();
+
+  EngineStats stats;
+  engine.ReadStats(&stats);
+  fprintf(stderr, "  %llu callbacks, %llu triggers, backend load %.2f%%, engine p99 %u ns\n",
+          (unsigned long long)stats.callbacks, (unsigned long long)stats.triggers_total,
+          load, engine.GetCallbackHistogram().Percentile(0.99f));
+
+  if (stats.callbacks != backend.GetCycleCount()) {
+    fprintf(stderr, "  FAIL: Engine ran %llu times for %llu cycles\n",
+            (unsigned long long)stats.callbacks,
+            (unsigned long long)backend.GetCycleCount());
+    return false;
+  }
+  if (stats.triggers_total == 0) {
+    fprintf(stderr, "  FAIL: No triggers in 1 s at 174 BPM\n");
+    return false;
+  }
+  if (!(load > 0.0f && load < 100.0f)) {
+    fprintf(stderr, "  FAIL: CPU load %.2f%% out of range\n", load);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: Engine plays on the dummy backend\n");
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+
+  fprintf(stderr, "Dummy Backend Test Suite\n");
+  fprintf(stderr, "========================\n");
+
+  SampleBank bank;
+  if (!bank.LoadDirectory("data", 48000)) {
+    fprintf(stderr, "Error: Failed to load samples from data/\n");
+    return 1;
+  }
+
+  int passed = 0;
+  int failed = 0;
+
+  if (TestPeriodTiming()) passed++; else failed++;
+  if (TestXrunDetected()) passed++; else failed++;
+  if (TestEngineOnDummyBackend(bank)) passed++; else failed++;
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,429 @@
+// Test for engine statistics publication
+// This test verifies that:
+// 1. Readers never observe a torn snapshot while the writer publishes
+// 2. The sample player counts voice steals and peak polyphony
+// 3. The pattern generator counts hits per drum part
+// 4. The timing histogram bins durations and reports percentiles
+// 5. The memory footprint accounts for sample frames, buffer padding,
+//    the voice pool, render buffers and the trigger queue, and its total
+//    is published with the statistics
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "audio_engine.h"
+#include "engine_stats.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+#include "pattern_generator_wrapper.h"
+
+using namespace grids_jack;
+
+// Fill every field from one counter so a mixed snapshot is detectable
+static void FillStats(EngineStats* stats, uint32_t n) {
+  stats->callbacks = n;
+  stats->idle_callbacks = n;
+  stats->voices_active = n;
+  stats->voices_peak = n;
+  stats->voice_steals = n;
+  stats->triggers_total = n;
+  stats->triggers_coalesced = n;
+  for (size_t i = 0; i < kStatsParts; i++) {
+    stats->triggers_per_part[i] = n;
+  }
+  stats->pending_depth = n;
+  stats->pending_overflows = n;
+  stats->callback_ns = n;
+  stats->callback_max_ns = n;
+  stats->period_ns = n;
+  stats->dsp_load = static_cast<float>(n & 0xffff);
+  stats->memory_bytes = n;
+}
+
+static bool IsConsistent(const EngineStats& stats) {
+  uint32_t n = static_cast<uint32_t>(stats.callbacks);
+  bool ok = stats.idle_callbacks == n && stats.voices_active == n &&
+            stats.voices_peak == n && stats.voice_steals == n &&
+            stats.triggers_total == n && stats.triggers_coalesced == n &&
+            stats.pending_depth == n && stats.pending_overflows == n &&
+            stats.callback_ns == n && stats.callback_max_ns == n &&
+            stats.period_ns == n && stats.memory_bytes == n &&
+            stats.dsp_load == static_cast<float>(n & 0xffff);
+  for (size_t i = 0; i < kStatsParts; i++) {
+    ok = ok && stats.triggers_per_part[i] == n;
+  }
+  return ok;
+}
+
+// Test that concurrent reads always see a whole snapshot
+bool TestNoTornReads() {
+  fprintf(stderr, "\nTest: No Torn Reads\n");
+  fprintf(stderr, "===================\n");
+
+  EngineStatsPublisher publisher;
+  EngineStats initial;
+  publisher.Read(&initial);
+  if (!IsConsistent(initial) || initial.callbacks != 0) {
+    fprintf(stderr, "  FAIL: Snapshot before first publish is not zero\n");
+    return false;
+  }
+
+  const uint32_t num_publishes = 2000000;
+  std::atomic<bool> done(false);
+
+  std::thread writer([&publisher, &done]() {
+    EngineStats stats;
+    for (uint32_t n = 1; n <= num_publishes; n++) {
+      FillStats(&stats, n);
+      publisher.Publish(stats);
+    }
+    done.store(true);
+  });
+
+  uint64_t reads = 0;
+  uint64_t last = 0;
+  bool ok = true;
+  while (!done.load()) {
+    EngineStats stats;
+    publisher.Read(&stats);
+    reads++;
+    if (!IsConsistent(stats)) {
+      fprintf(stderr, "  FAIL: Torn snapshot at read %llu\n", (unsigned long long)reads);
+      ok = false;
+      break;
+    }
+    if (stats.callbacks < last) {
+      fprintf(stderr, "  FAIL: Snapshot went backwards (%llu -> %llu)\n",
+              (unsigned long long)last, (unsigned long long)stats.callbacks);
+      ok = false;
+      break;
+    }
+    last = stats.callbacks;
+  }
+  writer.join();
+  if (!ok) {
+    return false;
+  }
+
+  EngineStats final_stats;
+  publisher.Read(&final_stats);
+  if (final_stats.callbacks != num_publishes) {
+    fprintf(stderr, "  FAIL: Final snapshot is %llu, expected %u\n",
+            (unsigned long long)final_stats.callbacks, num_publishes);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %llu concurrent reads, all consistent\n",
+          (unsigned long long)reads);
+  return true;
+}
+
+// Test steal and peak counters on a small voice pool workload
+bool TestVoiceCounters() {
+  fprintf(stderr, "\nTest: Voice Counters\n");
+  fprintf(stderr, "====================\n");
+
+  SampleBank bank;
+  bank.AddSample(60, std::vector<float>(48000, 0.25f), "long");
+
+  SamplePlayer player;
+  player.Init(&bank, 48000);
+  player.SetCoalescing(false);
+
+  float left[64];
+  float right[64];
+
+  // Fill the pool, then trigger more to force steals
+  const uint32_t extra = 10;
+  for (size_t i = 0; i < kMaxVoices + extra; i++) {
+    player.Trigger(60, 0.5f);
+  }
+  player.ProcessStereo(left, right, 64);
+
+  if (player.GetVoiceStealCount() != extra) {
+    fprintf(stderr, "  FAIL: Expected %u steals, got %llu\n", extra,
+            (unsigned long long)player.GetVoiceStealCount());
+    return false;
+  }
+  if (player.GetPeakVoiceCount() != kMaxVoices) {
+    fprintf(stderr, "  FAIL: Expected peak %zu, got %u\n", kMaxVoices,
+            player.GetPeakVoiceCount());
+    return false;
+  }
+
+  player.Init(&bank, 48000);
+  if (player.GetVoiceStealCount() != 0 || player.GetPeakVoiceCount() != 0) {
+    fprintf(stderr, "  FAIL: Counters not reset by Init\n");
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %u steals and peak of %zu voices counted\n", extra, kMaxVoices);
+  return true;
+}
+
+// Test that per-part hits add up to the triggers sent to the player
+bool TestPartCounters(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Part Counters\n");
+  fprintf(stderr, "===================\n");
+
+  SamplePlayer player;
+  player.Init(&bank, 48000);
+  player.SetCoalescing(false);
+
+  PatternGeneratorWrapper pattern_gen;
+  pattern_gen.Init(&player, 48000, 120.0f);
+  pattern_gen.AssignSamplesToParts(bank.GetAllNotes(), 3, 32);
+
+  float left[256];
+  float right[256];
+  for (uint32_t b = 0; b < 48000 * 8 / 256; b++) {
+    pattern_gen.Process(256);
+    player.ProcessStereo(left, right, 256);
+  }
+
+  // Each hit triggers every sample mapped to its part
+  const std::vector<SampleMapping>& mappings = pattern_gen.GetSampleMappings();
+  uint64_t sum = 0;
+  uint64_t expected_triggers = 0;
+  for (int part = 0; part < DRUM_PART_COUNT; part++) {
+    uint64_t count = pattern_gen.GetPartTriggerCount(static_cast<DrumPart>(part));
+    fprintf(stderr, "  Part %d: %llu hits\n", part, (unsigned long long)count);
+    sum += count;
+    for (size_t i = 0; i < mappings.size(); i++) {
+      if (mappings[i].drum_part == static_cast<DrumPart>(part)) {
+        expected_triggers += count;
+      }
+    }
+  }
+
+  if (sum == 0) {
+    fprintf(stderr, "  FAIL: No hits counted in 8 seconds\n");
+    return false;
+  }
+  if (expected_triggers != player.GetTotalTriggersCount()) {
+    fprintf(stderr, "  FAIL: Part hits imply %llu triggers but player saw %llu\n",
+            (unsigned long long)expected_triggers,
+            (unsigned long long)player.GetTotalTriggersCount());
+    return false;
+  }
+  if (pattern_gen.GetPendingTriggerCount() != 0 ||
+      pattern_gen.GetPendingOverflowCount() != 0) {
+    fprintf(stderr, "  FAIL: Pending queue used without humanize\n");
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: Part hits match player triggers\n");
+  return true;
+}
+
+// Test that every duration lands in a bin whose bounds contain it
+bool TestHistogramBins() {
+  fprintf(stderr, "\nTest: Histogram Bins\n");
+  fprintf(stderr, "====================\n");
+
+  uint32_t previous_upper = 0;
+  for (size_t bin = 0; bin < TimingHistogram::kNumBins; bin++) {
+    uint32_t upper = TimingHistogram::BinUpperBound(bin);
+    if (bin > 0 && upper <= previous_upper) {
+      fprintf(stderr, "  FAIL: Bin %zu bound %u not above bin %zu\n", bin, upper, bin - 1);
+      return false;
+    }
+    previous_upper = upper;
+  }
+  if (previous_upper != 0xffffffffu) {
+    fprintf(stderr, "  FAIL: Last bin ends at %u\n", previous_upper);
+    return false;
+  }
+
+  // Walk durations geometrically plus their neighbours
+  for (uint64_t ns = 1; ns <= 0xffffffffull; ns = ns * 9 / 8 + 1) {
+    for (int d = -1; d <= 1; d++) {
+      uint32_t value = static_cast<uint32_t>(ns + d);
+      size_t bin = TimingHistogram::BinIndex(value);
+      uint32_t lower = bin == 0 ? 0 : TimingHistogram::BinUpperBound(bin - 1) + 1;
+      if (bin >= TimingHistogram::kNumBins || value < lower ||
+          value > TimingHistogram::BinUpperBound(bin)) {
+        fprintf(stderr, "  FAIL: %u placed in bin %zu\n", value, bin);
+        return false;
+      }
+      // Bin width stays within 1/8 of the value
+      uint32_t width = TimingHistogram::BinUpperBound(bin) - lower;
+      if (value >= TimingHistogram::kSubBins && width > value / 8) {
+        fprintf(stderr, "  FAIL: Bin for %u is %u wide\n", value, width);
+        return false;
+      }
+    }
+  }
+
+  fprintf(stderr, "  PASS: %zu bins cover 0..2^32-1 at 12.5%% resolution\n",
+          TimingHistogram::kNumBins);
+  return true;
+}
+
+// Test percentiles on a known distribution
+bool TestHistogramPercentiles() {
+  fprintf(stderr, "\nTest: Histogram Percentiles\n");
+  fprintf(stderr, "===========================\n");
+
+  TimingHistogram histogram;
+  if (histogram.Percentile(0.5f) != 0) {
+    fprintf(stderr, "  FAIL: Empty histogram reports a percentile\n");
+    return false;
+  }
+
+  // 98 fast callbacks around 100 us, one at 1 ms and one at 5 ms
+  for (uint32_t i = 0; i < 98; i++) {
+    histogram.Record(100000 + i * 100);
+  }
+  histogram.Record(1000000);
+  histogram.Record(5000000);
+
+  if (histogram.GetCount() != 100) {
+    fprintf(stderr, "  FAIL: Expected 100 samples, got %llu\n",
+            (unsigned long long)histogram.GetCount());
+    return false;
+  }
+
+  uint32_t p50 = histogram.Percentile(0.50f);
+  uint32_t p99 = histogram.Percentile(0.99f);
+  uint32_t p100 = histogram.Percentile(1.0f);
+  fprintf(stderr, "  p50 %u ns, p99 %u ns, max %u ns\n", p50, p99, p100);
+
+  if (p50 < 100000 || p50 > 100000 * 9 / 8 + 100 * 98) {
+    fprintf(stderr, "  FAIL: p50 out of range\n");
+    return false;
+  }
+  if (p99 < 1000000 || p99 > 1000000 * 9 / 8) {
+    fprintf(stderr, "  FAIL: p99 out of range\n");
+    return false;
+  }
+  if (p100 < 5000000 || p100 > 5000000 * 9 / 8) {
+    fprintf(stderr, "  FAIL: max out of range\n");
+    return false;
+  }
+
+  histogram.Clear();
+  if (histogram.GetCount() != 0) {
+    fprintf(stderr, "  FAIL: Clear left samples behind\n");
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: Percentiles within one bin of the true value\n");
+  return true;
+}
+
+// Test the memory footprint categories and the published total
+bool TestMemoryFootprint() {
+  fprintf(stderr, "\nTest: Memory Footprint\n");
+  fprintf(stderr, "======================\n");
+
+  SampleBank bank;
+  bank.AddSample(36, std::vector<float>(1000, 0.5f), "kick");
+  bank.AddSample(38, std::vector<float>(3000, 0.5f), "snare");
+
+  MemoryFootprint footprint;
+  bank.AddFootprint(&footprint);
+  if (footprint.sample_data != 4000 * sizeof(float) || footprint.sample_padding != 0) {
+    fprintf(stderr, "  FAIL: Expected %zu data bytes and no padding, got %zu and %zu\n",
+            4000 * sizeof(float), footprint.sample_data, footprint.sample_padding);
+    return false;
+  }
+  if (footprint.sample_overhead < sizeof(SampleBank) + 2 * sizeof(Sample)) {
+    fprintf(stderr, "  FAIL: Overhead of %zu bytes misses the bank and its samples\n",
+            footprint.sample_overhead);
+    return false;
+  }
+
+  // A shorter replacement keeps the old buffer
+  bank.AddSample(38, std::vector<float>(2000, 0.5f), "snare2");
+  footprint.Clear();
+  bank.AddFootprint(&footprint);
+  if (footprint.sample_data != 3000 * sizeof(float) ||
+      footprint.sample_padding != 1000 * sizeof(float)) {
+    fprintf(stderr, "  FAIL: Expected %zu data and %zu padding bytes, got %zu and %zu\n",
+            3000 * sizeof(float), 1000 * sizeof(float), footprint.sample_data,
+            footprint.sample_padding);
+    return false;
+  }
+
+  SamplePlayer player;
+  player.Init(&bank, 48000);
+  player.SetRenderThreads(2, 256);
+  PatternGeneratorWrapper pattern_gen;
+  pattern_gen.Init(&player, 48000, 120.0f);
+  pattern_gen.AssignSamplesToParts(bank.GetAllNotes(), 2, 32);
+  AudioEngine engine;
+  engine.Init(&player, &pattern_gen, 48000);
+
+  engine.GetMemoryFootprint(&footprint);
+  if (footprint.voice_pool < kMaxVoices * sizeof(Voice) ||
+      footprint.render_buffers < 2 * 256 * sizeof(float) ||
+      footprint.trigger_queue != kMaxPendingTriggers * sizeof(PendingTrigger) ||
+      footprint.pattern_state < 2 * sizeof(SampleMapping) ||
+      footprint.engine_state != sizeof(AudioEngine)) {
+    fprintf(stderr, "  FAIL: Categories too small (voices %zu, render %zu, queue %zu, "
+            "pattern %zu, engine %zu)\n", footprint.voice_pool, footprint.render_buffers,
+            footprint.trigger_queue, footprint.pattern_state, footprint.engine_state);
+    return false;
+  }
+
+  // Published before the first callback and kept by later ones
+  EngineStats stats;
+  engine.ReadStats(&stats);
+  uint64_t at_init = stats.memory_bytes;
+  float left[256];
+  float right[256];
+  engine.Process(left, right, 256);
+  engine.ReadStats(&stats);
+  if (at_init != footprint.Total() || stats.memory_bytes != footprint.Total()) {
+    fprintf(stderr, "  FAIL: Published %llu bytes at Init and %llu after a callback, "
+            "expected %zu\n", (unsigned long long)at_init,
+            (unsigned long long)stats.memory_bytes, footprint.Total());
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %zu bytes accounted (%zu of sample data)\n",
+          footprint.Total(), footprint.sample_data);
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+
+  fprintf(stderr, "Engine Statistics Test Suite\n");
+  fprintf(stderr, "============================\n");
+
+  SampleBank bank;
+  if (!bank.LoadDirectory("data", 48000)) {
+    fprintf(stderr, "Error: Failed to load samples from data/\n");
+    return 1;
+  }
+
+  int passed = 0;
+  int failed = 0;
+
+  if (TestNoTornReads()) passed++; else failed++;
+  if (TestVoiceCounters()) passed++; else failed++;
+  if (TestPartCounters(bank)) passed++; else failed++;
+  if (TestHistogramBins()) passed++; else failed++;
+  if (TestHistogramPercentiles()) passed++; else failed++;
+  if (TestMemoryFootprint()) passed++; else failed++;
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,396 @@
+// Test for the binary event trace
+// This test verifies that:
+// 1. SpscRing delivers every item in order across threads
+// 2. Trigger() reports the voice slot, steals and coalesced hits
+// 3. A traced run writes one record per trigger with consistent timing
+// 4. Tracing adds under 1% to the audio thread's pattern/mix loop
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+#include "event_trace.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+#include "pattern_generator_wrapper.h"
+#include "spsc_ring.h"
+
+using namespace grids_jack;
+
+// CPU time of the calling thread, so the trace writer thread is not counted
+static double ThreadSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Test ordering and wrap-around with a small ring
+bool TestRingOrdering() {
+  fprintf(stderr, "\nTest: Ring Ordering\n");
+  fprintf(stderr, "===================\n");
+
+  SpscRing<uint32_t, 64>* ring = new SpscRing<uint32_t, 64>();
+  const uint32_t num_items = 1000000;
+  uint64_t full_count = 0;
+
+  // Both sides yield when blocked so the test also runs on one core
+  std::thread producer([ring, &full_count]() {
+    for (uint32_t i = 0; i < num_items; i++) {
+      while (!ring->Push(i)) {
+        full_count++;
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  // Keep draining after a mismatch, or the producer never finishes
+  uint32_t expected = 0;
+  uint32_t received = 0;
+  bool ok = true;
+  while (received < num_items) {
+    uint32_t item;
+    if (!ring->Pop(&item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (ok && item != expected) {
+      fprintf(stderr, "  FAIL: Expected item %u, got %u\n", expected, item);
+      ok = false;
+    }
+    expected = item + 1;
+    received++;
+  }
+  producer.join();
+
+  uint32_t item;
+  if (ok && (ring->Pop(&item) || ring->Size() != 0)) {
+    fprintf(stderr, "  FAIL: Ring not empty after consuming everything\n");
+    ok = false;
+  }
+  delete ring;
+  if (!ok) {
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %u items in order (%llu pushes hit a full ring)\n",
+          num_items, (unsigned long long)full_count);
+  return true;
+}
+
+// Test that Trigger() describes what it did
+bool TestTriggerInfo() {
+  fprintf(stderr, "\nTest: Trigger Info\n");
+  fprintf(stderr, "==================\n");
+
+  SampleBank bank;
+  bank.AddSample(60, std::vector<float>(4800, 0.25f), "a");
+  bank.AddSample(61, std::vector<float>(4800, 0.25f), "b");
+
+  SamplePlayer player;
+  player.Init(&bank, 48000);
+
+  TriggerInfo info;
+  player.Trigger(99, 1.0f, 0.0f, &info);
+  if (info.voice != -1) {
+    fprintf(stderr, "  FAIL: Missing sample reported voice %d\n", info.voice);
+    return false;
+  }
+
+  player.Trigger(60, 1.0f, 0.0f, &info);
+  if (info.voice != 0 || info.stolen || info.coalesced) {
+    fprintf(stderr, "  FAIL: First hit: voice %d stolen %d coalesced %d\n",
+            info.voice, info.stolen, info.coalesced);
+    return false;
+  }
+
+  player.Trigger(61, 1.0f, 0.0f, &info);
+  player.Trigger(60, 0.5f, 0.0f, &info);
+  if (info.voice != 0 || !info.coalesced) {
+    fprintf(stderr, "  FAIL: Repeat hit not reported as coalesced into voice 0\n");
+    return false;
+  }
+
+  // Wrap the pool so the next allocation lands on a playing voice
+  float left[64];
+  float right[64];
+  player.ProcessStereo(left, right, 64);
+  for (size_t i = 2; i < kMaxVoices; i++) {
+    player.Trigger(61, 1.0f, 0.0f, &info);
+    player.ProcessStereo(left, right, 1);
+  }
+  player.Trigger(60, 1.0f, 0.0f, &info);
+  if (info.voice != 0 || !info.stolen) {
+    fprintf(stderr, "  FAIL: Wrapped hit: voice %d stolen %d\n", info.voice, info.stolen);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: Voice slot, steal and coalesce reported\n");
+  return true;
+}
+
+// Test that records dropped on a full ring are counted
+bool TestDroppedRecords() {
+  fprintf(stderr, "\nTest: Dropped Records\n");
+  fprintf(stderr, "=====================\n");
+
+  EventTrace* trace = new EventTrace();
+  TraceRecord record;
+  memset(&record, 0, sizeof(record));
+  const size_t extra = 100;
+  for (size_t i = 0; i < EventTrace::kRingCapacity + extra; i++) {
+    trace->Record(record);
+  }
+  uint64_t dropped = trace->GetDroppedCount();
+  delete trace;
+
+  if (dropped != extra) {
+    fprintf(stderr, "  FAIL: Expected %zu dropped, got %llu\n", extra,
+            (unsigned long long)dropped);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %zu records beyond capacity counted as dropped\n", extra);
+  return true;
+}
+
+// Run the pattern generator and player for a number of blocks
+static void RunEngine(PatternGeneratorWrapper* pattern_gen, SamplePlayer* player,
+                      uint32_t num_blocks, uint32_t block_size) {
+  std::vector<float> left(block_size);
+  std::vector<float> right(block_size);
+  for (uint32_t b = 0; b < num_blocks; b++) {
+    pattern_gen->Process(block_size);
+    player->ProcessStereo(left.data(), right.data(), block_size);
+  }
+}
+
+// Test a traced humanized run end to end
+bool TestTraceFile(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Trace File\n");
+  fprintf(stderr, "================\n");
+
+  const uint32_t sample_rate = 48000;
+  const uint32_t block_size = 256;
+  const uint32_t num_blocks = 30 * sample_rate / block_size;
+
+  char path[] = "/tmp/grids_trace_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    fprintf(stderr, "  FAIL: Could not create temporary file\n");
+    return false;
+  }
+  close(fd);
+
+  SamplePlayer player;
+  player.Init(&bank, sample_rate);
+  PatternGeneratorWrapper pattern_gen;
+  pattern_gen.Init(&player, sample_rate, 133.0f);
+  pattern_gen.SetHumanize(0.5f);
+  pattern_gen.AssignSamplesToParts(bank.GetAllNotes(), 6, 32);
+
+  EventTrace* trace = new EventTrace();
+  if (!trace->Open(path, sample_rate)) {
+    fprintf(stderr, "  FAIL: Could not open trace\n");
+    delete trace;
+    unlink(path);
+    return false;
+  }
+  pattern_gen.SetTrace(trace);
+  RunEngine(&pattern_gen, &player, num_blocks, block_size);
+  trace->Close();
+  uint64_t written = trace->GetWrittenCount();
+  delete trace;
+
+  FILE* file = fopen(path, "rb");
+  TraceFileHeader header;
+  bool ok = file != nullptr && fread(&header, sizeof(header), 1, file) == 1 &&
+            memcmp(header.magic, kTraceMagic, sizeof(header.magic)) == 0 &&
+            header.record_size == sizeof(TraceRecord) &&
+            header.sample_rate == sample_rate;
+  if (!ok) {
+    fprintf(stderr, "  FAIL: Bad trace header\n");
+    if (file != nullptr) fclose(file);
+    unlink(path);
+    return false;
+  }
+
+  // Half a step at 24 PPQN: 1.5 pulses
+  int32_t max_jitter = static_cast<int32_t>(
+      0.5f * 1.5f * (sample_rate * 60.0f / (133.0f * 24.0f)));
+
+  uint64_t triggers = 0;
+  uint64_t last_frame = 0;
+  TraceRecord record;
+  while (ok && fread(&record, sizeof(record), 1, file) == 1) {
+    if (record.type != kTraceTrigger) {
+      fprintf(stderr, "  FAIL: Unexpected record type %u\n", record.type);
+      ok = false;
+    } else if (record.block_offset >= block_size ||
+               (record.frame - record.block_offset) % block_size != 0) {
+      fprintf(stderr, "  FAIL: Frame %llu offset %u not on a block grid\n",
+              (unsigned long long)record.frame, record.block_offset);
+      ok = false;
+    } else if (record.frame < last_frame) {
+      fprintf(stderr, "  FAIL: Frames out of order\n");
+      ok = false;
+    } else if (!(record.flags & kTraceHumanized) || record.jitter < -max_jitter ||
+               record.jitter > max_jitter) {
+      fprintf(stderr, "  FAIL: Jitter %d outside +-%d\n", record.jitter, max_jitter);
+      ok = false;
+    } else if (record.voice < 0 || record.voice >= static_cast<int16_t>(kMaxVoices)) {
+      fprintf(stderr, "  FAIL: Voice %d out of range\n", record.voice);
+      ok = false;
+    }
+    last_frame = record.frame;
+    triggers++;
+  }
+  fclose(file);
+  unlink(path);
+  if (!ok) {
+    return false;
+  }
+
+  if (triggers != player.GetTotalTriggersCount() || triggers != written) {
+    fprintf(stderr, "  FAIL: %llu records, %llu written, %llu triggers\n",
+            (unsigned long long)triggers, (unsigned long long)written,
+            (unsigned long long)player.GetTotalTriggersCount());
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %llu triggers traced with consistent timing\n",
+          (unsigned long long)triggers);
+  return true;
+}
+
+// Fastest time for one Record() call, with the writer thread draining
+static double RecordSeconds() {
+  const int batch = EventTrace::kRingCapacity / 2;
+  EventTrace trace;
+  if (!trace.Open("/dev/null", 48000)) {
+    return -1.0;
+  }
+  TraceRecord record;
+  memset(&record, 0, sizeof(record));
+  record.type = kTraceTrigger;
+
+  double best = 1e30;
+  for (int run = 0; run < 50; run++) {
+    double start = ThreadSeconds();
+    for (int i = 0; i < batch; i++) {
+      record.frame = i;
+      trace.Record(record);
+    }
+    double elapsed = ThreadSeconds() - start;
+    if (elapsed < best) best = elapsed;
+    usleep(20000);  // Let the writer empty the ring
+  }
+  trace.Close();
+  return best / batch;
+}
+
+// Test that tracing a dense pattern costs the audio thread under 1%
+bool TestTraceOverhead(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Trace Overhead\n");
+  fprintf(stderr, "====================\n");
+
+  const uint32_t sample_rate = 48000;
+  const uint32_t block_size = 128;
+  const uint32_t num_blocks = 30 * sample_rate / block_size;
+  const int num_runs = 7;
+  const double max_overhead = 0.01;
+
+  // Alternate the two variants (and which goes first) and keep each one's
+  // fastest run, which filters out preemption and frequency changes
+  double best[2] = {1e30, 1e30};
+  uint64_t triggers = 0;
+  for (int run = 0; run < num_runs; run++) {
+    for (int i = 0; i < 2; i++) {
+      int traced = i ^ (run & 1);
+      SamplePlayer player;
+      player.Init(&bank, sample_rate);
+      PatternGeneratorWrapper pattern_gen;
+      pattern_gen.Init(&player, sample_rate, 180.0f);
+      pattern_gen.AssignSamplesToParts(bank.GetAllNotes(), 12, 32);
+
+      EventTrace* trace = new EventTrace();
+      if (traced) {
+        if (!trace->Open("/dev/null", sample_rate)) {
+          fprintf(stderr, "  FAIL: Could not open trace\n");
+          delete trace;
+          return false;
+        }
+        pattern_gen.SetTrace(trace);
+      }
+
+      double start = ThreadSeconds();
+      RunEngine(&pattern_gen, &player, num_blocks, block_size);
+      double elapsed = ThreadSeconds() - start;
+      if (elapsed < best[traced]) best[traced] = elapsed;
+      triggers = player.GetTotalTriggersCount();
+      delete trace;
+    }
+  }
+  fprintf(stderr, "  Untraced: %.1f ms, traced: %.1f ms (%+.2f%%, best of %d)\n",
+          best[0] * 1000.0, best[1] * 1000.0,
+          100.0 * (best[1] - best[0]) / best[0], num_runs);
+
+  // End to end the difference drowns in scheduling noise on a shared
+  // machine, so the bound is checked on what tracing adds: one Record()
+  // per trigger
+  double record_seconds = RecordSeconds();
+  if (record_seconds < 0.0) {
+    fprintf(stderr, "  FAIL: Could not open trace\n");
+    return false;
+  }
+  double overhead = record_seconds * triggers / best[0];
+  fprintf(stderr, "  Record(): %.1f ns x %llu triggers = %.3f%% of the untraced loop\n",
+          record_seconds * 1e9, (unsigned long long)triggers, 100.0 * overhead);
+  if (overhead > max_overhead) {
+    fprintf(stderr, "  FAIL: Tracing overhead above %.0f%%\n", 100.0 * max_overhead);
+    return false;
+  }
+  fprintf(stderr, "  PASS: Tracing overhead below %.0f%%\n", 100.0 * max_overhead);
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+
+  fprintf(stderr, "Event Trace Test Suite\n");
+  fprintf(stderr, "======================\n");
+
+  SampleBank bank;
+  if (!bank.LoadDirectory("data", 48000)) {
+    fprintf(stderr, "Error: Failed to load samples from data/\n");
+    return 1;
+  }
+
+  int passed = 0;
+  int failed = 0;
+
+  if (TestRingOrdering()) passed++; else failed++;
+  if (TestTriggerInfo()) passed++; else failed++;
+  if (TestDroppedRecords()) passed++; else failed++;
+  if (TestTraceFile(bank)) passed++; else failed++;
+  if (TestTraceOverhead(bank)) passed++; else failed++;
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,417 @@
+// Golden-audio regression test
+// Renders fixed seeds, parameters and kits through AudioEngine and compares
+// each render against a stored reference in golden/: <case>.txt holds the
+// frame and trigger counts and a hash of the float output, <case>.wav the
+// audio itself as 16-bit PCM scaled to the case's peak.
+// 1. The exact trigger count must match
+// 2. A 64-bit hash of the float output must match (bit-identical), or
+// 3. Failing that, every sample of both channels must lie within one
+//    16-bit step of the reference (about 3e-5 of the case's scale)
+//
+// A render that passes only on (3) is reported as equivalent but not
+// bit-identical, with the largest sample difference. Float summation
+// order changes stay around 1e-6; a moved, missing or inverted hit
+// changes samples by orders of magnitude more. A failure reports the
+// first differing frame with its time and bar, and how many frames
+// differ.
+//
+// Run with --update to rewrite the references after an intended change
+// to the output. The references depend on glibc's rand() (sample
+// assignment) and libm (pan and LFO), so they are only valid on glibc
+// systems.
+
+#include <sndfile.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "audio_engine.h"
+#include "denormals.h"
+#include "offline_render.h"
+#include "pattern_generator_wrapper.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+
+using namespace grids_jack;
+
+static const uint32_t kSampleRate = 48000;
+
+static const char* kGoldenDir = "golden";
+
+// Kit the case is rendered with
+enum GoldenKit {
+  kKitSynthetic,  // Generated in code (see BuildSyntheticKit)
+  kKitData,       // The WAV files in data/
+};
+
+struct GoldenCase {
+  const char* name;
+  GoldenKit kit;
+  uint32_t seed;
+  float bpm;
+  uint8_t x;
+  uint8_t y;
+  uint8_t density;
+  size_t num_parts;
+  size_t num_steps;
+  bool lfo;
+  float humanize;
+  float spread;
+  float gain;
+  uint32_t block_size;
+  uint32_t bars;
+};
+
+static const GoldenCase kCases[] = {
+  {"synth_basic", kKitSynthetic, 1, 120.0f, 128, 128, 128, 4, 16, false, 0.0f, 0.0f, 1.0f, 256, 2},
+  {"synth_busy", kKitSynthetic, 7, 174.0f, 40, 200, 255, 8, 32, true, 0.5f, 1.0f, 0.5f, 64, 2},
+  {"synth_humanize", kKitSynthetic, 3, 90.0f, 220, 30, 160, 6, 32, false, 1.0f, 0.5f, 1.0f, 1024, 2},
+  {"data_kit", kKitData, 42, 120.0f, 128, 128, 128, 16, 32, true, 0.3f, 0.8f, 1.0f, 256, 4},
+  {"data_odd_block", kKitData, 5, 133.0f, 0, 255, 192, 5, 12, false, 0.0f, 1.0f, 0.8f, 100, 2},
+};
+
+// A render, or a reference read back from golden/
+struct GoldenRender {
+  uint32_t frames_per_bar;  // Not stored (for reporting)
+  uint64_t frames;
+  uint64_t triggers;
+  uint64_t hash;
+  float scale;              // Full scale of the 16-bit reference audio
+  std::vector<float> left;
+  std::vector<float> right;
+};
+
+// Eight drum-like sounds built from integer noise and multiplicative
+// decays, so the kit is identical on every IEEE-754 platform
+static void BuildSyntheticKit(SampleBank* bank) {
+  uint32_t rng = 2024;
+  for (uint8_t n = 0; n < 8; n++) {
+    uint32_t length = 2000 + 3000u * n;
+    float decay_rate = 1.0f - 4.0f / length;
+    uint32_t period = 20 + 13u * n;  // Square wave body for the low notes
+    std::vector<float> data(length);
+    float decay = 1.0f;
+    for (uint32_t i = 0; i < length; i++) {
+      rng = rng * 1664525u + 1013904223u;
+      float noise = static_cast<float>(rng >> 8) / 16777216.0f - 0.5f;
+      float body = (i / period) % 2 == 0 ? 0.5f : -0.5f;
+      float mix = n < 4 ? body * 0.7f + noise * 0.3f : noise;
+      data[i] = mix * decay;
+      decay *= decay_rate;
+    }
+    bank->AddSample(static_cast<uint8_t>(36 + n), data, "synthetic");
+  }
+}
+
+// FNV-1a over the bit patterns of the samples
+static uint64_t HashFloats(const float* data, size_t count, uint64_t hash) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < count * sizeof(float); i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Render a case through AudioEngine
+static void RenderCase(const GoldenCase& c, const SampleBank& bank, GoldenRender* out) {
+  SamplePlayer player;
+  PatternGeneratorWrapper pattern_gen;
+  player.Init(&bank, kSampleRate);
+  pattern_gen.Init(&player, kSampleRate, c.bpm);
+  pattern_gen.Seed(c.seed);
+  pattern_gen.SetLfoEnabled(c.lfo);
+  pattern_gen.SetHumanize(c.humanize);
+  pattern_gen.AssignSamplesToParts(bank.GetAllNotes(), c.num_parts, c.num_steps);
+  pattern_gen.SetSpread(c.spread);
+  pattern_gen.SetPatternX(c.x);
+  pattern_gen.SetPatternY(c.y);
+  for (int p = 0; p < DRUM_PART_COUNT; p++) {
+    pattern_gen.SetDensity(static_cast<DrumPart>(p), c.density);
+  }
+
+  AudioEngine engine;
+  engine.Init(&player, &pattern_gen, kSampleRate);
+  engine.SetOutputGain(c.gain);
+
+  uint64_t total_frames = FramesForBars(c.bars, pattern_gen.GetFramesPerPulse());
+  out->left.assign(total_frames, 0.0f);
+  out->right.assign(total_frames, 0.0f);
+
+  ScopedDenormalsOff denormals_off;
+  std::vector<float> block_left(c.block_size);
+  std::vector<float> block_right(c.block_size);
+  for (uint64_t done = 0; done < total_frames;) {
+    uint32_t frames = c.block_size;
+    if (total_frames - done < frames) {
+      frames = static_cast<uint32_t>(total_frames - done);
+    }
+    engine.Process(block_left.data(), block_right.data(), frames);
+    memcpy(&out->left[done], block_left.data(), frames * sizeof(float));
+    memcpy(&out->right[done], block_right.data(), frames * sizeof(float));
+    done += frames;
+  }
+
+  out->frames_per_bar = static_cast<uint32_t>(FramesForBars(1, pattern_gen.GetFramesPerPulse()));
+  out->frames = total_frames;
+  out->triggers = player.GetTotalTriggersCount();
+  out->hash = HashFloats(out->left.data(), out->left.size(), 14695981039346656037ull);
+  out->hash = HashFloats(out->right.data(), out->right.size(), out->hash);
+
+  // Smallest power of two above the peak, so hot mixes do not clip
+  float peak = 0.0f;
+  for (uint64_t i = 0; i < total_frames; i++) {
+    peak = fmaxf(peak, fmaxf(fabsf(out->left[i]), fabsf(out->right[i])));
+  }
+  out->scale = 1.0f;
+  while (out->scale <= peak) out->scale *= 2.0f;
+}
+
+static std::string ReferencePath(const GoldenCase& c, const char* extension) {
+  return std::string(kGoldenDir) + "/" + c.name + extension;
+}
+
+static void Put16(std::vector<uint8_t>* out, uint32_t v) {
+  out->push_back(v & 0xFF);
+  out->push_back((v >> 8) & 0xFF);
+}
+
+static void Put32(std::vector<uint8_t>* out, uint32_t v) {
+  Put16(out, v & 0xFFFF);
+  Put16(out, v >> 16);
+}
+
+// Write the render as 16-bit stereo PCM, full scale = render.scale
+static bool WriteReferenceAudio(const std::string& path, const GoldenRender& render) {
+  uint32_t data_size = static_cast<uint32_t>(render.frames * 4);
+  std::vector<uint8_t> out;
+  out.reserve(44 + data_size);
+  out.insert(out.end(), {'R', 'I', 'F', 'F'});
+  Put32(&out, 36 + data_size);
+  out.insert(out.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+  Put32(&out, 16);
+  Put16(&out, 1);  // PCM
+  Put16(&out, 2);
+  Put32(&out, kSampleRate);
+  Put32(&out, kSampleRate * 4);
+  Put16(&out, 4);
+  Put16(&out, 16);
+  out.insert(out.end(), {'d', 'a', 't', 'a'});
+  Put32(&out, data_size);
+  for (uint64_t i = 0; i < render.frames; i++) {
+    const float samples[2] = {render.left[i], render.right[i]};
+    for (int ch = 0; ch < 2; ch++) {
+      long v = lrintf(samples[ch] / render.scale * 32768.0f);
+      if (v > 32767) v = 32767;
+      if (v < -32768) v = -32768;
+      Put16(&out, static_cast<uint32_t>(v) & 0xFFFF);
+    }
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+  ok = (fclose(file) == 0) && ok;
+  return ok;
+}
+
+static bool WriteReference(const GoldenCase& c, const GoldenRender& render) {
+  std::string path = ReferencePath(c, ".txt");
+  FILE* file = fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "  FAIL: Could not create %s\n", path.c_str());
+    return false;
+  }
+  fprintf(file, "# grids-jack golden reference (regenerate with test_golden --update)\n");
+  fprintf(file, "# seed %u, %.1f BPM, block %u, %u bars\n", c.seed, c.bpm, c.block_size, c.bars);
+  fprintf(file, "frames %llu\n", (unsigned long long)render.frames);
+  fprintf(file, "triggers %llu\n", (unsigned long long)render.triggers);
+  fprintf(file, "hash %016llx\n", (unsigned long long)render.hash);
+  fprintf(file, "scale %g\n", render.scale);
+  bool ok = !ferror(file);
+  ok = (fclose(file) == 0) && ok;
+  if (!ok) {
+    fprintf(stderr, "  FAIL: Could not write %s\n", path.c_str());
+    return false;
+  }
+
+  std::string audio_path = ReferencePath(c, ".wav");
+  if (!WriteReferenceAudio(audio_path, render)) {
+    fprintf(stderr, "  FAIL: Could not write %s\n", audio_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+static bool ReadReference(const GoldenCase& c, GoldenRender* reference) {
+  std::string path = ReferencePath(c, ".txt");
+  FILE* file = fopen(path.c_str(), "r");
+  if (file == nullptr) {
+    fprintf(stderr, "  FAIL: Missing reference %s (run test_golden --update)\n", path.c_str());
+    return false;
+  }
+  char line[256];
+  unsigned long long frames = 0, triggers = 0, hash = 0;
+  float scale = 0.0f;
+  int header = 0;
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (line[0] == '#') continue;
+    if (sscanf(line, "frames %llu", &frames) == 1 ||
+        sscanf(line, "triggers %llu", &triggers) == 1 ||
+        sscanf(line, "hash %llx", &hash) == 1 ||
+        sscanf(line, "scale %g", &scale) == 1) {
+      header++;
+    }
+  }
+  fclose(file);
+  reference->frames = frames;
+  reference->triggers = triggers;
+  reference->hash = hash;
+  reference->scale = scale;
+  if (header != 4 || scale <= 0.0f) {
+    fprintf(stderr, "  FAIL: %s is malformed\n", path.c_str());
+    return false;
+  }
+
+  std::string audio_path = ReferencePath(c, ".wav");
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  SNDFILE* audio = sf_open(audio_path.c_str(), SFM_READ, &info);
+  if (audio == nullptr) {
+    fprintf(stderr, "  FAIL: Cannot open %s: %s (run test_golden --update)\n",
+            audio_path.c_str(), sf_strerror(nullptr));
+    return false;
+  }
+  bool ok = info.channels == 2 && static_cast<uint64_t>(info.frames) == frames;
+  std::vector<float> interleaved(frames * 2);
+  if (ok) {
+    ok = static_cast<uint64_t>(sf_readf_float(audio, interleaved.data(), frames)) == frames;
+  }
+  sf_close(audio);
+  if (!ok) {
+    fprintf(stderr, "  FAIL: %s does not hold %llu stereo frames\n", audio_path.c_str(), frames);
+    return false;
+  }
+  reference->left.resize(frames);
+  reference->right.resize(frames);
+  for (uint64_t i = 0; i < frames; i++) {
+    reference->left[i] = interleaved[2 * i] * scale;
+    reference->right[i] = interleaved[2 * i + 1] * scale;
+  }
+  return true;
+}
+
+// Compare a render with its reference and print the outcome
+static bool CompareCase(const GoldenCase& c, const GoldenRender& expected,
+                        const GoldenRender& actual) {
+  if (actual.frames != expected.frames) {
+    fprintf(stderr, "  FAIL: %s rendered %llu frames, reference has %llu\n", c.name,
+            (unsigned long long)actual.frames, (unsigned long long)expected.frames);
+    return false;
+  }
+  if (actual.hash == expected.hash && actual.triggers == expected.triggers) {
+    fprintf(stderr, "  PASS: %s bit-identical (%llu frames, %llu triggers)\n", c.name,
+            (unsigned long long)actual.frames, (unsigned long long)actual.triggers);
+    return true;
+  }
+
+  bool ok = true;
+  if (actual.triggers != expected.triggers) {
+    fprintf(stderr, "  FAIL: %s fired %llu triggers, reference has %llu\n", c.name,
+            (unsigned long long)actual.triggers, (unsigned long long)expected.triggers);
+    ok = false;
+  }
+
+  // One 16-bit step of the reference (rounding uses half of it)
+  float tolerance = expected.scale / 32768.0f;
+  uint64_t bad_frames = 0;
+  uint64_t first_bad = 0;
+  float max_delta = 0.0f;
+  for (uint64_t i = 0; i < actual.frames; i++) {
+    float delta = fmaxf(fabsf(actual.left[i] - expected.left[i]),
+                        fabsf(actual.right[i] - expected.right[i]));
+    max_delta = fmaxf(max_delta, delta);
+    if (delta > tolerance) {
+      if (bad_frames == 0) first_bad = i;
+      bad_frames++;
+    }
+  }
+
+  if (bad_frames > 0) {
+    fprintf(stderr, "    first difference at frame %llu (%.4f s, bar %.3f): "
+            "L %.6f R %.6f, reference L %.6f R %.6f\n",
+            (unsigned long long)first_bad, static_cast<double>(first_bad) / kSampleRate,
+            static_cast<double>(first_bad) / actual.frames_per_bar + 1.0,
+            actual.left[first_bad], actual.right[first_bad],
+            expected.left[first_bad], expected.right[first_bad]);
+    fprintf(stderr, "  FAIL: %s differs in %llu of %llu frames (max difference %g, "
+            "tolerance %g)\n", c.name, (unsigned long long)bad_frames,
+            (unsigned long long)actual.frames, max_delta, tolerance);
+    return false;
+  }
+  if (ok) {
+    fprintf(stderr, "  PASS: %s equivalent within %g but not bit-identical "
+            "(max sample difference %g)\n", c.name, tolerance, max_delta);
+  }
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  bool update = argc > 1 && strcmp(argv[1], "--update") == 0;
+
+  fprintf(stderr, "Golden Audio Test Suite\n");
+  fprintf(stderr, "=======================\n");
+
+  SampleBank synthetic_bank;
+  BuildSyntheticKit(&synthetic_bank);
+  SampleBank data_bank;
+  if (!data_bank.LoadDirectory("data", kSampleRate)) {
+    fprintf(stderr, "Error: Failed to load samples from data/\n");
+    return 1;
+  }
+
+  int passed = 0;
+  int failed = 0;
+
+  fprintf(stderr, "\n%s %zu cases against %s/\n", update ? "Updating" : "Comparing",
+          sizeof(kCases) / sizeof(kCases[0]), kGoldenDir);
+  for (const GoldenCase& c : kCases) {
+    const SampleBank& bank = c.kit == kKitData ? data_bank : synthetic_bank;
+    GoldenRender actual;
+    RenderCase(c, bank, &actual);
+
+    bool ok;
+    if (update) {
+      ok = WriteReference(c, actual);
+      if (ok) {
+        fprintf(stderr, "  Wrote %s (%llu frames, %llu triggers, hash %016llx)\n",
+                ReferencePath(c, ".wav").c_str(), (unsigned long long)actual.frames,
+                (unsigned long long)actual.triggers, (unsigned long long)actual.hash);
+      }
+    } else {
+      GoldenRender expected;
+      ok = ReadReference(c, &expected) && CompareCase(c, expected, actual);
+    }
+    if (ok) passed++; else failed++;
+  }
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,214 @@
+// Test for the silent-cycle fast path
+// This test verifies that:
+// 1. FramesUntilNextEvent() predicts exactly where triggers can fire
+// 2. Idle blocks advance the clock by exactly the block length
+// 3. The active voice count drops to zero in the block a voice ends
+// 4. Humanized triggers still pending when humanize is turned off fire
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "sample_bank.h"
+#include "sample_player.h"
+#include "pattern_generator_wrapper.h"
+
+using namespace grids_jack;
+
+// Drive the generator event by event and check no trigger ever fires
+// before the predicted frame
+static bool CheckPredictions(PatternGeneratorWrapper* pattern_gen,
+                             SamplePlayer* player, uint32_t sample_rate,
+                             const char* label) {
+  const uint64_t total_frames = 10ull * sample_rate;
+  uint64_t frame = 0;
+  uint32_t events = 0;
+  uint32_t idle_blocks = 0;
+
+  while (frame < total_frames) {
+    uint32_t next = pattern_gen->FramesUntilNextEvent();
+    if (next == 0) {
+      fprintf(stderr, "  FAIL (%s): Next event reported at frame 0\n", label);
+      return false;
+    }
+
+    // Everything up to the event must be idle
+    if (next > 1) {
+      uint32_t idle = (next - 1) / 2 + 1;
+      uint64_t before = player->GetTotalTriggersCount();
+      pattern_gen->Process(idle);
+      if (player->GetTotalTriggersCount() != before) {
+        fprintf(stderr, "  FAIL (%s): Trigger fired in an idle block at frame %llu\n",
+                label, (unsigned long long)frame);
+        return false;
+      }
+      if (pattern_gen->FramesUntilNextEvent() != next - idle) {
+        fprintf(stderr, "  FAIL (%s): Clock advanced wrongly: next %u -> %u after %u frames\n",
+                label, next, pattern_gen->FramesUntilNextEvent(), idle);
+        return false;
+      }
+      frame += idle;
+      idle_blocks++;
+      continue;
+    }
+
+    pattern_gen->Process(1);
+    frame++;
+    events++;
+
+    float left[1];
+    float right[1];
+    player->ProcessStereo(left, right, 1);
+  }
+
+  fprintf(stderr, "  %s: %u events, %u idle blocks, %llu triggers\n", label, events,
+          idle_blocks, (unsigned long long)player->GetTotalTriggersCount());
+
+  if (player->GetTotalTriggersCount() == 0) {
+    fprintf(stderr, "  FAIL (%s): No triggers in 10 seconds\n", label);
+    return false;
+  }
+  return true;
+}
+
+// Test event prediction with and without humanized triggers
+bool TestNextEventPrediction(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Next Event Prediction\n");
+  fprintf(stderr, "===========================\n");
+
+  const uint32_t sample_rate = 48000;
+  std::vector<uint8_t> notes = bank.GetAllNotes();
+
+  {
+    SamplePlayer player;
+    player.Init(&bank, sample_rate);
+    PatternGeneratorWrapper pattern_gen;
+    pattern_gen.Init(&player, sample_rate, 120.0f);
+    pattern_gen.AssignSamplesToParts(notes, 4, 32);
+    if (!CheckPredictions(&pattern_gen, &player, sample_rate, "grid")) {
+      return false;
+    }
+  }
+
+  {
+    SamplePlayer player;
+    player.Init(&bank, sample_rate);
+    PatternGeneratorWrapper pattern_gen;
+    pattern_gen.Init(&player, sample_rate, 97.0f);
+    pattern_gen.SetHumanize(0.7f);
+    pattern_gen.AssignSamplesToParts(notes, 6, 32);
+    if (!CheckPredictions(&pattern_gen, &player, sample_rate, "humanized")) {
+      return false;
+    }
+  }
+
+  fprintf(stderr, "  PASS: Triggers only fire where predicted\n");
+  return true;
+}
+
+// Test that turning humanize off does not strand queued triggers
+bool TestPendingAfterHumanizeOff(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Pending After Humanize Off\n");
+  fprintf(stderr, "===============================\n");
+
+  const uint32_t sample_rate = 48000;
+  SamplePlayer player;
+  player.Init(&bank, sample_rate);
+  PatternGeneratorWrapper pattern_gen;
+  pattern_gen.Init(&player, sample_rate, 120.0f);
+  pattern_gen.SetHumanize(1.0f);
+  pattern_gen.AssignSamplesToParts(bank.GetAllNotes(), 6, 32);
+
+  // Run until some triggers are queued, then turn humanize off
+  for (uint32_t i = 0; i < sample_rate && pattern_gen.GetPendingTriggerCount() == 0; i++) {
+    pattern_gen.Process(1);
+  }
+  uint32_t pending = pattern_gen.GetPendingTriggerCount();
+  if (pending == 0) {
+    fprintf(stderr, "  FAIL: No trigger was queued\n");
+    return false;
+  }
+  pattern_gen.SetHumanize(0.0f);
+
+  // Predictions must still account for the queued triggers
+  if (!CheckPredictions(&pattern_gen, &player, sample_rate, "humanize off")) {
+    return false;
+  }
+  if (pattern_gen.GetPendingTriggerCount() != 0) {
+    fprintf(stderr, "  FAIL: %u of %u queued triggers never fired\n",
+            pattern_gen.GetPendingTriggerCount(), pending);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %u queued triggers fired after humanize was turned off\n", pending);
+  return true;
+}
+
+// Test that a finished voice leaves the active count in its last block
+bool TestActiveCountAtVoiceEnd() {
+  fprintf(stderr, "\nTest: Active Count At Voice End\n");
+  fprintf(stderr, "===============================\n");
+
+  SampleBank bank;
+  bank.AddSample(60, std::vector<float>(300, 0.5f), "short");
+
+  SamplePlayer player;
+  player.Init(&bank, 48000);
+  player.Trigger(60, 1.0f);
+
+  float left[256];
+  float right[256];
+
+  player.ProcessStereo(left, right, 256);
+  if (player.GetActiveVoiceCount() != 1) {
+    fprintf(stderr, "  FAIL: Expected 1 active voice mid-sample, got %u\n",
+            player.GetActiveVoiceCount());
+    return false;
+  }
+
+  player.ProcessStereo(left, right, 256);
+  if (player.GetActiveVoiceCount() != 0) {
+    fprintf(stderr, "  FAIL: Expected 0 active voices after the sample ended, got %u\n",
+            player.GetActiveVoiceCount());
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: Voice count is exact at block end\n");
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+
+  fprintf(stderr, "Idle Fast Path Test Suite\n");
+  fprintf(stderr, "=========================\n");
+
+  SampleBank bank;
+  if (!bank.LoadDirectory("data", 48000)) {
+    fprintf(stderr, "Error: Failed to load samples from data/\n");
+    return 1;
+  }
+
+  int passed = 0;
+  int failed = 0;
+
+  if (TestNextEventPrediction(bank)) passed++; else failed++;
+  if (TestActiveCountAtVoiceEnd()) passed++; else failed++;
+  if (TestPendingAfterHumanizeOff(bank)) passed++; else failed++;
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
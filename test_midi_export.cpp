@@ -0,0 +1,403 @@
+// Test for Standard MIDI File export
+// This test verifies that:
+// 1. The pattern generator fires the same triggers with and without a
+//    sample player, so an audio-free export matches the render
+// 2. The exported file is a valid Type-1 SMF with one track per mapping
+//    whose note-on ticks are the trigger frames, humanize included
+// 3. Slow tempos fall back to a fixed division and keep the bar length
+// 4. Export speed in patterns per second (reported, not asserted)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "midi_export.h"
+#include "offline_render.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+#include "pattern_generator_wrapper.h"
+
+using namespace grids_jack;
+
+static const uint32_t kSampleRate = 48000;
+
+static double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Records every trigger in order
+class RecordingListener : public TriggerListener {
+ public:
+  struct Event {
+    uint64_t frame;
+    uint16_t mapping;
+    uint8_t note;
+    float velocity;
+  };
+
+  void OnTrigger(uint64_t frame, uint16_t mapping, uint8_t midi_note,
+                 float velocity) {
+    Event event = {frame, mapping, midi_note, velocity};
+    events.push_back(event);
+  }
+
+  std::vector<Event> events;
+};
+
+// One decoded note-on
+struct NoteOn {
+  uint64_t tick;
+  uint8_t channel;
+  uint8_t note;
+  uint8_t velocity;
+};
+
+// Decoded file: header fields and the note-ons of every track
+struct SmfFile {
+  uint16_t format;
+  uint16_t num_tracks;
+  uint16_t division;
+  uint32_t usec_per_quarter;
+  std::vector<uint64_t> end_ticks;
+  std::vector<std::vector<NoteOn> > notes;
+};
+
+static uint32_t ReadBE(const std::vector<uint8_t>& data, size_t pos, int bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < bytes; i++) value = (value << 8) | data[pos + i];
+  return value;
+}
+
+// Strict parser for what MidiExport writes (no running status)
+static bool ParseSmf(const char* path, SmfFile* out) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) return false;
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t got;
+  while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + got);
+  }
+  fclose(file);
+
+  if (data.size() < 14 || memcmp(data.data(), "MThd", 4) != 0 ||
+      ReadBE(data, 4, 4) != 6) {
+    return false;
+  }
+  out->format = static_cast<uint16_t>(ReadBE(data, 8, 2));
+  out->num_tracks = static_cast<uint16_t>(ReadBE(data, 10, 2));
+  out->division = static_cast<uint16_t>(ReadBE(data, 12, 2));
+  out->usec_per_quarter = 0;
+  out->end_ticks.clear();
+  out->notes.clear();
+
+  size_t pos = 14;
+  while (pos < data.size()) {
+    if (pos + 8 > data.size() || memcmp(&data[pos], "MTrk", 4) != 0) return false;
+    size_t end = pos + 8 + ReadBE(data, pos + 4, 4);
+    if (end > data.size()) return false;
+    pos += 8;
+
+    std::vector<NoteOn> notes;
+    uint64_t tick = 0;
+    bool ended = false;
+    while (pos < end && !ended) {
+      uint32_t delta = 0;
+      uint8_t byte;
+      do {
+        byte = data[pos++];
+        delta = (delta << 7) | (byte & 0x7F);
+      } while ((byte & 0x80) && pos < end);
+      tick += delta;
+
+      uint8_t status = data[pos++];
+      if (status == 0xFF) {
+        uint8_t type = data[pos++];
+        uint8_t length = data[pos++];
+        if (type == 0x51 && length == 3) out->usec_per_quarter = ReadBE(data, pos, 3);
+        if (type == 0x2F) ended = true;
+        pos += length;
+      } else if ((status & 0xF0) == 0x90 || (status & 0xF0) == 0x80) {
+        if ((status & 0xF0) == 0x90) {
+          NoteOn note = {tick, static_cast<uint8_t>(status & 0x0F), data[pos],
+                         data[pos + 1]};
+          notes.push_back(note);
+        }
+        pos += 2;
+      } else {
+        return false;
+      }
+    }
+    if (!ended || pos != end) return false;
+    out->end_ticks.push_back(tick);
+    out->notes.push_back(notes);
+  }
+  return out->notes.size() == out->num_tracks;
+}
+
+// Set up a generator the way main.cpp does for a seed
+static void SetupPattern(const std::vector<uint8_t>& notes, SamplePlayer* player,
+                         uint32_t seed, float bpm, PatternGeneratorWrapper* pattern_gen) {
+  pattern_gen->Init(player, kSampleRate, bpm);
+  pattern_gen->Seed(seed);
+  pattern_gen->SetLfoEnabled(true);
+  pattern_gen->SetHumanize(0.5f);
+  pattern_gen->AssignSamplesToParts(notes, 16, 32);
+}
+
+// Test that the trigger stream does not depend on the sample player
+bool TestAudioFreeMatchesAudio(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Audio-Free Triggers Match Audio\n");
+  fprintf(stderr, "=====================================\n");
+
+  const uint32_t block_size = 256;
+  RecordingListener with_audio;
+  uint64_t player_triggers = 0;
+  {
+    SamplePlayer player;
+    player.Init(&bank, kSampleRate);
+    PatternGeneratorWrapper pattern_gen;
+    SetupPattern(bank.GetAllNotes(), &player, 5, 120.0f, &pattern_gen);
+    pattern_gen.SetTriggerListener(&with_audio);
+    std::vector<float> left(block_size);
+    std::vector<float> right(block_size);
+    uint64_t total = FramesForBars(4, pattern_gen.GetFramesPerPulse());
+    for (uint64_t done = 0; done < total; done += block_size) {
+      pattern_gen.Process(block_size);
+      player.ProcessStereo(left.data(), right.data(), block_size);
+    }
+    player_triggers = player.GetTotalTriggersCount();
+  }
+
+  RecordingListener without_audio;
+  {
+    PatternGeneratorWrapper pattern_gen;
+    SetupPattern(bank.GetAllNotes(), nullptr, 5, 120.0f, &pattern_gen);
+    pattern_gen.SetTriggerListener(&without_audio);
+    uint64_t total = FramesForBars(4, pattern_gen.GetFramesPerPulse());
+    pattern_gen.Process(static_cast<uint32_t>(total));
+  }
+
+  if (with_audio.events.empty() || with_audio.events.size() != player_triggers) {
+    fprintf(stderr, "  FAIL: Listener saw %zu triggers, player %llu\n",
+            with_audio.events.size(), (unsigned long long)player_triggers);
+    return false;
+  }
+  if (without_audio.events.size() != with_audio.events.size()) {
+    fprintf(stderr, "  FAIL: %zu triggers without audio, %zu with\n",
+            without_audio.events.size(), with_audio.events.size());
+    return false;
+  }
+  for (size_t i = 0; i < with_audio.events.size(); i++) {
+    const RecordingListener::Event& a = with_audio.events[i];
+    const RecordingListener::Event& b = without_audio.events[i];
+    if (a.frame != b.frame || a.mapping != b.mapping || a.note != b.note ||
+        a.velocity != b.velocity) {
+      fprintf(stderr, "  FAIL: Trigger %zu differs (frame %llu vs %llu)\n", i,
+              (unsigned long long)a.frame, (unsigned long long)b.frame);
+      return false;
+    }
+  }
+
+  fprintf(stderr, "  PASS: %zu identical triggers with and without audio\n",
+          with_audio.events.size());
+  return true;
+}
+
+// Test the file layout and that note-ons land on the trigger frames
+bool TestFileMatchesTriggers(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: File Matches Triggers\n");
+  fprintf(stderr, "===========================\n");
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/test_midi_export_%d.mid", static_cast<int>(getpid()));
+
+  const uint32_t bars = 8;
+  uint64_t total = 0;
+
+  // Record the triggers of a seed, then export the same seed
+  RecordingListener recorded;
+  {
+    PatternGeneratorWrapper reference;
+    SetupPattern(bank.GetAllNotes(), nullptr, 11, 120.0f, &reference);
+    total = FramesForBars(bars, reference.GetFramesPerPulse());
+    reference.SetTriggerListener(&recorded);
+    reference.Process(static_cast<uint32_t>(total));
+  }
+  PatternGeneratorWrapper pattern_gen;
+  SetupPattern(bank.GetAllNotes(), nullptr, 11, 120.0f, &pattern_gen);
+  const std::vector<SampleMapping> mappings = pattern_gen.GetSampleMappings();
+
+  size_t num_notes = 0;
+  bool ok = ExportMidi(&pattern_gen, kSampleRate, total, path, &num_notes);
+  SmfFile smf;
+  bool parsed = ok && ParseSmf(path, &smf);
+  unlink(path);
+  if (!parsed) {
+    fprintf(stderr, "  FAIL: Export or parse failed\n");
+    return false;
+  }
+
+  uint32_t frames_per_quarter = 24 * pattern_gen.GetFramesPerPulse();
+  if (smf.format != 1 || smf.num_tracks != mappings.size() + 1 ||
+      smf.division != frames_per_quarter || smf.usec_per_quarter != 500000) {
+    fprintf(stderr, "  FAIL: Header format %u, %u tracks, division %u, tempo %u\n",
+            smf.format, smf.num_tracks, smf.division, smf.usec_per_quarter);
+    return false;
+  }
+  if (num_notes != recorded.events.size()) {
+    fprintf(stderr, "  FAIL: Exported %zu notes, expected %zu\n", num_notes,
+            recorded.events.size());
+    return false;
+  }
+
+  // Expected note-ons per track; hits on the same frame are one note
+  size_t checked = 0;
+  size_t off_grid = 0;
+  for (size_t m = 0; m < mappings.size(); m++) {
+    std::vector<uint64_t> expected;
+    for (size_t i = 0; i < recorded.events.size(); i++) {
+      if (recorded.events[i].mapping != m) continue;
+      if (expected.empty() || expected.back() != recorded.events[i].frame) {
+        expected.push_back(recorded.events[i].frame);
+      }
+    }
+    const std::vector<NoteOn>& notes = smf.notes[m + 1];
+    if (notes.size() != expected.size()) {
+      fprintf(stderr, "  FAIL: Track %zu has %zu notes, expected %zu\n", m + 1,
+              notes.size(), expected.size());
+      return false;
+    }
+    for (size_t i = 0; i < notes.size(); i++) {
+      if (notes[i].tick != expected[i] || notes[i].note != mappings[m].midi_note ||
+          notes[i].channel != MidiExport::kChannel || notes[i].velocity == 0) {
+        fprintf(stderr, "  FAIL: Track %zu note %zu at tick %llu, expected %llu\n",
+                m + 1, i, (unsigned long long)notes[i].tick,
+                (unsigned long long)expected[i]);
+        return false;
+      }
+      if (notes[i].tick % pattern_gen.GetFramesPerPulse() != 0) off_grid++;
+      checked++;
+    }
+    if (smf.end_ticks[m + 1] < total) {
+      fprintf(stderr, "  FAIL: Track %zu ends at %llu\n", m + 1,
+              (unsigned long long)smf.end_ticks[m + 1]);
+      return false;
+    }
+  }
+  if (off_grid == 0) {
+    fprintf(stderr, "  FAIL: Humanize moved no note off the clock grid\n");
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %zu tracks, %zu notes on their trigger frames (%zu humanized)\n",
+          mappings.size(), checked, off_grid);
+  return true;
+}
+
+// Test that tempos too slow for a frame-based division still export
+bool TestSlowTempoFallback(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Slow Tempo Fallback\n");
+  fprintf(stderr, "=========================\n");
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/test_midi_export_slow_%d.mid",
+           static_cast<int>(getpid()));
+
+  const uint32_t bars = 2;
+  PatternGeneratorWrapper pattern_gen;
+  SetupPattern(bank.GetAllNotes(), nullptr, 3, 40.0f, &pattern_gen);
+  uint64_t total = FramesForBars(bars, pattern_gen.GetFramesPerPulse());
+
+  SmfFile smf;
+  bool ok = ExportMidi(&pattern_gen, kSampleRate, total, path) && ParseSmf(path, &smf);
+  unlink(path);
+  if (!ok) {
+    fprintf(stderr, "  FAIL: Export or parse failed\n");
+    return false;
+  }
+
+  uint64_t bar_ticks = 4ull * MidiExport::kFallbackTicksPerQuarter;
+  if (smf.division != MidiExport::kFallbackTicksPerQuarter ||
+      smf.end_ticks[0] != bars * bar_ticks) {
+    fprintf(stderr, "  FAIL: Division %u, length %llu ticks\n", smf.division,
+            (unsigned long long)smf.end_ticks[0]);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: Division %u, %u bars = %llu ticks\n", smf.division, bars,
+          (unsigned long long)smf.end_ticks[0]);
+  return true;
+}
+
+// Report how many 8-bar patterns are exported per second
+bool TestExportSpeed(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Export Speed\n");
+  fprintf(stderr, "==================\n");
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/test_midi_export_speed_%d.mid",
+           static_cast<int>(getpid()));
+
+  const int num_patterns = 200;
+  double start = NowSeconds();
+  for (int i = 0; i < num_patterns; i++) {
+    PatternGeneratorWrapper pattern_gen;
+    SetupPattern(bank.GetAllNotes(), nullptr, static_cast<uint32_t>(i), 120.0f,
+                 &pattern_gen);
+    uint64_t total = FramesForBars(8, pattern_gen.GetFramesPerPulse());
+    if (!ExportMidi(&pattern_gen, kSampleRate, total, path)) {
+      unlink(path);
+      fprintf(stderr, "  FAIL: Export %d failed\n", i);
+      return false;
+    }
+  }
+  double elapsed = NowSeconds() - start;
+  unlink(path);
+
+  fprintf(stderr, "  PASS: %d patterns of 8 bars in %.3f s (%.0f per second)\n",
+          num_patterns, elapsed, elapsed > 0.0 ? num_patterns / elapsed : 0.0);
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+
+  fprintf(stderr, "MIDI Export Test Suite\n");
+  fprintf(stderr, "======================\n");
+
+  SampleBank bank;
+  if (!bank.LoadDirectory("data", kSampleRate)) {
+    fprintf(stderr, "Error: Failed to load samples from data/\n");
+    return 1;
+  }
+
+  int passed = 0;
+  int failed = 0;
+
+  if (TestAudioFreeMatchesAudio(bank)) passed++; else failed++;
+  if (TestFileMatchesTriggers(bank)) passed++; else failed++;
+  if (TestSlowTempoFallback(bank)) passed++; else failed++;
+  if (TestExportSpeed(bank)) passed++; else failed++;
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,487 @@
+// Test for the offline render path
+// This test verifies that:
+// 1. AudioEngine output matches the pattern generator and sample player
+//    driven by hand, block for block
+// 2. Renders with the same seed and block size are bit-identical
+// 3. Different seeds give different renders
+// 4. Stem rendering leaves the mix untouched and the stems sum to it
+// 5. RenderToWav writes the mix and every stem file in one pass
+// 6. RenderToFd streams the same audio as f32 and s16 PCM and stops
+//    cleanly when the reader closes the pipe
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sndfile.h>
+#include <signal.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_engine.h"
+#include "denormals.h"
+#include "offline_render.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+#include "pattern_generator_wrapper.h"
+
+using namespace grids_jack;
+
+static const uint32_t kSampleRate = 48000;
+
+// Set up the player and generator the way main.cpp does for a seed
+static void SetupEngine(const SampleBank& bank, uint32_t seed,
+                        SamplePlayer* player, PatternGeneratorWrapper* pattern_gen) {
+  player->Init(&bank, kSampleRate);
+  pattern_gen->Init(player, kSampleRate, 120.0f);
+  pattern_gen->Seed(seed);
+  pattern_gen->SetLfoEnabled(true);
+  pattern_gen->SetHumanize(0.5f);
+  pattern_gen->AssignSamplesToParts(bank.GetAllNotes(), 16, 32);
+  pattern_gen->SetSpread(1.0f);
+}
+
+// Render a number of bars through AudioEngine, interleaved like the WAV
+static void RenderBars(const SampleBank& bank, uint32_t seed, uint32_t bars,
+                       uint32_t block_size, std::vector<float>* out) {
+  SamplePlayer player;
+  PatternGeneratorWrapper pattern_gen;
+  SetupEngine(bank, seed, &player, &pattern_gen);
+
+  AudioEngine engine;
+  engine.Init(&player, &pattern_gen, kSampleRate);
+
+  uint64_t total_frames =
+      static_cast<uint64_t>(bars) * 96 * pattern_gen.GetFramesPerPulse();
+  std::vector<float> left(block_size);
+  std::vector<float> right(block_size);
+  out->assign(2 * total_frames, 0.0f);
+
+  ScopedDenormalsOff denormals_off;
+  for (uint64_t done = 0; done < total_frames;) {
+    uint32_t frames = block_size;
+    if (total_frames - done < frames) {
+      frames = static_cast<uint32_t>(total_frames - done);
+    }
+    engine.Process(left.data(), right.data(), frames);
+    for (uint32_t i = 0; i < frames; i++) {
+      (*out)[2 * (done + i)] = left[i];
+      (*out)[2 * (done + i) + 1] = right[i];
+    }
+    done += frames;
+  }
+}
+
+// Test that the engine adds nothing to the hand-driven signal path
+bool TestEngineMatchesManualLoop(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Engine Matches Manual Loop\n");
+  fprintf(stderr, "================================\n");
+
+  const uint32_t block_size = 256;
+  const uint32_t bars = 4;
+
+  std::vector<float> rendered;
+  RenderBars(bank, 1234, bars, block_size, &rendered);
+
+  SamplePlayer player;
+  PatternGeneratorWrapper pattern_gen;
+  SetupEngine(bank, 1234, &player, &pattern_gen);
+
+  uint64_t total_frames =
+      static_cast<uint64_t>(bars) * 96 * pattern_gen.GetFramesPerPulse();
+  std::vector<float> left(block_size);
+  std::vector<float> right(block_size);
+
+  ScopedDenormalsOff denormals_off;
+  for (uint64_t done = 0; done < total_frames;) {
+    uint32_t frames = block_size;
+    if (total_frames - done < frames) {
+      frames = static_cast<uint32_t>(total_frames - done);
+    }
+    pattern_gen.Process(frames);
+    player.ProcessStereo(left.data(), right.data(), frames);
+    for (uint32_t i = 0; i < frames; i++) {
+      if (left[i] != rendered[2 * (done + i)] ||
+          right[i] != rendered[2 * (done + i) + 1]) {
+        fprintf(stderr, "  FAIL: Outputs differ at frame %llu\n",
+                (unsigned long long)(done + i));
+        return false;
+      }
+    }
+    done += frames;
+  }
+
+  if (player.GetTotalTriggersCount() == 0) {
+    fprintf(stderr, "  FAIL: No triggers in %u bars\n", bars);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %llu frames identical, %llu triggers\n",
+          (unsigned long long)total_frames,
+          (unsigned long long)player.GetTotalTriggersCount());
+  return true;
+}
+
+// Test that a seed and block size fully determine the render
+bool TestRenderIsDeterministic(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Render Is Deterministic\n");
+  fprintf(stderr, "=============================\n");
+
+  const uint32_t block_sizes[] = {64, 256, 1024};
+  for (size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); i++) {
+    std::vector<float> first;
+    std::vector<float> second;
+    RenderBars(bank, 42, 8, block_sizes[i], &first);
+    RenderBars(bank, 42, 8, block_sizes[i], &second);
+
+    if (first.size() != second.size() ||
+        memcmp(first.data(), second.data(), first.size() * sizeof(float)) != 0) {
+      fprintf(stderr, "  FAIL: Two renders at block size %u differ\n", block_sizes[i]);
+      return false;
+    }
+  }
+
+  std::vector<float> seed_a;
+  std::vector<float> seed_b;
+  RenderBars(bank, 42, 8, 256, &seed_a);
+  RenderBars(bank, 43, 8, 256, &seed_b);
+  if (memcmp(seed_a.data(), seed_b.data(), seed_a.size() * sizeof(float)) == 0) {
+    fprintf(stderr, "  FAIL: Seeds 42 and 43 rendered the same audio\n");
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: Same seed is bit-identical, different seed differs\n");
+  return true;
+}
+
+// Read a stereo float WAV file back, interleaved
+static bool ReadWav(const std::string& path, std::vector<float>* out) {
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  SNDFILE* file = sf_open(path.c_str(), SFM_READ, &info);
+  if (file == nullptr) {
+    return false;
+  }
+  out->assign(2 * info.frames, 0.0f);
+  sf_count_t read = sf_readf_float(file, out->data(), info.frames);
+  sf_close(file);
+  return info.channels == 2 && read == info.frames;
+}
+
+// Largest difference between a signal and the sum of others (interleaved)
+static float MaxSumError(const std::vector<float>& mix,
+                         const std::vector<std::vector<float> >& parts) {
+  float max_error = 0.0f;
+  for (size_t i = 0; i < mix.size(); i++) {
+    float sum = 0.0f;
+    for (size_t p = 0; p < parts.size(); p++) {
+      sum += parts[p][i];
+    }
+    max_error = fmaxf(max_error, fabsf(sum - mix[i]));
+  }
+  return max_error;
+}
+
+// Test that ProcessStems renders the same mix plus stems that sum to it
+bool TestStemsSumToMix(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Stems Sum To Mix\n");
+  fprintf(stderr, "======================\n");
+
+  const uint32_t block_size = 256;
+  const uint32_t bars = 4;
+
+  std::vector<float> rendered;
+  RenderBars(bank, 77, bars, block_size, &rendered);
+
+  SamplePlayer player;
+  PatternGeneratorWrapper pattern_gen;
+  SetupEngine(bank, 77, &player, &pattern_gen);
+  AudioEngine engine;
+  engine.Init(&player, &pattern_gen, kSampleRate);
+  engine.SetOutputGain(1.0f);
+
+  size_t num_buses = pattern_gen.GetSampleMappings().size();
+  std::vector<std::vector<float> > bus_memory(2 * num_buses,
+                                              std::vector<float>(block_size));
+  std::vector<float*> bus_outputs(2 * num_buses);
+  for (size_t b = 0; b < bus_outputs.size(); b++) {
+    bus_outputs[b] = bus_memory[b].data();
+  }
+
+  uint64_t total_frames =
+      static_cast<uint64_t>(bars) * 96 * pattern_gen.GetFramesPerPulse();
+  std::vector<float> left(block_size);
+  std::vector<float> right(block_size);
+  std::vector<bool> bus_used(num_buses, false);
+  float max_error = 0.0f;
+
+  ScopedDenormalsOff denormals_off;
+  for (uint64_t done = 0; done < total_frames;) {
+    uint32_t frames = block_size;
+    if (total_frames - done < frames) {
+      frames = static_cast<uint32_t>(total_frames - done);
+    }
+    engine.ProcessStems(left.data(), right.data(), bus_outputs.data(), num_buses,
+                        frames);
+    for (uint32_t i = 0; i < frames; i++) {
+      if (left[i] != rendered[2 * (done + i)] ||
+          right[i] != rendered[2 * (done + i) + 1]) {
+        fprintf(stderr, "  FAIL: Mix differs from Process() at frame %llu\n",
+                (unsigned long long)(done + i));
+        return false;
+      }
+      float sum_left = 0.0f;
+      float sum_right = 0.0f;
+      for (size_t b = 0; b < num_buses; b++) {
+        sum_left += bus_outputs[2 * b][i];
+        sum_right += bus_outputs[2 * b + 1][i];
+        if (bus_outputs[2 * b][i] != 0.0f || bus_outputs[2 * b + 1][i] != 0.0f) {
+          bus_used[b] = true;
+        }
+      }
+      max_error = fmaxf(max_error, fabsf(sum_left - left[i]));
+      max_error = fmaxf(max_error, fabsf(sum_right - right[i]));
+    }
+    done += frames;
+  }
+
+  // Voices are summed in a different order per bus, so allow rounding
+  if (max_error > 1e-5f) {
+    fprintf(stderr, "  FAIL: Stems differ from the mix by up to %g\n", max_error);
+    return false;
+  }
+
+  size_t used = 0;
+  for (size_t b = 0; b < num_buses; b++) {
+    if (bus_used[b]) used++;
+  }
+  if (used < 2) {
+    fprintf(stderr, "  FAIL: Only %zu of %zu stems have audio\n", used, num_buses);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: Mix bit-identical, %zu/%zu stems sum to it (error %g)\n",
+          used, num_buses, max_error);
+  return true;
+}
+
+// Test that one RenderToWav pass writes the mix and all stems
+bool TestStemFiles(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Stem Files\n");
+  fprintf(stderr, "================\n");
+
+  const uint32_t block_size = 256;
+  const uint32_t bars = 4;
+
+  std::vector<float> rendered;
+  RenderBars(bank, 99, bars, block_size, &rendered);
+
+  SamplePlayer player;
+  PatternGeneratorWrapper pattern_gen;
+  SetupEngine(bank, 99, &player, &pattern_gen);
+  AudioEngine engine;
+  engine.Init(&player, &pattern_gen, kSampleRate);
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/test_offline_render_%d.wav",
+           static_cast<int>(getpid()));
+  const std::vector<SampleMapping>& mappings = pattern_gen.GetSampleMappings();
+  uint64_t total_frames = FramesForBars(bars, pattern_gen.GetFramesPerPulse());
+
+  RenderResult result;
+  bool ok = RenderToWav(&engine, kSampleRate, block_size, total_frames, path,
+                        &result, nullptr, &mappings);
+
+  std::vector<std::string> part_paths;
+  part_paths.push_back(StemPath(path, "bd"));
+  part_paths.push_back(StemPath(path, "sd"));
+  part_paths.push_back(StemPath(path, "hh"));
+  std::vector<std::string> mapping_paths;
+  for (size_t m = 0; m < mappings.size(); m++) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "m%zu_note%u", m,
+             static_cast<unsigned>(mappings[m].midi_note));
+    mapping_paths.push_back(StemPath(path, suffix));
+  }
+
+  std::vector<float> mix;
+  std::vector<std::vector<float> > parts(part_paths.size());
+  std::vector<std::vector<float> > stems(mapping_paths.size());
+  bool read_ok = ReadWav(path, &mix);
+  for (size_t i = 0; i < part_paths.size(); i++) {
+    read_ok = ReadWav(part_paths[i], &parts[i]) && read_ok;
+  }
+  for (size_t i = 0; i < mapping_paths.size(); i++) {
+    read_ok = ReadWav(mapping_paths[i], &stems[i]) && read_ok;
+  }
+
+  unlink(path);
+  for (size_t i = 0; i < part_paths.size(); i++) unlink(part_paths[i].c_str());
+  for (size_t i = 0; i < mapping_paths.size(); i++) unlink(mapping_paths[i].c_str());
+
+  if (!ok || !read_ok) {
+    fprintf(stderr, "  FAIL: Render or read-back failed\n");
+    return false;
+  }
+  if (result.files != 1 + part_paths.size() + mapping_paths.size()) {
+    fprintf(stderr, "  FAIL: Wrote %u files, expected %zu\n", result.files,
+            1 + part_paths.size() + mapping_paths.size());
+    return false;
+  }
+  if (mix.size() != rendered.size() ||
+      memcmp(mix.data(), rendered.data(), mix.size() * sizeof(float)) != 0) {
+    fprintf(stderr, "  FAIL: Mix file differs from a render without stems\n");
+    return false;
+  }
+  for (size_t i = 0; i < stems.size(); i++) {
+    if (stems[i].size() != mix.size()) {
+      fprintf(stderr, "  FAIL: %s has the wrong length\n", mapping_paths[i].c_str());
+      return false;
+    }
+  }
+  float part_error = MaxSumError(mix, parts);
+  float stem_error = MaxSumError(mix, stems);
+  if (part_error > 1e-5f || stem_error > 1e-5f) {
+    fprintf(stderr, "  FAIL: Stems differ from the mix (parts %g, mappings %g)\n",
+            part_error, stem_error);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: %u files, mix identical, part and mapping stems sum to it\n",
+          result.files);
+  return true;
+}
+
+// Render into a pipe and collect everything a reader thread receives
+static bool StreamBars(const SampleBank& bank, uint32_t seed, uint32_t bars,
+                       PcmFormat format, std::vector<uint8_t>* out) {
+  SamplePlayer player;
+  PatternGeneratorWrapper pattern_gen;
+  SetupEngine(bank, seed, &player, &pattern_gen);
+  AudioEngine engine;
+  engine.Init(&player, &pattern_gen, kSampleRate);
+
+  int fds[2];
+  if (pipe(fds) != 0) return false;
+  out->clear();
+  std::thread reader([fds, out]() {
+    uint8_t buffer[65536];
+    ssize_t got;
+    while ((got = read(fds[0], buffer, sizeof(buffer))) > 0) {
+      out->insert(out->end(), buffer, buffer + got);
+    }
+  });
+
+  RenderResult result;
+  bool ok = RenderToFd(&engine, kSampleRate, 256,
+                       FramesForBars(bars, pattern_gen.GetFramesPerPulse()), fds[1],
+                       format, false, &result);
+  close(fds[1]);
+  reader.join();
+  close(fds[0]);
+  return ok;
+}
+
+// Test raw PCM streaming against the block-by-block render
+bool TestStreamToPipe(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Stream To Pipe\n");
+  fprintf(stderr, "====================\n");
+
+  const uint32_t bars = 4;
+  std::vector<float> rendered;
+  RenderBars(bank, 55, bars, 256, &rendered);
+
+  std::vector<uint8_t> f32;
+  std::vector<uint8_t> s16;
+  if (!StreamBars(bank, 55, bars, kPcmFloat32, &f32) ||
+      !StreamBars(bank, 55, bars, kPcmS16, &s16)) {
+    fprintf(stderr, "  FAIL: Streaming failed\n");
+    return false;
+  }
+
+  if (f32.size() != rendered.size() * sizeof(float) ||
+      memcmp(f32.data(), rendered.data(), f32.size()) != 0) {
+    fprintf(stderr, "  FAIL: f32 stream (%zu bytes) differs from the render\n", f32.size());
+    return false;
+  }
+  if (s16.size() != rendered.size() * sizeof(int16_t)) {
+    fprintf(stderr, "  FAIL: s16 stream has %zu bytes\n", s16.size());
+    return false;
+  }
+  const int16_t* samples = reinterpret_cast<const int16_t*>(s16.data());
+  for (size_t i = 0; i < rendered.size(); i++) {
+    float expected = fmaxf(-32768.0f, fminf(32767.0f, rendered[i] * 32767.0f));
+    if (fabsf(samples[i] - expected) > 0.5f) {
+      fprintf(stderr, "  FAIL: s16 sample %zu is %d, expected %.1f\n", i, samples[i],
+              expected);
+      return false;
+    }
+  }
+
+  // A reader that goes away ends an endless stream without an error
+  SamplePlayer player;
+  PatternGeneratorWrapper pattern_gen;
+  SetupEngine(bank, 55, &player, &pattern_gen);
+  AudioEngine engine;
+  engine.Init(&player, &pattern_gen, kSampleRate);
+  int fds[2];
+  if (pipe(fds) != 0) {
+    fprintf(stderr, "  FAIL: pipe() failed\n");
+    return false;
+  }
+  close(fds[0]);
+  RenderResult result;
+  bool ok = RenderToFd(&engine, kSampleRate, 256, 0, fds[1], kPcmFloat32, false, &result);
+  close(fds[1]);
+  if (!ok || result.frames == 0) {
+    fprintf(stderr, "  FAIL: Closed pipe returned %d after %llu frames\n", ok,
+            (unsigned long long)result.frames);
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: f32 bit-identical, s16 within rounding, closed pipe ends the stream\n");
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+
+  fprintf(stderr, "Offline Render Test Suite\n");
+  fprintf(stderr, "=========================\n");
+
+  // Streaming into a closed pipe must fail with EPIPE, not kill the test
+  signal(SIGPIPE, SIG_IGN);
+
+  SampleBank bank;
+  if (!bank.LoadDirectory("data", kSampleRate)) {
+    fprintf(stderr, "Error: Failed to load samples from data/\n");
+    return 1;
+  }
+
+  int passed = 0;
+  int failed = 0;
+
+  if (TestEngineMatchesManualLoop(bank)) passed++; else failed++;
+  if (TestRenderIsDeterministic(bank)) passed++; else failed++;
+  if (TestStemsSumToMix(bank)) passed++; else failed++;
+  if (TestStemFiles(bank)) passed++; else failed++;
+  if (TestStreamToPipe(bank)) passed++; else failed++;
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,235 @@
+// Test for multithreaded voice rendering
+// This test verifies that:
+// 1. The worker pool runs every slot exactly once per cycle
+// 2. Parallel ProcessStereo matches serial rendering for 1..N threads
+// 3. Render time scales with the number of threads (reported, not asserted)
+
+#include <stdio.h>
+#include <time.h>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "render_pool.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+
+using namespace grids_jack;
+
+static double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct SlotCounter {
+  std::atomic<uint32_t> hits[kMaxRenderThreads];
+};
+
+static void CountSlot(void* context, size_t worker_index) {
+  SlotCounter* counter = static_cast<SlotCounter*>(context);
+  counter->hits[worker_index].fetch_add(1);
+}
+
+// Test that each slot runs once per Run()
+bool TestPoolRunsEverySlot() {
+  fprintf(stderr, "\nTest: Pool Runs Every Slot\n");
+  fprintf(stderr, "==========================\n");
+
+  const size_t num_threads = 4;
+  const uint32_t cycles = 2000;
+
+  RenderWorkerPool pool;
+  if (!pool.Start(num_threads, 0)) {
+    fprintf(stderr, "  FAIL: Could not start pool\n");
+    return false;
+  }
+
+  SlotCounter counter;
+  for (size_t i = 0; i < kMaxRenderThreads; i++) {
+    counter.hits[i].store(0);
+  }
+
+  for (uint32_t c = 0; c < cycles; c++) {
+    pool.Run(CountSlot, &counter);
+  }
+  pool.Stop();
+
+  for (size_t i = 0; i < num_threads; i++) {
+    if (counter.hits[i].load() != cycles) {
+      fprintf(stderr, "  FAIL: Slot %zu ran %u times, expected %u\n",
+              i, counter.hits[i].load(), cycles);
+      return false;
+    }
+  }
+
+  fprintf(stderr, "  PASS: %zu slots each ran %u times\n", num_threads, cycles);
+  return true;
+}
+
+// Trigger a full voice pool with a spread of pans and velocities
+// Callers disable coalescing, or repeat hits would merge into one voice
+// per note and stay below the parallel threshold. Returns false if the
+// pool did not fill
+static bool TriggerFullPool(SamplePlayer* player, const std::vector<uint8_t>& notes) {
+  for (size_t i = 0; i < kMaxVoices; i++) {
+    float pan = -1.0f + 2.0f * static_cast<float>(i % 17) / 16.0f;
+    float velocity = 0.1f + 0.9f * static_cast<float>(i % 7) / 6.0f;
+    player->Trigger(notes[i % notes.size()], velocity, pan);
+  }
+  if (player->GetActiveVoiceCount() != kMaxVoices) {
+    fprintf(stderr, "  FAIL: Expected a full pool of %zu voices, got %u\n", kMaxVoices,
+            player->GetActiveVoiceCount());
+    return false;
+  }
+  return true;
+}
+
+// Test parallel output against the serial path and report scaling
+bool TestParallelMatchesSerial(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Parallel Rendering Matches Serial\n");
+  fprintf(stderr, "=======================================\n");
+
+  std::vector<uint8_t> notes = bank.GetAllNotes();
+  const uint32_t sample_rate = 48000;
+  const uint32_t buffer_size = 256;
+  const uint32_t num_blocks = 200;
+
+  size_t max_threads = std::thread::hardware_concurrency();
+  if (max_threads < 4) max_threads = 4;
+  if (max_threads > kMaxRenderThreads) max_threads = kMaxRenderThreads;
+
+  // Reference render on a single thread
+  std::vector<float> ref_left(buffer_size * num_blocks);
+  std::vector<float> ref_right(buffer_size * num_blocks);
+  double serial_time = 0.0;
+  {
+    SamplePlayer player;
+    player.Init(&bank, sample_rate);
+    player.SetCoalescing(false);
+    if (!TriggerFullPool(&player, notes)) {
+      return false;
+    }
+    double start = NowSeconds();
+    for (uint32_t b = 0; b < num_blocks; b++) {
+      player.ProcessStereo(&ref_left[b * buffer_size], &ref_right[b * buffer_size],
+                           buffer_size);
+    }
+    serial_time = NowSeconds() - start;
+  }
+
+  fprintf(stderr, "  threads   time(ms)   speedup   max error\n");
+  fprintf(stderr, "  %7d   %8.2f   %7.2f   %9s\n", 1, serial_time * 1000.0, 1.0, "-");
+
+  for (size_t threads = 2; threads <= max_threads; threads++) {
+    SamplePlayer player;
+    player.Init(&bank, sample_rate);
+    if (!player.SetRenderThreads(threads, buffer_size)) {
+      fprintf(stderr, "  FAIL: Could not start %zu render threads\n", threads);
+      return false;
+    }
+    player.SetCoalescing(false);
+    if (!TriggerFullPool(&player, notes)) {
+      return false;
+    }
+
+    float left[buffer_size];
+    float right[buffer_size];
+    float max_error = 0.0f;
+    double elapsed = 0.0;
+
+    for (uint32_t b = 0; b < num_blocks; b++) {
+      double start = NowSeconds();
+      player.ProcessStereo(left, right, buffer_size);
+      elapsed += NowSeconds() - start;
+
+      for (uint32_t i = 0; i < buffer_size; i++) {
+        float el = fabsf(left[i] - ref_left[b * buffer_size + i]);
+        float er = fabsf(right[i] - ref_right[b * buffer_size + i]);
+        if (el > max_error) max_error = el;
+        if (er > max_error) max_error = er;
+      }
+    }
+
+    fprintf(stderr, "  %7zu   %8.2f   %7.2f   %9.2e\n", threads, elapsed * 1000.0,
+            serial_time / elapsed, max_error);
+
+    // Only the summation order differs from the serial path
+    if (max_error > 1e-4f) {
+      fprintf(stderr, "  FAIL: Output with %zu threads differs from serial\n", threads);
+      return false;
+    }
+  }
+
+  fprintf(stderr, "  PASS: Parallel output matches serial for 2..%zu threads\n", max_threads);
+  return true;
+}
+
+// Test that a small voice count stays on the audio thread
+bool TestLowPolyphonyFallback(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Low Polyphony Fallback\n");
+  fprintf(stderr, "============================\n");
+
+  std::vector<uint8_t> notes = bank.GetAllNotes();
+  const uint32_t buffer_size = 256;
+
+  SamplePlayer serial;
+  SamplePlayer parallel;
+  serial.Init(&bank, 48000);
+  parallel.Init(&bank, 48000);
+  parallel.SetRenderThreads(4, buffer_size);
+
+  serial.Trigger(notes[0], 0.8f, -0.5f);
+  parallel.Trigger(notes[0], 0.8f, -0.5f);
+
+  float sl[buffer_size], sr[buffer_size], pl[buffer_size], pr[buffer_size];
+  serial.ProcessStereo(sl, sr, buffer_size);
+  parallel.ProcessStereo(pl, pr, buffer_size);
+
+  for (uint32_t i = 0; i < buffer_size; i++) {
+    if (sl[i] != pl[i] || sr[i] != pr[i]) {
+      fprintf(stderr, "  FAIL: Single voice output differs at frame %u\n", i);
+      return false;
+    }
+  }
+
+  fprintf(stderr, "  PASS: Low polyphony renders identically\n");
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+
+  fprintf(stderr, "Render Pool Test Suite\n");
+  fprintf(stderr, "======================\n\n");
+
+  SampleBank bank;
+  if (!bank.LoadDirectory("data", 48000)) {
+    fprintf(stderr, "Error: Failed to load samples from data/\n");
+    return 1;
+  }
+
+  int passed = 0;
+  int failed = 0;
+
+  if (TestPoolRunsEverySlot()) passed++; else failed++;
+  if (TestParallelMatchesSerial(bank)) passed++; else failed++;
+  if (TestLowPolyphonyFallback(bank)) passed++; else failed++;
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,247 @@
+// Test for realtime safety of the audio path
+// This test verifies that:
+// 1. The rt_check interposers abort on each class of forbidden call,
+//    on the audio thread and on render pool workers
+// 2. The pattern generator and sample player run allocation-, lock- and
+//    syscall-free with every feature enabled (humanize, LFO, spread,
+//    coalescing, tracing, statistics, parallel rendering)
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "audio_engine.h"
+#include "event_trace.h"
+#include "rt_check.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+#include "pattern_generator_wrapper.h"
+#include "render_pool.h"
+
+using namespace grids_jack;
+
+// Render workers mix voices for the audio thread, so check them too
+static void MarkWorkerRealtime(bool starting) {
+  SetRealtimeThread(starting);
+}
+
+// Forbidden calls, each run in a child process
+static void CallMalloc() {
+  void* volatile ptr = malloc(16);
+  free(ptr);
+}
+
+static void CallNew() {
+  std::vector<int>* volatile vec = new std::vector<int>(4);
+  delete vec;
+}
+
+static void CallMutexLock() {
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_mutex_lock(&mutex);
+  pthread_mutex_unlock(&mutex);
+}
+
+static void CallWrite() {
+  ssize_t ignored = write(STDOUT_FILENO, "", 0);
+  (void)ignored;
+}
+
+static void CallUsleep() {
+  usleep(1);
+}
+
+// Run a call on a realtime-marked thread in a child; true if it aborted
+static bool AbortsOnRealtimeThread(void (*call)()) {
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Keep the expected report out of the test log
+    freopen("/dev/null", "w", stderr);
+    {
+      ScopedRealtimeThread realtime;
+      call();
+    }
+    _exit(0);
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+// Allocate on worker slots only; the calling thread stays unmarked
+static void MallocOnWorkers(void* context, size_t worker_index) {
+  (void)context;
+  if (worker_index > 0) {
+    CallMalloc();
+  }
+}
+
+// Allocate in a render pool job in a child; true if it aborted
+static bool AbortsOnRenderWorker() {
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid == 0) {
+    freopen("/dev/null", "w", stderr);
+    RenderWorkerPool pool;
+    if (pool.Start(2, 0)) {
+      pool.Run(MallocOnWorkers, nullptr);
+      pool.Stop();
+    }
+    _exit(0);
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+// Test that each interposer fires only on realtime threads
+bool TestViolationsDetected() {
+  fprintf(stderr, "\nTest: Violations Detected\n");
+  fprintf(stderr, "=========================\n");
+
+  if (!RealtimeChecksAvailable()) {
+    fprintf(stderr, "  FAIL: Interposers not linked\n");
+    return false;
+  }
+
+  struct {
+    const char* name;
+    void (*call)();
+  } cases[] = {
+    {"malloc", CallMalloc},
+    {"operator new", CallNew},
+    {"pthread_mutex_lock", CallMutexLock},
+    {"write", CallWrite},
+    {"usleep", CallUsleep},
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    if (!AbortsOnRealtimeThread(cases[i].call)) {
+      fprintf(stderr, "  FAIL: %s on a realtime thread was not caught\n", cases[i].name);
+      return false;
+    }
+    // The same call is fine on a normal thread
+    cases[i].call();
+  }
+
+  if (!AbortsOnRenderWorker()) {
+    fprintf(stderr, "  FAIL: malloc on a render worker was not caught\n");
+    return false;
+  }
+
+  fprintf(stderr, "  PASS: All forbidden calls abort on a realtime thread or worker\n");
+  return true;
+}
+
+// Drive the engine as the JACK callback does, with checks armed
+static bool RunCheckedEngine(const SampleBank& bank, uint32_t sample_rate,
+                             uint32_t block_size, size_t render_threads,
+                             const char* label) {
+  SamplePlayer player;
+  player.Init(&bank, sample_rate);
+  if (render_threads > 1 && !player.SetRenderThreads(render_threads, block_size)) {
+    fprintf(stderr, "  FAIL (%s): Could not start render threads\n", label);
+    return false;
+  }
+
+  PatternGeneratorWrapper pattern_gen;
+  pattern_gen.Init(&player, sample_rate, 174.0f);
+  pattern_gen.SetLfoEnabled(true);
+  pattern_gen.SetHumanize(0.8f);
+  pattern_gen.AssignSamplesToParts(bank.GetAllNotes(), 16, 32);
+  pattern_gen.SetSpread(1.0f);
+
+  EventTrace* trace = new EventTrace();
+  if (!trace->Open("/dev/null", sample_rate)) {
+    delete trace;
+    return false;
+  }
+  pattern_gen.SetTrace(trace);
+
+  // On the heap so the histogram stays off the test's stack
+  AudioEngine* engine = new AudioEngine();
+  engine->Init(&player, &pattern_gen, sample_rate);
+  engine->SetOutputGain(0.8f);
+  std::vector<float> left(block_size);
+  std::vector<float> right(block_size);
+  std::vector<float> mono(block_size);
+
+  // 60 seconds of audio
+  uint32_t num_blocks = 60 * sample_rate / block_size;
+  {
+    ScopedRealtimeThread realtime;
+    for (uint32_t b = 0; b < num_blocks; b++) {
+      if (b % 64 == 63) {
+        pattern_gen.Process(block_size);
+        player.Process(mono.data(), block_size);
+      } else {
+        engine->Process(left.data(), right.data(), block_size);
+      }
+    }
+  }
+
+  trace->Close();
+  fprintf(stderr, "  %s: %u blocks, %llu triggers, peak %u voices\n", label, num_blocks,
+          (unsigned long long)player.GetTotalTriggersCount(), player.GetPeakVoiceCount());
+
+  delete engine;
+  delete trace;
+  return player.GetTotalTriggersCount() > 0;
+}
+
+// Test the full audio path with the checks armed (aborts on failure)
+bool TestAudioPathIsRealtimeSafe(const SampleBank& bank) {
+  fprintf(stderr, "\nTest: Audio Path Is Realtime Safe\n");
+  fprintf(stderr, "=================================\n");
+
+  if (!RunCheckedEngine(bank, 48000, 128, 1, "serial 48k/128")) return false;
+  if (!RunCheckedEngine(bank, 44100, 1024, 1, "serial 44.1k/1024")) return false;
+  if (!RunCheckedEngine(bank, 48000, 256, 4, "4 threads 48k/256")) return false;
+
+  fprintf(stderr, "  PASS: No allocations, locks or blocking syscalls in the audio path\n");
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+
+  fprintf(stderr, "Realtime Safety Test Suite\n");
+  fprintf(stderr, "==========================\n");
+
+  SampleBank bank;
+  if (!bank.LoadDirectory("data", 48000)) {
+    fprintf(stderr, "Error: Failed to load samples from data/\n");
+    return 1;
+  }
+
+  RenderWorkerPool::SetThreadHook(MarkWorkerRealtime);
+
+  int passed = 0;
+  int failed = 0;
+
+  if (TestViolationsDetected()) passed++; else failed++;
+  if (TestAudioPathIsRealtimeSafe(bank)) passed++; else failed++;
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -14,6 +14,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "sample_player.h"
+#include "pattern_generator_wrapper.h"
 #include <stdio.h>
 #include <cmath>
 
@@ -173,6 +174,202 @@ bool TestVoiceCompletion() {
     return true;
 }
 
+// Test every specialized mix kernel against a naive reference mix
+bool TestMixKernels() {
+    fprintf(stderr, "\nTest: Mix Kernels\n");
+    fprintf(stderr, "=================\n");
+
+    const uint32_t buffer_size = 256;
+    // Shorter than, equal to, and longer than one buffer
+    const uint32_t lengths[] = {100, buffer_size, 1000};
+    const float velocities[] = {1.0f, 0.5f};
+    const float pans[] = {0.0f, -0.5f, 1.0f};
+
+    for (uint32_t length : lengths) {
+        Sample sample;
+        CreateTestSample(&sample, length, 60);
+        SampleBank bank;
+        bank.AddSample(60, sample.data, sample.filename);
+
+        for (float velocity : velocities) {
+            for (float pan : pans) {
+                SamplePlayer mono;
+                SamplePlayer stereo;
+                mono.Init(&bank, 48000);
+                stereo.Init(&bank, 48000);
+                mono.Trigger(60, velocity, pan);
+                stereo.Trigger(60, velocity, pan);
+
+                float theta = (pan + 1.0f) * 0.25f * static_cast<float>(M_PI);
+                float gl = velocity * cosf(theta);
+                float gr = velocity * sinf(theta);
+                // Far-channel gain of a hard pan is snapped to silence
+                if (fabsf(gl) < kGainGuard) gl = 0.0f;
+                if (fabsf(gr) < kGainGuard) gr = 0.0f;
+
+                float out[buffer_size], left[buffer_size], right[buffer_size];
+                for (uint32_t pos = 0; pos < length + buffer_size; pos += buffer_size) {
+                    mono.Process(out, buffer_size);
+                    stereo.ProcessStereo(left, right, buffer_size);
+
+                    for (uint32_t i = 0; i < buffer_size; i++) {
+                        float s = pos + i < length ? sample.data[pos + i] : 0.0f;
+                        if (out[i] != s * velocity || left[i] != s * gl ||
+                            right[i] != s * gr) {
+                            fprintf(stderr, "  FAIL: length=%u velocity=%.1f pan=%.1f "
+                                    "frame %u differs from reference\n",
+                                    length, velocity, pan, pos + i);
+                            return false;
+                        }
+                    }
+                }
+
+                if (mono.GetActiveVoiceCount() != 0 || stereo.GetActiveVoiceCount() != 0) {
+                    fprintf(stderr, "  FAIL: Voice still active after sample end\n");
+                    return false;
+                }
+            }
+        }
+    }
+
+    fprintf(stderr, "  PASS: All kernel variants match the reference mix\n");
+    return true;
+}
+
+// Test that identical hits in one block share a voice without changing output
+bool TestTriggerCoalescing() {
+    fprintf(stderr, "\nTest: Trigger Coalescing\n");
+    fprintf(stderr, "========================\n");
+
+    Sample sample;
+    CreateTestSample(&sample, 1000, 60);
+    SampleBank bank;
+    bank.AddSample(60, sample.data, sample.filename);
+    bank.AddSample(62, sample.data, sample.filename);
+
+    SamplePlayer merged;
+    SamplePlayer separate;
+    merged.Init(&bank, 48000);
+    separate.Init(&bank, 48000);
+    separate.SetCoalescing(false);
+
+    // Same note three times with different velocity and pan, plus another note
+    const float velocities[] = {1.0f, 0.1f, 0.5f};
+    const float pans[] = {-1.0f, 0.0f, 0.7f};
+    for (int i = 0; i < 3; i++) {
+        merged.Trigger(60, velocities[i], pans[i]);
+        separate.Trigger(60, velocities[i], pans[i]);
+    }
+    merged.Trigger(62, 1.0f);
+    separate.Trigger(62, 1.0f);
+
+    if (merged.GetActiveVoiceCount() != 2 || merged.GetCoalescedTriggersCount() != 2) {
+        fprintf(stderr, "  FAIL: Expected 2 voices and 2 merged triggers, got %u and %lu\n",
+                merged.GetActiveVoiceCount(),
+                (unsigned long)merged.GetCoalescedTriggersCount());
+        return false;
+    }
+    if (separate.GetActiveVoiceCount() != 4) {
+        fprintf(stderr, "  FAIL: Expected 4 voices without coalescing, got %u\n",
+                separate.GetActiveVoiceCount());
+        return false;
+    }
+
+    const uint32_t buffer_size = 256;
+    float ml[buffer_size], mr[buffer_size], sl[buffer_size], sr[buffer_size];
+    float max_error = 0.0f;
+
+    for (int block = 0; block < 5; block++) {
+        // A retrigger after the first block starts later and must not merge
+        if (block == 1) {
+            merged.Trigger(60, 1.0f);
+            separate.Trigger(60, 1.0f);
+        }
+
+        merged.ProcessStereo(ml, mr, buffer_size);
+        separate.ProcessStereo(sl, sr, buffer_size);
+
+        for (uint32_t i = 0; i < buffer_size; i++) {
+            float el = fabsf(ml[i] - sl[i]);
+            float er = fabsf(mr[i] - sr[i]);
+            if (el > max_error) max_error = el;
+            if (er > max_error) max_error = er;
+        }
+    }
+
+    if (merged.GetCoalescedTriggersCount() != 2) {
+        fprintf(stderr, "  FAIL: Retrigger in a later block was merged\n");
+        return false;
+    }
+
+    if (max_error > 1e-6f) {
+        fprintf(stderr, "  FAIL: Merged output differs by %g\n", max_error);
+        return false;
+    }
+
+    fprintf(stderr, "  PASS: 4 hits rendered by 2 voices (max error %g)\n", max_error);
+    return true;
+}
+
+// Run two mappings of the same note through the pattern generator and
+// return the player's coalesced trigger count (-1 if nothing fired)
+static long RunSharedNoteMappings(const SampleBank& bank, bool stems) {
+    SamplePlayer player;
+    player.Init(&bank, 48000);
+    player.SetStemBuses(stems);
+    PatternGeneratorWrapper pattern;
+    pattern.Init(&player, 48000, 120.0f);
+    pattern.Seed(1);
+    pattern.AssignSamplesToParts(std::vector<uint8_t>(2, 60), 2, 32);
+    for (int p = 0; p < DRUM_PART_COUNT; p++) {
+        pattern.SetDensity(static_cast<DrumPart>(p), 255);
+    }
+
+    const uint32_t buffer_size = 256;
+    float left[buffer_size], right[buffer_size];
+    float bus_data[4][buffer_size];
+    float* buses[4] = {bus_data[0], bus_data[1], bus_data[2], bus_data[3]};
+    for (int block = 0; block < 48000 * 4 / static_cast<int>(buffer_size); block++) {
+        pattern.Process(buffer_size);
+        if (stems) {
+            player.ProcessStems(left, right, buses, 2, buffer_size);
+        } else {
+            player.ProcessStereo(left, right, buffer_size);
+        }
+    }
+    if (player.GetTotalTriggersCount() == 0) {
+        return -1;
+    }
+    return static_cast<long>(player.GetCoalescedTriggersCount());
+}
+
+// Test that mappings sharing a note coalesce unless stems keep them apart
+bool TestMappingsShareVoice() {
+    fprintf(stderr, "\nTest: Mappings Sharing a Note\n");
+    fprintf(stderr, "=============================\n");
+
+    Sample sample;
+    CreateTestSample(&sample, 1000, 60);
+    SampleBank bank;
+    bank.AddSample(60, sample.data, sample.filename);
+
+    long mix_merged = RunSharedNoteMappings(bank, false);
+    long stem_merged = RunSharedNoteMappings(bank, true);
+    if (mix_merged <= 0) {
+        fprintf(stderr, "  FAIL: Hits of two mappings on one note never merged (%ld)\n",
+                mix_merged);
+        return false;
+    }
+    if (stem_merged != 0) {
+        fprintf(stderr, "  FAIL: %ld hits merged across stem buses\n", stem_merged);
+        return false;
+    }
+
+    fprintf(stderr, "  PASS: %ld hits merged into the other mapping's voice; "
+            "none with stems\n", mix_merged);
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
@@ -191,6 +388,9 @@ int main(int argc, char* argv[]) {
     if (TestVoiceStealing()) passed++; else failed++;
     if (TestRealtimeSafety()) passed++; else failed++;
     if (TestVoiceCompletion()) passed++; else failed++;
+    if (TestMixKernels()) passed++; else failed++;
+    if (TestTriggerCoalescing()) passed++; else failed++;
+    if (TestMappingsShareVoice()) passed++; else failed++;
     
     // Print summary
     fprintf(stderr, "\n");
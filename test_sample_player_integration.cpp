@@ -116,6 +116,7 @@ bool TestHighPolyphony() {
     
     SamplePlayer player;
     player.Init(&bank, sample_rate);
+    player.SetCoalescing(false);  // Every trigger gets its own voice
     
     // Trigger many voices
     const size_t num_triggers = 50;
@@ -128,6 +129,10 @@ bool TestHighPolyphony() {
     
     uint32_t peak_voices = player.GetActiveVoiceCount();
     fprintf(stderr, "  Active voices after triggers: %u\n", peak_voices);
+    if (peak_voices != num_triggers) {
+        fprintf(stderr, "  FAIL: Expected %zu active voices\n", num_triggers);
+        return false;
+    }
     
     // Process a few buffers
     const uint32_t buffer_size = 256;
@@ -176,6 +181,7 @@ bool TestVoiceStealingWithRealSamples() {
     
     SamplePlayer player;
     player.Init(&bank, sample_rate);
+    player.SetCoalescing(false);  // Every trigger gets its own voice
     
     // Trigger more voices than the pool can hold
     const size_t triggers = kMaxVoices + 50;
@@ -187,11 +193,16 @@ bool TestVoiceStealingWithRealSamples() {
     }
     
     fprintf(stderr, "  Total triggers: %lu\n", (unsigned long)player.GetTotalTriggersCount());
-    fprintf(stderr, "  Active voices: %u (should be <= %zu)\n", 
+    fprintf(stderr, "  Active voices: %u (pool size %zu)\n", 
             player.GetActiveVoiceCount(), kMaxVoices);
     
-    if (player.GetActiveVoiceCount() > kMaxVoices) {
-        fprintf(stderr, "  FAIL: Active voices exceeds pool size\n");
+    if (player.GetActiveVoiceCount() != kMaxVoices) {
+        fprintf(stderr, "  FAIL: Expected a full pool of %zu voices\n", kMaxVoices);
+        return false;
+    }
+    if (player.GetVoiceStealCount() != triggers - kMaxVoices) {
+        fprintf(stderr, "  FAIL: Expected %zu steals, got %llu\n", triggers - kMaxVoices,
+                (unsigned long long)player.GetVoiceStealCount());
         return false;
     }
     
@@ -0,0 +1,412 @@
+// Randomized stress test of the audio path on the dummy backend
+// Each scenario drives AudioEngine from the dummy backend's audio thread
+// while a seeded script hammers the control path between cycles:
+// - tempo changes every cycle (20-300 BPM)
+// - x/y sweeps, random randomness and densities every cycle
+// - thousands of direct Trigger() calls per cycle, with out-of-range
+//   velocities and pans, notes without a sample and coalescing toggled
+// - humanize at 1.0 (or re-set every cycle) with enough mappings that
+//   the pending trigger queue overflows
+//
+// There is no live control thread in grids-jack, so the script runs on
+// the audio thread at the start of each cycle, before the engine. Its
+// random draws depend only on the cycle number, so every run of a
+// scenario produces the same stream.
+//
+// Invariants, checked every cycle and at the end:
+// 1. The output never contains NaN or infinity
+// 2. Active voices stay within kMaxVoices, pending humanized triggers
+//    within kMaxPendingTriggers
+// 3. Cycles whose own work (script and engine, in thread CPU time) took
+//    longer than the period stay within kMaxOverrunPercent. Backend
+//    xruns are reported but depend on the scheduler as much as on the
+//    callback. Not checked in sanitized builds, whose instrumentation
+//    alone can blow the budget.
+// 4. With GRIDS_RT_CHECK, the callback and the render workers never
+//    allocate, lock or block (rt_check aborts the test on the first
+//    violation)
+// 5. The first kHashCycles cycles are bit-identical to an offline replay
+//    of the same script (the backend adds nothing, the script is
+//    deterministic)
+//
+// CTest also runs this driver built with AddressSanitizer and UBSan
+// (test_stress_sanitized), without rt_check.
+//
+// Options: --seconds <n> in real time per scenario (default 3),
+// --seed <n> for the script (default 1)
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <thread>
+#include <vector>
+#include "audio_engine.h"
+#include "denormals.h"
+#include "dummy_backend.h"
+#include "pattern_generator_wrapper.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+#ifdef GRIDS_RT_CHECK
+#include "render_pool.h"
+#include "rt_check.h"
+#endif
+
+using namespace grids_jack;
+
+static const uint32_t kSampleRate = 48000;
+
+// Cycles compared against the offline replay
+static const uint64_t kHashCycles = 500;
+
+// Share of cycles allowed to overrun the period
+static const double kMaxOverrunPercent = 1.0;
+
+#if defined(__SANITIZE_ADDRESS__)
+static const bool kSanitized = true;
+#else
+static const bool kSanitized = false;
+#endif
+
+struct StressScenario {
+  const char* name;
+  uint32_t block_size;
+  size_t num_mappings;
+  size_t render_threads;     // Used only with a core per thread to spare
+  uint32_t flood_triggers;   // Direct Trigger() calls per cycle
+  bool tempo_storm;          // New tempo every cycle (else 300 BPM)
+  bool sweep;                // x/y, randomness and densities every cycle
+  bool humanize_storm;       // New humanize amount every cycle (else 1.0)
+  bool expect_overflow;      // The pending queue must overflow
+};
+
+static const StressScenario kScenarios[] = {
+  {"tempo_storm", 64, 16, 1, 0, true, true, true, false},
+  {"trigger_flood", 256, 16, 2, 4000, false, true, false, false},
+  {"queue_overflow", 128, 128, 1, 0, false, false, false, true},
+  {"everything", 32, 128, 2, 1000, true, true, true, false},
+};
+
+// Invariant tracking, written by the audio thread only
+struct StressCounters {
+  uint64_t cycles;
+  uint64_t non_finite;        // Output samples that were NaN or infinite
+  uint64_t first_bad_cycle;
+  uint64_t overruns;          // Cycles that took longer than the period
+  uint32_t max_voices;
+  uint32_t max_pending;
+  uint64_t flood_triggers;
+  uint64_t hash;              // FNV-1a of the first kHashCycles cycles
+};
+
+static void ClearCounters(StressCounters* counters) {
+  memset(counters, 0, sizeof(*counters));
+  counters->hash = 1469598103934665603ull;
+}
+
+// The engine, its inputs and the control script of one run
+class StressRig {
+ public:
+  StressRig(const SampleBank& bank, const StressScenario& scenario, uint32_t seed)
+      : scenario_(scenario), rng_(seed * 2654435761u + 1) {
+    player_.Init(&bank, kSampleRate);
+    if (scenario.render_threads > 1 &&
+        std::thread::hardware_concurrency() > scenario.render_threads) {
+      player_.SetRenderThreads(scenario.render_threads, scenario.block_size);
+    }
+    pattern_.Init(&player_, kSampleRate, 300.0f);
+    pattern_.Seed(seed);
+    pattern_.SetLfoEnabled(true);
+    pattern_.SetHumanize(1.0f);
+    pattern_.AssignSamplesToParts(bank.GetAllNotes(), scenario.num_mappings, 32);
+    pattern_.SetSpread(1.0f);
+    for (int p = 0; p < DRUM_PART_COUNT; p++) {
+      pattern_.SetDensity(static_cast<DrumPart>(p), 255);
+    }
+    engine_.Init(&player_, &pattern_, kSampleRate);
+    ClearCounters(&counters_);
+  }
+
+  // One cycle: apply the script, render, check the output
+  void Cycle(float* left, float* right, uint32_t num_frames) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    uint64_t cycle = counters_.cycles;
+    uint64_t start = ThreadCpuNanos();
+    if (scenario_.tempo_storm) {
+      pattern_.SetTempo(20.0f + 280.0f * Uniform());
+    }
+    if (scenario_.sweep) {
+      pattern_.SetPatternX(static_cast<uint8_t>(cycle * 37));
+      pattern_.SetPatternY(static_cast<uint8_t>(255 - cycle * 11));
+      pattern_.SetRandomness(static_cast<uint8_t>(Next()));
+      for (int p = 0; p < DRUM_PART_COUNT; p++) {
+        pattern_.SetDensity(static_cast<DrumPart>(p), static_cast<uint8_t>(Next()));
+      }
+    }
+    if (scenario_.humanize_storm) {
+      // Off a quarter of the time; triggers still queued must drain anyway
+      pattern_.SetHumanize((Next() & 3) == 0 ? 0.0f : Uniform());
+    }
+    if (scenario_.flood_triggers > 0) {
+      player_.SetCoalescing((cycle & 1) == 0);
+      for (uint32_t t = 0; t < scenario_.flood_triggers; t++) {
+        // Every note, including ones without a sample
+        uint8_t note = static_cast<uint8_t>(Next() & 0xff);
+        float velocity = -1.0f + 5.0f * Uniform();
+        float pan = -8.0f + 16.0f * Uniform();
+        player_.Trigger(note, velocity, pan, nullptr, static_cast<uint16_t>(t & 3));
+      }
+      counters_.flood_triggers += scenario_.flood_triggers;
+    }
+
+    engine_.Process(left, right, num_frames);
+
+    for (uint32_t i = 0; i < num_frames; i++) {
+      if (!isfinite(left[i]) || !isfinite(right[i])) {
+        if (counters_.non_finite == 0) counters_.first_bad_cycle = cycle;
+        counters_.non_finite++;
+      }
+    }
+    if (cycle < kHashCycles) {
+      counters_.hash = HashBlock(counters_.hash, left, num_frames);
+      counters_.hash = HashBlock(counters_.hash, right, num_frames);
+    }
+    if (player_.GetActiveVoiceCount() > counters_.max_voices) {
+      counters_.max_voices = player_.GetActiveVoiceCount();
+    }
+    if (pattern_.GetPendingTriggerCount() > counters_.max_pending) {
+      counters_.max_pending = pattern_.GetPendingTriggerCount();
+    }
+    if (ThreadCpuNanos() - start > num_frames * 1000000000ull / kSampleRate) {
+      counters_.overruns++;
+    }
+    counters_.cycles++;
+  }
+
+  const StressCounters& counters() const { return counters_; }
+  const SamplePlayer& player() const { return player_; }
+  const PatternGeneratorWrapper& pattern() const { return pattern_; }
+
+ private:
+  // xorshift32
+  uint32_t Next() {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+  }
+
+  float Uniform() {
+    return static_cast<float>(Next() >> 8) / 16777216.0f;
+  }
+
+  static uint64_t ThreadCpuNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+  }
+
+  static uint64_t HashBlock(uint64_t hash, const float* data, uint32_t frames) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < frames * sizeof(float); i++) {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+  }
+
+  StressScenario scenario_;
+  uint32_t rng_;
+  SamplePlayer player_;
+  PatternGeneratorWrapper pattern_;
+  AudioEngine engine_;
+  StressCounters counters_;
+};
+
+class StressClient : public AudioBackendClient {
+ public:
+  explicit StressClient(StressRig* rig) : rig_(rig) {}
+
+  void Process(float* const* outputs, uint32_t num_frames) {
+#ifdef GRIDS_RT_CHECK
+    ScopedRealtimeThread realtime;
+#endif
+    rig_->Cycle(outputs[0], outputs[1], num_frames);
+  }
+
+  void ThreadInit() {
+    DisableDenormals();
+  }
+
+ private:
+  StressRig* rig_;
+};
+
+#ifdef GRIDS_RT_CHECK
+static void MarkWorkerRealtime(bool starting) {
+  SetRealtimeThread(starting);
+}
+#endif
+
+// Short decaying noise bursts on every MIDI note
+static void BuildStressKit(SampleBank* bank) {
+  uint32_t rng = 12345;
+  for (int note = 0; note < 128; note++) {
+    std::vector<float> data(64 + (note * 97) % 4000);
+    for (size_t i = 0; i < data.size(); i++) {
+      rng = rng * 1664525u + 1013904223u;
+      float noise = static_cast<float>(rng >> 8) / 16777216.0f - 0.5f;
+      data[i] = noise * expf(-8.0f * i / data.size());
+    }
+    bank->AddSample(static_cast<uint8_t>(note), data, "stress");
+  }
+}
+
+// Run a scenario on the dummy backend, then check it against an offline
+// replay of the same script
+static bool RunScenario(const SampleBank& bank, const StressScenario& scenario,
+                        double seconds, uint32_t seed) {
+  StressRig* rig = new StressRig(bank, scenario, seed);
+  fprintf(stderr, "\nScenario: %s (block %u, %zu mappings, %zu render threads, "
+          "%u flood triggers per cycle)\n", scenario.name, scenario.block_size,
+          scenario.num_mappings, rig->player().GetRenderThreads(),
+          scenario.flood_triggers);
+  StressClient client(rig);
+  DummyBackend backend(kSampleRate, scenario.block_size);
+  if (!backend.Open("stress", &client) || !backend.RegisterOutput("output_L") ||
+      !backend.RegisterOutput("output_R") || !backend.Activate()) {
+    fprintf(stderr, "  FAIL: Could not start the dummy backend\n");
+    delete rig;
+    return false;
+  }
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(seconds);
+  ts.tv_nsec = static_cast<long>((seconds - ts.tv_sec) * 1e9);
+  nanosleep(&ts, nullptr);
+  backend.Close();
+
+  const StressCounters& c = rig->counters();
+  uint32_t xruns = backend.GetXrunCount();
+  fprintf(stderr, "  %llu cycles, %llu overran the period, %u backend xruns\n",
+          (unsigned long long)c.cycles, (unsigned long long)c.overruns, xruns);
+  fprintf(stderr, "  %llu triggers (%llu flooded, %llu coalesced, %llu steals), "
+          "peak %u voices, %u pending, %llu queue overflows\n",
+          (unsigned long long)rig->player().GetTotalTriggersCount(),
+          (unsigned long long)c.flood_triggers,
+          (unsigned long long)rig->player().GetCoalescedTriggersCount(),
+          (unsigned long long)rig->player().GetVoiceStealCount(),
+          rig->player().GetPeakVoiceCount(), c.max_pending,
+          (unsigned long long)rig->pattern().GetPendingOverflowCount());
+
+  bool ok = true;
+  if (c.cycles == 0) {
+    fprintf(stderr, "  FAIL: No cycles ran\n");
+    ok = false;
+  }
+  if (c.non_finite > 0) {
+    fprintf(stderr, "  FAIL: %llu NaN/inf output samples, first in cycle %llu\n",
+            (unsigned long long)c.non_finite, (unsigned long long)c.first_bad_cycle);
+    ok = false;
+  }
+  if (c.max_voices > kMaxVoices || rig->player().GetPeakVoiceCount() > kMaxVoices) {
+    fprintf(stderr, "  FAIL: %u voices active (limit %zu)\n",
+            c.max_voices, static_cast<size_t>(kMaxVoices));
+    ok = false;
+  }
+  if (c.max_pending > kMaxPendingTriggers) {
+    fprintf(stderr, "  FAIL: %u pending triggers (limit %zu)\n", c.max_pending,
+            kMaxPendingTriggers);
+    ok = false;
+  }
+  if (!kSanitized && c.overruns > c.cycles * kMaxOverrunPercent / 100.0) {
+    fprintf(stderr, "  FAIL: %llu of %llu cycles overran the period (budget %.0f%%)\n",
+            (unsigned long long)c.overruns, (unsigned long long)c.cycles,
+            kMaxOverrunPercent);
+    ok = false;
+  }
+  if (scenario.expect_overflow && rig->pattern().GetPendingOverflowCount() == 0) {
+    fprintf(stderr, "  FAIL: The pending queue never overflowed\n");
+    ok = false;
+  }
+  if (rig->player().GetTotalTriggersCount() == 0) {
+    fprintf(stderr, "  FAIL: No triggers\n");
+    ok = false;
+  }
+
+  // The same script without a backend must give the same stream
+  if (ok) {
+    StressRig* replay = new StressRig(bank, scenario, seed);
+    std::vector<float> left(scenario.block_size);
+    std::vector<float> right(scenario.block_size);
+    ScopedDenormalsOff denormals_off;
+    uint64_t hashed = c.cycles < kHashCycles ? c.cycles : kHashCycles;
+    for (uint64_t cycle = 0; cycle < hashed; cycle++) {
+      replay->Cycle(left.data(), right.data(), scenario.block_size);
+    }
+    if (replay->counters().hash != c.hash) {
+      fprintf(stderr, "  FAIL: First %llu cycles differ from the offline replay "
+              "(%016llx vs %016llx)\n", (unsigned long long)hashed,
+              (unsigned long long)c.hash, (unsigned long long)replay->counters().hash);
+      ok = false;
+    }
+    delete replay;
+  }
+
+  delete rig;
+  if (ok) {
+    fprintf(stderr, "  PASS: Output finite, voices and queue bounded, %s, "
+            "replay identical\n", kSanitized ? "deadlines not checked" : "deadlines met");
+  }
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  double seconds = 3.0;
+  uint32_t seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else {
+      fprintf(stderr, "Usage: %s [--seconds <n>] [--seed <n>]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (seconds <= 0.0) {
+    fprintf(stderr, "Error: --seconds must be positive\n");
+    return 1;
+  }
+
+  fprintf(stderr, "Stress Test Suite\n");
+  fprintf(stderr, "=================\n");
+#ifdef GRIDS_RT_CHECK
+  RenderWorkerPool::SetThreadHook(MarkWorkerRealtime);
+  fprintf(stderr, "Realtime checks armed in the callback and render workers\n");
+#endif
+
+  SampleBank bank;
+  BuildStressKit(&bank);
+
+  int passed = 0;
+  int failed = 0;
+  for (const StressScenario& scenario : kScenarios) {
+    if (RunScenario(bank, scenario, seconds, seed)) passed++; else failed++;
+  }
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,483 @@
+// Trigger timing accuracy test
+// Renders patterns of one-frame impulse samples, detects every onset in
+// the output and compares it with the ideal tempo grid:
+// 1. Offline: RenderToFd streams each case through a pipe for several
+//    minutes of audio across tempos, buffer sizes and humanize amounts
+// 2. Dummy backend: one case runs on the backend's audio thread in real
+//    time for a few seconds
+//
+// Every trigger the pattern generator fires is matched to the onset it
+// produced. The error of an onset against the ideal grid is split into:
+// - clock: where the pattern clock put the trigger, against the exact
+//   grid time plus the intended humanize offset. Frames per pulse are an
+//   integer, so this drifts with the truncated tempo.
+// - quantization: where the hit sounds, against where it was due. Voices
+//   start at the beginning of the block they are triggered in.
+// The ideal grid puts pulse n at (n + 1) pulse periods after the start,
+// where the clock's first pulse is due.
+//
+// Each case checks that every trigger sounds exactly once, no earlier
+// than the start of its block, humanize offsets stay within their range
+// and the drift is the one the truncated tempo predicts. The table (and
+// --json <file>) reports mean and max error and the drift per minute.
+// Grids-style swing is not implemented by the pattern generator, so it
+// has no cases here.
+//
+// Options: --minutes <n> of audio per offline case (default 10),
+// --json <file> to write the results. CTest runs 3 minutes per case.
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "audio_engine.h"
+#include "bench_util.h"
+#include "denormals.h"
+#include "dummy_backend.h"
+#include "offline_render.h"
+#include "pattern_generator_wrapper.h"
+#include "sample_bank.h"
+#include "sample_player.h"
+
+using namespace grids_jack;
+
+static const uint32_t kSampleRate = 48000;
+
+// One impulse sample per drum part
+static const uint8_t kImpulseNotes[] = {36, 38, 42};
+
+// Real time spent on the dummy backend case
+static const unsigned int kDummySeconds = 3;
+
+// Upper bound on triggers and onsets recorded per case
+static const size_t kMaxEvents = 1 << 20;
+
+struct TimingCase {
+  float bpm;
+  uint32_t block_size;
+  float humanize;
+};
+
+// Triggers and onsets of one render, in stream frames
+// Preallocated so the dummy backend's audio thread can record into it
+class TimingRecorder : public TriggerListener {
+ public:
+  TimingRecorder()
+      : triggers(kMaxEvents), onsets(kMaxEvents), num_triggers(0), num_onsets(0),
+        overflow(false), frame(0) {}
+
+  void OnTrigger(uint64_t trigger_frame, uint16_t mapping, uint8_t midi_note,
+                 float velocity) override {
+    (void)mapping;
+    (void)midi_note;
+    (void)velocity;
+    if (num_triggers == triggers.size()) {
+      overflow = true;
+      return;
+    }
+    triggers[num_triggers++] = trigger_frame;
+  }
+
+  // Record the frames of a block that carry signal (planar channels)
+  void ScanPlanar(const float* left, const float* right, uint32_t frames) {
+    for (uint32_t i = 0; i < frames; i++) {
+      if (left[i] != 0.0f || right[i] != 0.0f) AddOnset(frame + i);
+    }
+    frame += frames;
+  }
+
+  // Same for interleaved stereo
+  void ScanInterleaved(const float* samples, uint32_t frames) {
+    for (uint32_t i = 0; i < frames; i++) {
+      if (samples[2 * i] != 0.0f || samples[2 * i + 1] != 0.0f) AddOnset(frame + i);
+    }
+    frame += frames;
+  }
+
+  std::vector<uint64_t> triggers;
+  std::vector<uint64_t> onsets;
+  size_t num_triggers;
+  size_t num_onsets;
+  bool overflow;
+  uint64_t frame;  // Frames scanned so far
+
+ private:
+  void AddOnset(uint64_t onset_frame) {
+    if (num_onsets == onsets.size()) {
+      overflow = true;
+      return;
+    }
+    onsets[num_onsets++] = onset_frame;
+  }
+};
+
+// Output of the dummy backend case goes straight into the recorder
+class RecordingClient : public AudioBackendClient {
+ public:
+  RecordingClient(AudioEngine* engine, TimingRecorder* recorder)
+      : engine_(engine), recorder_(recorder) {}
+
+  void Process(float* const* outputs, uint32_t num_frames) {
+    // REALTIME-SAFE: No allocations, no locks, no system calls
+    engine_->Process(outputs[0], outputs[1], num_frames);
+    recorder_->ScanPlanar(outputs[0], outputs[1], num_frames);
+  }
+
+  void ThreadInit() {
+    DisableDenormals();
+  }
+
+ private:
+  AudioEngine* engine_;
+  TimingRecorder* recorder_;
+};
+
+// Errors of one case, in milliseconds
+struct TimingResult {
+  std::vector<double> total;   // Onset against the ideal grid
+  double clock_mean;
+  double clock_end;            // Clock error of the last trigger
+  double early_mean;           // How early hits sound (quantization)
+  double early_max;
+  double drift;                // Clock error slope, ms per minute
+  double predicted_drift;      // From the truncated frames per pulse
+  double tempo_ppm;            // How much faster the clock runs
+};
+
+static double FramesToMs(double frames) {
+  return frames * 1000.0 / kSampleRate;
+}
+
+static void BuildImpulseKit(SampleBank* bank) {
+  for (uint8_t note : kImpulseNotes) {
+    bank->AddSample(note, std::vector<float>(1, 1.0f), "impulse");
+  }
+}
+
+static void SetupPattern(const SampleBank& bank, const TimingCase& c,
+                         SamplePlayer* player, PatternGeneratorWrapper* pattern,
+                         TimingRecorder* recorder) {
+  player->Init(&bank, kSampleRate);
+  pattern->Init(player, kSampleRate, c.bpm);
+  pattern->Seed(1);
+  pattern->SetHumanize(c.humanize);
+  pattern->SetTriggerListener(recorder);
+  std::vector<uint8_t> notes(kImpulseNotes, kImpulseNotes + sizeof(kImpulseNotes));
+  pattern->AssignSamplesToParts(notes, notes.size(), 16);
+  pattern->SetSpread(0.0f);
+  for (int p = 0; p < DRUM_PART_COUNT; p++) {
+    pattern->SetDensity(static_cast<DrumPart>(p), 192);
+  }
+}
+
+// Match triggers to onsets and measure them against the grid
+// Returns false (after printing why) if the timing breaks an invariant
+static bool AnalyzeTiming(const TimingCase& c, const PatternGeneratorWrapper& pattern,
+                          const TimingRecorder& recorder, TimingResult* result) {
+  if (recorder.overflow) {
+    fprintf(stderr, "  FAIL: More than %zu triggers or onsets\n", kMaxEvents);
+    return false;
+  }
+  if (recorder.num_triggers == 0) {
+    fprintf(stderr, "  FAIL: No triggers\n");
+    return false;
+  }
+
+  const uint64_t fpp = pattern.GetFramesPerPulse();
+  const double exact_fpp = kSampleRate * 60.0 / (c.bpm * 24.0);
+  // Same rounding as SetHumanize
+  const int64_t max_jitter = static_cast<int64_t>(c.humanize * 1.5f * fpp);
+
+  const uint64_t* onsets = recorder.onsets.data();
+  const size_t num_onsets = recorder.num_onsets;
+  std::vector<bool> onset_used(num_onsets, false);
+
+  result->total.clear();
+  double clock_sum = 0.0;
+  double early_sum = 0.0;
+  result->early_max = 0.0;
+  // Least-squares fit of clock error against grid time
+  double sum_t = 0.0, sum_e = 0.0, sum_tt = 0.0, sum_te = 0.0;
+  double last_time = -1.0;
+  result->clock_end = 0.0;
+
+  for (size_t t = 0; t < recorder.num_triggers; t++) {
+    uint64_t due = recorder.triggers[t];
+
+    // Nearest step pulse on the integer clock (every kPulsesPerStep pulses)
+    // Humanize moves a trigger by less than half a step
+    double pulses = (due + 1.0) / fpp - 1.0;
+    int64_t step = llround(pulses / grids::kPulsesPerStep);
+    int64_t pulse = step * grids::kPulsesPerStep;
+    int64_t clock_frame = (pulse + 1) * static_cast<int64_t>(fpp) - 1;
+    int64_t jitter = static_cast<int64_t>(due) - clock_frame;
+    if (jitter < -max_jitter || jitter > max_jitter) {
+      fprintf(stderr, "  FAIL: Trigger at frame %llu is %lld frames off the clock "
+              "(humanize allows %lld)\n", (unsigned long long)due, (long long)jitter,
+              (long long)max_jitter);
+      return false;
+    }
+
+    // The onset this trigger sounds at: the last one at or before it,
+    // or failing that the next one, within a block
+    const uint64_t* it = std::upper_bound(onsets, onsets + num_onsets, due);
+    size_t index = num_onsets;
+    if (it != onsets && due - *(it - 1) < c.block_size) {
+      index = (it - 1) - onsets;
+    } else if (it != onsets + num_onsets && *it - due < c.block_size) {
+      index = it - onsets;
+    }
+    if (index == num_onsets) {
+      fprintf(stderr, "  FAIL: No onset within a block of the trigger at frame %llu\n",
+              (unsigned long long)due);
+      return false;
+    }
+    onset_used[index] = true;
+
+    int64_t quant = static_cast<int64_t>(onsets[index]) - static_cast<int64_t>(due);
+    if (quant > 0 || quant <= -static_cast<int64_t>(c.block_size)) {
+      fprintf(stderr, "  FAIL: Trigger at frame %llu sounds at frame %llu, "
+              "outside its block\n", (unsigned long long)due,
+              (unsigned long long)onsets[index]);
+      return false;
+    }
+
+    double ideal = (pulse + 1) * exact_fpp + jitter;
+    double clock = due - ideal;
+    double total = onsets[index] - ideal;
+    result->total.push_back(FramesToMs(total));
+    clock_sum += clock;
+    early_sum -= quant;
+    if (-quant > result->early_max) result->early_max = -quant;
+
+    double minutes = ideal / (kSampleRate * 60.0);
+    sum_t += minutes;
+    sum_e += FramesToMs(clock);
+    sum_tt += minutes * minutes;
+    sum_te += minutes * FramesToMs(clock);
+    if (ideal > last_time) {
+      last_time = ideal;
+      result->clock_end = FramesToMs(clock);
+    }
+  }
+
+  for (size_t o = 0; o < num_onsets; o++) {
+    if (!onset_used[o]) {
+      fprintf(stderr, "  FAIL: Onset at frame %llu has no trigger\n",
+              (unsigned long long)onsets[o]);
+      return false;
+    }
+  }
+
+  double n = static_cast<double>(recorder.num_triggers);
+  double denominator = n * sum_tt - sum_t * sum_t;
+  result->drift = denominator > 0.0 ? (n * sum_te - sum_t * sum_e) / denominator : 0.0;
+  result->predicted_drift = (fpp - exact_fpp) / exact_fpp * 60000.0;
+  result->tempo_ppm = (exact_fpp - fpp) / fpp * 1e6;
+  result->clock_mean = FramesToMs(clock_sum / n);
+  result->early_mean = FramesToMs(early_sum / n);
+  result->early_max = FramesToMs(result->early_max);
+
+  // Humanize offsets are zero-mean, so the fit still finds the tempo
+  double tolerance = c.humanize > 0.0f ? 0.01 * fabs(result->predicted_drift) + 0.01 : 1e-6;
+  if (fabs(result->drift - result->predicted_drift) > tolerance) {
+    fprintf(stderr, "  FAIL: Clock drifts %.6f ms/min, the truncated tempo predicts %.6f\n",
+            result->drift, result->predicted_drift);
+    return false;
+  }
+  return true;
+}
+
+static void PrintHeader() {
+  fprintf(stderr, "  backend  bpm  block  human  triggers  mean_ms  maxabs_ms  "
+          "early_mean  early_max  drift_ms/min  end_ms    tempo_ppm\n");
+}
+
+static void PrintRow(const char* backend, const TimingCase& c, const TimingResult& r,
+                     const BenchStats& s) {
+  double max_abs = fabs(s.min) > fabs(s.max) ? fabs(s.min) : fabs(s.max);
+  fprintf(stderr, "  %-7s  %3.0f  %5u  %5.2f  %8zu  %7.3f  %9.3f  %10.3f  %9.3f  %12.4f  "
+          "%6.2f  %11.1f\n", backend, c.bpm, c.block_size, c.humanize, s.count, s.mean,
+          max_abs, r.early_mean, r.early_max, r.drift + 0.0, r.clock_end, r.tempo_ppm);
+}
+
+static const BenchStats& AddResult(BenchReport* report, const char* backend, const TimingCase& c,
+                      const TimingResult& r) {
+  BenchResult& result = report->Add("onset_error", "ms");
+  result.Param("backend", backend);
+  result.Param("bpm", c.bpm);
+  result.Param("block", c.block_size);
+  result.Param("humanize", c.humanize);
+  result.Param("clock_mean_ms", r.clock_mean);
+  result.Param("clock_end_ms", r.clock_end);
+  result.Param("early_mean_ms", r.early_mean);
+  result.Param("early_max_ms", r.early_max);
+  result.Param("drift_ms_per_min", r.drift);
+  result.Param("tempo_error_ppm", r.tempo_ppm);
+  result.stats = ComputeBenchStats(r.total);
+  return result.stats;
+}
+
+// Stream a case through RenderToFd into a pipe and scan what comes out
+static bool RunOfflineCase(const SampleBank& bank, const TimingCase& c,
+                           uint64_t total_frames, BenchReport* report) {
+  SamplePlayer player;
+  PatternGeneratorWrapper pattern;
+  TimingRecorder recorder;
+  SetupPattern(bank, c, &player, &pattern, &recorder);
+  AudioEngine engine;
+  engine.Init(&player, &pattern, kSampleRate);
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    fprintf(stderr, "  FAIL: pipe() failed\n");
+    return false;
+  }
+  std::thread reader([&recorder, &fds]() {
+    std::vector<float> buffer(2 * kStreamWriteFrames);
+    size_t bytes = 0;
+    for (;;) {
+      ssize_t n = read(fds[0], reinterpret_cast<char*>(buffer.data()) + bytes,
+                       buffer.size() * sizeof(float) - bytes);
+      if (n <= 0) break;
+      bytes += static_cast<size_t>(n);
+      size_t frames = bytes / (2 * sizeof(float));
+      recorder.ScanInterleaved(buffer.data(), static_cast<uint32_t>(frames));
+      size_t rest = bytes - frames * 2 * sizeof(float);
+      memmove(buffer.data(), buffer.data() + 2 * frames, rest);
+      bytes = rest;
+    }
+  });
+
+  RenderResult render;
+  bool ok = RenderToFd(&engine, kSampleRate, c.block_size, total_frames, fds[1],
+                       kPcmFloat32, false, &render);
+  close(fds[1]);
+  reader.join();
+  close(fds[0]);
+
+  if (!ok || recorder.frame != total_frames) {
+    fprintf(stderr, "  FAIL: Streamed %llu of %llu frames\n",
+            (unsigned long long)recorder.frame, (unsigned long long)total_frames);
+    return false;
+  }
+
+  TimingResult result;
+  if (!AnalyzeTiming(c, pattern, recorder, &result)) {
+    fprintf(stderr, "  (offline, %.0f BPM, block %u, humanize %.2f)\n",
+            c.bpm, c.block_size, c.humanize);
+    return false;
+  }
+  PrintRow("offline", c, result, AddResult(report, "offline", c, result));
+  return true;
+}
+
+// Run a case on the dummy backend's audio thread in real time
+static bool RunDummyCase(const SampleBank& bank, const TimingCase& c, BenchReport* report) {
+  SamplePlayer player;
+  PatternGeneratorWrapper pattern;
+  TimingRecorder recorder;
+  SetupPattern(bank, c, &player, &pattern, &recorder);
+  AudioEngine engine;
+  engine.Init(&player, &pattern, kSampleRate);
+
+  RecordingClient client(&engine, &recorder);
+  DummyBackend backend(kSampleRate, c.block_size);
+  if (!backend.Open("test", &client) || !backend.RegisterOutput("output_L") ||
+      !backend.RegisterOutput("output_R") || !backend.Activate()) {
+    fprintf(stderr, "  FAIL: Could not start the dummy backend\n");
+    return false;
+  }
+  struct timespec ts = {static_cast<time_t>(kDummySeconds), 0};
+  nanosleep(&ts, nullptr);
+  backend.Close();
+
+  TimingResult result;
+  if (!AnalyzeTiming(c, pattern, recorder, &result)) {
+    fprintf(stderr, "  (dummy, %.0f BPM, block %u, humanize %.2f)\n",
+            c.bpm, c.block_size, c.humanize);
+    return false;
+  }
+  PrintRow("dummy", c, result, AddResult(report, "dummy", c, result));
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  double minutes = 10.0;
+  const char* json_path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+      minutes = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_path = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--minutes <n>] [--json <file>]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (minutes <= 0.0) {
+    fprintf(stderr, "Error: --minutes must be positive\n");
+    return 1;
+  }
+
+  // A reader that dies must not kill the test with SIGPIPE
+  signal(SIGPIPE, SIG_IGN);
+
+  fprintf(stderr, "Trigger Timing Test Suite\n");
+  fprintf(stderr, "=========================\n");
+
+  SampleBank bank;
+  BuildImpulseKit(&bank);
+
+  const float bpms[] = {60.0f, 90.0f, 120.0f, 140.0f, 174.0f, 300.0f};
+  const uint32_t block_sizes[] = {32, 256, 1024};
+  const float humanize_amounts[] = {0.0f, 1.0f};
+
+  int passed = 0;
+  int failed = 0;
+  BenchReport report("timing");
+
+  uint64_t total_frames = static_cast<uint64_t>(minutes * 60.0 * kSampleRate);
+  fprintf(stderr, "\nOffline, %.1f minutes per case (errors in ms against the ideal grid)\n\n",
+          minutes);
+  PrintHeader();
+  for (float humanize : humanize_amounts) {
+    for (float bpm : bpms) {
+      for (uint32_t block_size : block_sizes) {
+        TimingCase c = {bpm, block_size, humanize};
+        if (RunOfflineCase(bank, c, total_frames, &report)) passed++; else failed++;
+      }
+    }
+  }
+
+  fprintf(stderr, "\nDummy backend, %u s in real time\n\n", kDummySeconds);
+  PrintHeader();
+  TimingCase dummy_case = {174.0f, 128, 0.5f};
+  if (RunDummyCase(bank, dummy_case, &report)) passed++; else failed++;
+
+  if (json_path != nullptr && !report.WriteJson(json_path)) {
+    failed++;
+  }
+
+  fprintf(stderr, "\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Test Summary\n");
+  fprintf(stderr, "=================================\n");
+  fprintf(stderr, "Tests passed: %d\n", passed);
+  fprintf(stderr, "Tests failed: %d\n", failed);
+  fprintf(stderr, "=================================\n");
+
+  if (failed > 0) {
+    fprintf(stderr, "FAILED: Some tests did not pass\n");
+    return 1;
+  }
+
+  fprintf(stderr, "SUCCESS: All tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,168 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Decode a grids-jack event trace (-T) to CSV on stdout and print a
+// timing summary to stderr
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "event_trace.h"
+
+using namespace grids_jack;
+
+static const char* PartName(uint8_t part) {
+    switch (part) {
+        case 0: return "BD";
+        case 1: return "SD";
+        case 2: return "HH";
+        default: return "?";
+    }
+}
+
+// Running min/max/mean of a signed quantity
+struct Summary {
+    uint64_t count;
+    int64_t min;
+    int64_t max;
+    double sum;
+    double sum_abs;
+
+    Summary() : count(0), min(0), max(0), sum(0.0), sum_abs(0.0) {}
+
+    void Add(int64_t value) {
+        if (count == 0 || value < min) min = value;
+        if (count == 0 || value > max) max = value;
+        sum += static_cast<double>(value);
+        sum_abs += static_cast<double>(value < 0 ? -value : value);
+        count++;
+    }
+
+    void Print(const char* label, uint32_t sample_rate) const {
+        if (count == 0) {
+            fprintf(stderr, "  %-18s no events\n", label);
+            return;
+        }
+        double ms = 1000.0 / sample_rate;
+        fprintf(stderr, "  %-18s mean %+.1f, mean |x| %.1f, min %+lld, max %+lld frames "
+                "(max |x| %.3f ms)\n",
+                label, sum / count, sum_abs / count, (long long)min, (long long)max,
+                (max > -min ? max : -min) * ms);
+    }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <trace-file> > events.csv\n", argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Error: Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    TraceFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, kTraceMagic, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "Error: %s is not a grids-jack trace\n", argv[1]);
+        fclose(file);
+        return 1;
+    }
+    if (header.version != kTraceVersion || header.record_size != sizeof(TraceRecord)) {
+        fprintf(stderr, "Error: Unsupported trace version %u (record size %u)\n",
+                header.version, header.record_size);
+        fclose(file);
+        return 1;
+    }
+    uint32_t sample_rate = header.sample_rate > 0 ? header.sample_rate : 48000;
+
+    printf("frame,time_s,type,note,part,velocity,pan,voice,stolen,coalesced,"
+           "humanized,x,y,block_offset,jitter\n");
+
+    uint64_t triggers = 0;
+    uint64_t part_triggers[3] = {0, 0, 0};
+    uint64_t steals = 0;
+    uint64_t coalesced = 0;
+    uint64_t queue_full = 0;
+    uint64_t dropped = 0;
+    uint64_t last_frame = 0;
+    uint64_t out_of_order = 0;
+    Summary onset;
+    Summary jitter;
+
+    TraceRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        if (record.type == kTraceDropped) {
+            dropped += record.frame;
+            printf("%llu,,dropped,,,,,,,,,,,,\n", (unsigned long long)record.frame);
+            continue;
+        }
+        if (record.type != kTraceTrigger) {
+            continue;
+        }
+
+        printf("%llu,%.6f,trigger,%u,%s,%.3f,%.3f,%d,%d,%d,%d,%u,%u,%u,%d\n",
+               (unsigned long long)record.frame,
+               static_cast<double>(record.frame) / sample_rate,
+               record.note, PartName(record.part), record.velocity, record.pan,
+               record.voice, (record.flags & kTraceStolen) != 0,
+               (record.flags & kTraceCoalesced) != 0,
+               (record.flags & kTraceHumanized) != 0,
+               record.x, record.y, record.block_offset, record.jitter);
+
+        triggers++;
+        if (record.part < 3) part_triggers[record.part]++;
+        if (record.flags & kTraceStolen) steals++;
+        if (record.flags & kTraceCoalesced) coalesced++;
+        if (record.flags & kTraceQueueFull) queue_full++;
+        if (record.frame < last_frame) out_of_order++;
+        last_frame = record.frame;
+
+        // Voices start at the block boundary, ahead of the due frame
+        onset.Add(-static_cast<int64_t>(record.block_offset));
+        if (record.flags & (kTraceHumanized | kTraceQueueFull)) {
+            jitter.Add(record.jitter);
+        }
+    }
+    fclose(file);
+
+    fprintf(stderr, "Trace summary (%u Hz)\n", sample_rate);
+    fprintf(stderr, "  Triggers: %llu (BD %llu, SD %llu, HH %llu)\n",
+            (unsigned long long)triggers, (unsigned long long)part_triggers[0],
+            (unsigned long long)part_triggers[1], (unsigned long long)part_triggers[2]);
+    fprintf(stderr, "  Duration: %.2f s\n", static_cast<double>(last_frame) / sample_rate);
+    fprintf(stderr, "  Voice steals: %llu, coalesced: %llu\n",
+            (unsigned long long)steals, (unsigned long long)coalesced);
+    fprintf(stderr, "Timing error (negative = early)\n");
+    onset.Print("Block quantization", sample_rate);
+    jitter.Print("Humanize jitter", sample_rate);
+    if (queue_full > 0) {
+        fprintf(stderr, "  Humanize queue full: %llu hits fired on the grid\n",
+                (unsigned long long)queue_full);
+    }
+    if (out_of_order > 0) {
+        fprintf(stderr, "  Warning: %llu records out of frame order\n",
+                (unsigned long long)out_of_order);
+    }
+    if (dropped > 0) {
+        fprintf(stderr, "  Warning: %llu records dropped (ring full)\n",
+                (unsigned long long)dropped);
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wav_writer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace grids_jack {
+
+namespace {
+
+// How long either side sleeps when there is nothing to do
+const useconds_t kWriterIntervalUs = 1000;
+const useconds_t kStallIntervalUs = 100;
+
+}  // namespace
+
+WavWriter::WavWriter()
+    : max_block_frames_(0),
+      file_(nullptr),
+      running_(false),
+      failed_(false),
+      stalls_(0) {}
+
+WavWriter::~WavWriter() {
+    Close();
+}
+
+bool WavWriter::Open(const char* path, uint32_t sample_rate, uint32_t max_block_frames) {
+    Close();
+
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    info.samplerate = static_cast<int>(sample_rate);
+    info.channels = 2;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    file_ = sf_open(path, SFM_WRITE, &info);
+    if (file_ == nullptr) {
+        fprintf(stderr, "Error: Could not create %s: %s\n", path, sf_strerror(nullptr));
+        return false;
+    }
+
+    path_ = path;
+    max_block_frames_ = max_block_frames;
+    block_memory_.assign(kNumBlocks * 2 * max_block_frames, 0.0f);
+    interleaved_.assign(2 * max_block_frames, 0.0f);
+
+    // Both rings start empty after a previous Close()
+    uint32_t index;
+    Block block;
+    while (free_blocks_.Pop(&index)) {
+    }
+    while (filled_blocks_.Pop(&block)) {
+    }
+    for (uint32_t i = 0; i < kNumBlocks; i++) {
+        free_blocks_.Push(i);
+    }
+
+    stalls_ = 0;
+    failed_.store(false);
+    running_.store(true);
+    writer_ = std::thread(&WavWriter::WriterLoop, this);
+    return true;
+}
+
+void WavWriter::Write(const float* left, const float* right, uint32_t num_frames) {
+    uint32_t index;
+    if (!free_blocks_.Pop(&index)) {
+        stalls_++;
+        do {
+            usleep(kStallIntervalUs);
+        } while (!free_blocks_.Pop(&index));
+    }
+
+    float* block = &block_memory_[index * 2 * max_block_frames_];
+    memcpy(block, left, num_frames * sizeof(float));
+    memcpy(block + max_block_frames_, right, num_frames * sizeof(float));
+
+    Block filled;
+    filled.index = index;
+    filled.frames = num_frames;
+    filled_blocks_.Push(filled);
+}
+
+bool WavWriter::Close() {
+    if (file_ == nullptr) {
+        return true;
+    }
+
+    running_.store(false);
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+
+    if (sf_close(file_) != 0) {
+        fprintf(stderr, "Error: Could not finish %s\n", path_.c_str());
+        failed_.store(true);
+    }
+    file_ = nullptr;
+    return !failed_.load();
+}
+
+void WavWriter::WriterLoop() {
+    while (running_.load()) {
+        if (filled_blocks_.Size() == 0) {
+            usleep(kWriterIntervalUs);
+            continue;
+        }
+        Drain();
+    }
+    // Blocks queued before Close() still reach the file
+    Drain();
+}
+
+void WavWriter::Drain() {
+    Block block;
+    while (filled_blocks_.Pop(&block)) {
+        const float* left = &block_memory_[block.index * 2 * max_block_frames_];
+        const float* right = left + max_block_frames_;
+        for (uint32_t i = 0; i < block.frames; i++) {
+            interleaved_[2 * i] = left[i];
+            interleaved_[2 * i + 1] = right[i];
+        }
+
+        // After a failure keep recycling buffers so Write() never blocks
+        if (!failed_.load(std::memory_order_relaxed) &&
+            sf_writef_float(file_, interleaved_.data(), block.frames) != block.frames) {
+            fprintf(stderr, "Error: Write to %s failed: %s\n", path_.c_str(),
+                    sf_strerror(file_));
+            failed_.store(true);
+        }
+        free_blocks_.Push(block.index);
+    }
+}
+
+}  // namespace grids_jack
@@ -0,0 +1,92 @@
+// Copyright 2024 grids-jack authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WAV_WRITER_H_
+#define WAV_WRITER_H_
+
+#include <sndfile.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+
+namespace grids_jack {
+
+// Streams stereo audio to a 32-bit float WAV file from its own thread
+//
+// Write() copies a planar block into one of a fixed set of preallocated
+// buffers and queues it; the writer thread interleaves, encodes and
+// writes it, then hands the buffer back. Free and filled buffers travel
+// through two SpscRings, so the rendering thread only ever waits when
+// every buffer is queued (the disk is slower than the render).
+class WavWriter {
+public:
+    // Buffers per file; at 256 frames per block about 1.4 s at 48 kHz
+    static constexpr size_t kNumBlocks = 256;
+
+    WavWriter();
+    ~WavWriter();
+
+    // Create the file and start the writer thread
+    // max_block_frames bounds num_frames in Write()
+    bool Open(const char* path, uint32_t sample_rate, uint32_t max_block_frames);
+
+    // Queue one block (called from a single thread)
+    void Write(const float* left, const float* right, uint32_t num_frames);
+
+    // Write everything queued, stop the thread and close the file
+    // Returns false if any write failed
+    bool Close();
+
+    const std::string& GetPath() const { return path_; }
+
+    // Number of Write() calls that had to wait for a free buffer
+    uint64_t GetStallCount() const { return stalls_; }
+
+private:
+    struct Block {
+        uint32_t index;
+        uint32_t frames;
+    };
+
+    void WriterLoop();
+
+    // Encode everything in the filled ring
+    void Drain();
+
+    SpscRing<uint32_t, kNumBlocks> free_blocks_;
+    SpscRing<Block, kNumBlocks> filled_blocks_;
+    std::vector<float> block_memory_;   // kNumBlocks planar L/R blocks
+    std::vector<float> interleaved_;    // Writer thread only
+    uint32_t max_block_frames_;
+
+    std::string path_;
+    SNDFILE* file_;
+    std::thread writer_;
+    std::atomic<bool> running_;
+    std::atomic<bool> failed_;
+    uint64_t stalls_;                   // Producer thread only
+
+    WavWriter(const WavWriter&);
+    WavWriter& operator=(const WavWriter&);
+};
+
+}  // namespace grids_jack
+
+#endif  // WAV_WRITER_H_